@@ -23,28 +23,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 const int INT_HEXDIGITS = 16; // enough for 64-bit ints
 
 /*
- *  class and structure needed to buffer words
+ *  class needed to buffer words; they are kept in a single growable
+ *  buffer and written out together.
  */
 
-struct word {
-  char *s;
-  word  *next;
-
-  word  (const char *w, int n);
-  ~word ();
-};
-
 class word_list {
 public:
             word_list     ();
+           ~word_list     ();
   int       flush         (FILE *f);
   void      add_word      (const char *s, int n);
   int       get_length    (void);
   
 private:
-  int       length;
-  word     *head;
-  word     *tail;
+  int       length;                       // as counted by add_word
+  char     *buf;
+  int       used;                         // bytes of buf to write
+  int       size;
 };
 
 class simple_output {
@@ -31,7 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <stdio.h> // EOF, FILE, fflush(), fputc(), fputs(), fwrite(),
 		   // getc(), putc(), sprintf()
-#include <string.h> // strlen(), strncpy()
+#include <string.h> // memcpy(), strlen()
 
 #include "cset.h"
 #include "driver.h"
@@ -52,41 +52,31 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #  define FPUTC(X,Y)   do { fputc((X),(Y)); fputc((X), stderr); fflush(stderr); } while (0)
 #  define FPUTS(X,Y)   do { fputs((X),(Y)); fputs((X), stderr); fflush(stderr); } while (0)
 #  define PUTC(X,Y)    do { putc((X),(Y)); putc((X), stderr); fflush(stderr); } while (0)
+#  define FWRITE(X,N,Y) do { fwrite((X),1,(N),(Y)); fwrite((X),1,(N),stderr); fflush(stderr); } while (0)
 #else
 #  define FPUTC(X,Y)   do { fputc((X),(Y)); } while (0)
 #  define FPUTS(X,Y)   do { fputs((X),(Y)); } while (0)
 #  define PUTC(X,Y)    do { putc((X),(Y)); } while (0)
+#  define FWRITE(X,N,Y) do { fwrite((X),1,(N),(Y)); } while (0)
 #endif
 
 
 /*
- *  word - initialise a word and set next to NULL
- */
-
-word::word (const char *w, int n)
-  : next(0)
-{
-  s = new char[n+1];
-  strncpy(s, w, n);
-  s[n] = '\0';
-}
-
-/*
- *  destroy word and the string copy.
+ *  word_list - create an empty word list.
  */
 
-word::~word ()
+word_list::word_list ()
+  : length(0), buf(0), used(0), size(0)
 {
-  delete[] s;
 }
 
 /*
- *  word_list - create an empty word list.
+ *  destroy word list and its buffer.
  */
 
-word_list::word_list ()
-  : length(0), head(0), tail(0)
+word_list::~word_list ()
 {
+  delete[] buf;
 }
 
 /*
@@ -96,17 +86,11 @@ word_list::word_list ()
 
 int word_list::flush (FILE *f)
 {
-  word *t;
   int   len=length;
 
-  while (head != 0) {
-    t = head;
-    head = head->next;
-    FPUTS(t->s, f);
-    delete t;
-  }
-  head   = 0;
-  tail   = 0;
+  if (used > 0)
+    FWRITE(buf, used, f);
+  used   = 0;
   length = 0;
 #if defined(DEBUGGING)
   fflush(f);   // just for testing
@@ -115,18 +99,30 @@ int word_list::flush (FILE *f)
 }
 
 /*
- *  add_word - adds a word to the outstanding word list.
+ *  add_word - adds a word to the outstanding word list.  Like the
+ *             strings that callers pass, a word ends at a null
+ *             character even if n says otherwise.
  */
 
 void word_list::add_word (const char *s, int n)
 {
-  if (head == 0) {
-    head = new word(s, n);
-    tail = head;
-  } else {
-    tail->next = new word(s, n);
-    tail       = tail->next;
+  int m = 0;
+
+  while (m < n && s[m] != '\0')
+    m++;
+  if (used + m > size) {
+    int new_size = (size == 0) ? 256 : size*2;
+    while (used + m > new_size)
+      new_size *= 2;
+    char *new_buf = new char[new_size];
+    if (used > 0)
+      memcpy(new_buf, buf, used);
+    delete[] buf;
+    buf  = new_buf;
+    size = new_size;
   }
+  memcpy(buf + used, s, m);
+  used   += m;
   length += n;
 }
 
@@ -24,7 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <errno.h>
 #include <stdcountof.h>
 #include <stdio.h> // EOF, FILE, fclose(), fgets(), getc(), ungetc()
-#include <stdlib.h> // getenv(), setenv(), strtoul()
+#include <stdlib.h> // free(), getenv(), setenv(), strtoul()
 #include <string.h> // strerror(), strtok()
 
 #include "cset.h"
@@ -341,7 +341,7 @@ void resource_manager::supply_resource(resource *r, int rank,
       if (0 /* nullptr */ == fp) {
 	  error("cannot open PostScript font file '%1': %2",
 		r->filename, strerror(errno));
-	delete[] r->filename;
+	free(r->filename);
 	r->filename = 0 /* nullptr */;
       }
     }
@@ -350,7 +350,7 @@ void resource_manager::supply_resource(resource *r, int rank,
       if (0 /* nullptr */ == fp) {
 	error("cannot open PostScript resource file '%1': %2",
 	      r->filename, strerror(errno));
-	delete[] r->filename;
+	free(r->filename);
 	r->filename = 0 /* nullptr */;
       }
       else
@@ -0,0 +1,160 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+grotty="${abs_top_builddir:-.}/grotty"
+builddir="${abs_top_builddir:-.}"
+srcdir="${abs_top_srcdir:-..}"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+dir="j-option-works.$$.d"
+
+cleanup () {
+  rm -rf "$dir"
+}
+
+# A process handling a fatal signal should:
+#   1.  Mask all fatal signals of interest.  (GBR often excludes ABRT.)
+#   2.  Perform cleanup operations.
+#   3.  Unmask the signal (removing the handler).
+#   4.  Signal its own process group with the signal caught so that the
+#       the children exit and shell accurately reports how the process
+#       died.
+fatals="HUP INT QUIT TERM"
+for s in $fatals
+do
+  trap "trap '' $fatals; cleanup; trap - $fatals; kill -$s -$$" $s
+done
+
+mkdir "$dir" || exit 99
+
+# Change the font and color partway through a page, so that a process
+# rendering later pages must have tracked them across pages it didn't
+# render.
+input='.pl 10v
+.nr i 0 1
+.de page
+.  sp
+page \\n+i
+.  if \\ni=3 \\f[B]\\m[red]bold red\\f[R]
+.  if \\ni=5 \\m[]default
+.  bp
+..
+.page
+.page
+.page
+.page
+.page
+.page
+.page'
+
+printf '%s\n' "$input" | "$groff" -Z -T ascii > "$dir"/pages.grout \
+  || exit 99
+
+"$grotty" -F "$builddir/font" -F "$srcdir/font" "$dir"/pages.grout \
+  > "$dir"/expected || exit 99
+
+for jobs in 2 3 7 10
+do
+  echo "checking that -j $jobs renders a file the same" >&2
+  "$grotty" -F "$builddir/font" -F "$srcdir/font" -j $jobs \
+    "$dir"/pages.grout > "$dir"/actual || wail
+  cmp "$dir"/expected "$dir"/actual || wail
+done
+
+echo "checking that -j 3 renders standard input the same" >&2
+"$grotty" -F "$builddir/font" -F "$srcdir/font" -j 3 \
+  < "$dir"/pages.grout > "$dir"/actual || wail
+cmp "$dir"/expected "$dir"/actual || wail
+
+echo "checking that -j 3 renders several files the same" >&2
+cat "$dir"/expected "$dir"/expected > "$dir"/expected2
+"$grotty" -F "$builddir/font" -F "$srcdir/font" -j 3 \
+  "$dir"/pages.grout "$dir"/pages.grout > "$dir"/actual || wail
+cmp "$dir"/expected2 "$dir"/actual || wail
+
+# Start hyperlinks on some pages and end them on later ones, once
+# starting a new one without ending the previous.  A process rendering
+# later pages must diagnose and recover from these as a sequential run
+# does, without complaining about links that began on pages it
+# didn't render.
+input='.pl 10v
+.nr i 0 1
+.de page
+.  sp
+page \\n+i
+.  if \\ni=2 \\X'"'"'tty: link https://example.com/a'"'"'a
+.  if \\ni=4 \\X'"'"'tty: link'"'"'
+.  if \\ni=5 \\X'"'"'tty: link https://example.com/b'"'"'b
+.  if \\ni=6 \\X'"'"'tty: link https://example.com/c'"'"'c
+.  if \\ni=7 \\X'"'"'tty: link'"'"'
+.  if \\ni=7 \\X'"'"'tty: link'"'"'
+.  bp
+..
+.page
+.page
+.page
+.page
+.page
+.page
+.page'
+
+printf '%s\n' "$input" | "$groff" -Z -T ascii > "$dir"/links.grout \
+  || exit 99
+
+"$grotty" -F "$builddir/font" -F "$srcdir/font" "$dir"/links.grout \
+  > "$dir"/expected 2> "$dir"/expected-errors || exit 99
+
+for jobs in 2 3 7
+do
+  echo "checking that -j $jobs renders hyperlinks across pages the same" \
+    >&2
+  "$grotty" -F "$builddir/font" -F "$srcdir/font" -j $jobs \
+    "$dir"/links.grout > "$dir"/actual 2> "$dir"/actual-errors || wail
+  cmp "$dir"/expected "$dir"/actual || wail
+  cmp "$dir"/expected-errors "$dir"/actual-errors || wail
+done
+
+# Put an invalid command on the first page.  Every process reads that
+# page, but only the one rendering it should complain.
+awk '{ print } /^p/ && !done { print "Q"; done = 1 }' \
+  "$dir"/pages.grout > "$dir"/bad.grout || exit 99
+
+"$grotty" -F "$builddir/font" -F "$srcdir/font" "$dir"/bad.grout \
+  > "$dir"/expected 2> "$dir"/expected-errors || exit 99
+
+echo "checking that -j 3 diagnoses invalid input once" >&2
+"$grotty" -F "$builddir/font" -F "$srcdir/font" -j 3 \
+  "$dir"/bad.grout > "$dir"/actual 2> "$dir"/actual-errors || wail
+cat "$dir"/actual-errors
+cmp "$dir"/expected "$dir"/actual || wail
+cmp "$dir"/expected-errors "$dir"/actual-errors || wail
+test -s "$dir"/actual-errors || wail
+
+cleanup
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
@@ -0,0 +1,69 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+grotty="${abs_top_builddir:-.}/grotty"
+
+fail=
+
+wail () {
+    echo "...FAILED" >&2
+    fail=yes
+}
+
+# Set a color that no character cell uses, then another; write two
+# bold characters, the second of them hyperlinked; and set the default
+# color after the last character cell.
+input="x T utf8
+x res 240 24 40
+x init
+p1
+x font 1 R
+x font 3 B
+f1
+s10
+V40
+H0
+md
+DFd
+mr 65535 0 0
+mr 0 0 65535
+f3
+tA
+x X tty: link http://example.com/
+tB
+x X tty: link
+md
+n40 0
+x trailer
+V2640
+x stop"
+
+output=$(echo "$input" | "$grotty" -F font -F build/font | sed -n 1p)
+expected=$(printf '\033[1;34mA\033]8;;http://example.com/\033\\B')
+expected=$expected$(printf '\033]8;;\033\\\033[0m')
+
+echo "$output" | od -c
+
+echo "checking that renditions change only when a cell needs them," \
+    "in one control sequence" >&2
+test "$output" = "$expected" || wail
+
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=4 tabstop=4 textwidth=72:
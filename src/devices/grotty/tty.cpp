@@ -25,9 +25,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <limits.h> // CHAR_MAX
 #include <locale.h> // setlocale()
-#include <stdio.h> // EOF, FILE, fprintf(), fputs(), printf(),
-		   // putchar(), setbuf(), stderr, stdout
+#include <errno.h>
+#include <stdio.h> // EOF, FILE, fprintf(), fputs(), fwrite(), printf(),
+		   // setbuf(), setvbuf(), sscanf(), stderr, stdout
 #include <stdlib.h> // exit(), EXIT_SUCCESS, getenv(), strtol()
+#include <string.h> // strerror()
 
 // GNU extensions to C standard library
 #include <getopt.h> // getopt_long()
@@ -36,9 +38,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "symbol.h" // prerequisite of color.h
 #include "color.h" // prerequisite of printer.h
 #include "ptable.h"
+#include "stringclass.h"
 
 // libdriver
-#include "driver.h" // interpret_troff_output_file()
+#include "driver.h" // interpret_troff_output_file(), page_jobs
 #include "printer.h" // environment, printer
 
 typedef signed char schar;
@@ -48,8 +51,6 @@ implement_ptable(schar)
 
 extern "C" const char *Version_string;
 
-#define putstring(s) fputs(s, stdout)
-
 #ifndef SHRT_MIN
 #define SHRT_MIN (-32768)
 #endif
@@ -91,7 +92,8 @@ enum {
   CU_MODE = 0x10,
   COLOR_CHANGE = 0x20,
   START_LINE = 0x40,
-  END_LINE = 0x80
+  END_LINE = 0x80,
+  CONTROL_MODE = 0x100	// byte of a control sequence, like OSC 8
 };
 
 // Mode to use for bold-underlining.
@@ -102,19 +104,19 @@ static unsigned char bold_underline_mode;
 #define OSC8 "\033]8"
 #define ST "\033\\"
 
-// SGR handling (ISO 6429)
-#define SGR_BOLD CSI "1m"
-#define SGR_NO_BOLD CSI "22m"
-#define SGR_ITALIC CSI "3m"
-#define SGR_NO_ITALIC CSI "23m"
-#define SGR_UNDERLINE CSI "4m"
-#define SGR_NO_UNDERLINE CSI "24m"
-#define SGR_REVERSE CSI "7m"
-#define SGR_NO_REVERSE CSI "27m"
+// SGR handling (ISO 6429); parameters of 'CSI ... m'
+#define SGR_BOLD "1"
+#define SGR_NO_BOLD "22"
+#define SGR_ITALIC "3"
+#define SGR_NO_ITALIC "23"
+#define SGR_UNDERLINE "4"
+#define SGR_NO_UNDERLINE "24"
+#define SGR_REVERSE "7"
+#define SGR_NO_REVERSE "27"
 // many terminals can't handle 'CSI 39 m' and 'CSI 49 m' to reset
 // the foreground and background color, respectively; we thus use
 // 'CSI 0 m' exclusively
-#define SGR_DEFAULT CSI "0m"
+#define SGR_DEFAULT "0"
 
 const int DEFAULT_COLOR_IDX = -1;
 
@@ -180,7 +182,7 @@ public:
   int w;
   int hpos;
   unsigned int code;
-  unsigned char mode;
+  unsigned int mode;
   long back_color_idx;
   long fore_color_idx;
   inline int draw_mode() { return mode & (VDRAW_MODE|HDRAW_MODE); }
@@ -194,17 +196,25 @@ class tty_printer : public printer {
   int nlines;
   int cached_v;
   int cached_vpos;
+  // The renditions the next character cell should have...
   long curr_fore_idx;
   long curr_back_idx;
   bool is_underlining;
   bool is_boldfacing;
+  // ...and those the terminal has been told of.
+  long sgr_fore_idx;
+  long sgr_back_idx;
+  bool is_sgr_underlining;
+  bool is_sgr_boldfacing;
   bool is_continuously_underlining;
+  bool is_link_active;
+  string output;		// the page being written
   PTABLE(schar) tty_colors;
   void make_underline(int);
   void make_bold(output_character, int);
   long color_to_idx(color *);
   void add_char(output_character, int, int, int, color *, color *,
-		unsigned char);
+		unsigned int);
   void simple_add_char(const output_character, const environment *);
   char *make_rgb_string(unsigned int, unsigned int, unsigned int);
   bool has_color(unsigned int, unsigned int, unsigned int, long *,
@@ -219,10 +229,15 @@ public:
   void set_char(glyph *, font *, const environment *, int, const char *);
   void draw(int, int *, int, const environment *);
   void special(char *, const environment *, char);
+  void skip_special(char *, const environment *, char);
   void change_color(const environment * const);
   void change_fill_color(const environment * const);
   void put_char(output_character);
-  void put_color(long, int);
+  void put_cell(output_character);
+  void add_sgr_color(string &, long, bool);
+  void update_sgr();
+  void stop_underlining();
+  void write_output();
   void begin_page(int);
   void end_page(int);
   font *make_font(const char *);
@@ -300,6 +315,7 @@ tty_printer::tty_printer() : cached_v(0)
 		   &dummy, 6);
   begin_page(0 /* dummy */);
   is_continuously_underlining = false;
+  is_link_active = false;
 }
 
 tty_printer::~tty_printer()
@@ -313,21 +329,18 @@ void tty_printer::make_underline(int w)
     if (!w)
       warning("can't underline zero-width character");
     else {
-      putchar('_');
-      putchar('\b');
+      output += '_';
+      output += '\b';
     }
   }
-  else {
-    if (!is_underlining) {
-      if (do_sgr_italics)
-	putstring(SGR_ITALIC);
-      else if (do_reverse_video)
-	putstring(SGR_REVERSE);
-      else
-	putstring(SGR_UNDERLINE);
-    }
+  else
     is_underlining = true;
-  }
+}
+
+void tty_printer::stop_underlining()
+{
+  if (!use_overstriking_drawing_scheme)
+    is_underlining = false;
 }
 
 void tty_printer::make_bold(output_character c, int w)
@@ -337,14 +350,11 @@ void tty_printer::make_bold(output_character c, int w)
       warning("can't print zero-width character in bold");
     else {
       put_char(c);
-      putchar('\b');
+      output += '\b';
     }
   }
-  else {
-    if (!is_boldfacing)
-      putstring(SGR_BOLD);
+  else
     is_boldfacing = true;
-  }
 }
 
 long tty_printer::color_to_idx(color *col)
@@ -376,7 +386,7 @@ void tty_printer::set_char(glyph *g, font *f, const environment *env,
 void tty_printer::add_char(output_character c, int w,
 			   int h, int v,
 			   color *fore, color *back,
-			   unsigned char mode)
+			   unsigned int mode)
 {
 #if 0
   // This is too expensive.
@@ -441,18 +451,17 @@ void tty_printer::add_char(output_character c, int w,
 void tty_printer::simple_add_char(const output_character c,
 				  const environment *env)
 {
-  add_char(c, 0, env->hpos, env->vpos, env->col, env->fill, 0U);
+  add_char(c, 0, env->hpos, env->vpos, env->col, env->fill,
+	   CONTROL_MODE);
 }
 
-void tty_printer::special(char *arg, const environment *env, char type)
+// Find the command in `arg`, a device control command of the form
+// "tty: command [argument ...]".  Return a pointer to it and store a
+// pointer to the end of its name in `*endp`.  If the tag isn't 'tty',
+// return a null pointer instead, storing the start and end of the tag
+// in `*tagp` and `*endp`.
+static char *find_tty_command(char *arg, char **tagp, char **endp)
 {
-  if (type == 'u') {
-    add_char(*arg - '0', 0, env->hpos, env->vpos, env->col, env->fill,
-	     CU_MODE);
-    return;
-  }
-  if (type != 'p')
-    return;
   char *p;
   for (p = arg; (*p == ' ') || (*p == '\n'); p++)
     ;
@@ -462,9 +471,9 @@ void tty_printer::special(char *arg, const environment *env, char type)
       p++)
     ;
   if ((*p == '\0') || (strncmp(tag, "tty", p - tag) != 0)) {
-    *p = '\0'; // terminate string at colon
-    error("X command with '%1' tag ignored; expected 'tty'", tag);
-    return;
+    *tagp = tag;
+    *endp = p;
+    return 0 /* nullptr */;
   }
   p++;
   for (; (*p == ' ') || (*p == '\n'); p++)
@@ -472,6 +481,27 @@ void tty_printer::special(char *arg, const environment *env, char type)
   char *command = p;
   for (; (*p != '\0') && (*p != ' ') && (*p != '\n'); p++)
     ;
+  *endp = p;
+  return command;
+}
+
+void tty_printer::special(char *arg, const environment *env, char type)
+{
+  if (type == 'u') {
+    add_char(*arg - '0', 0, env->hpos, env->vpos, env->col, env->fill,
+	     CU_MODE);
+    return;
+  }
+  if (type != 'p')
+    return;
+  char *tag;
+  char *p;
+  char *command = find_tty_command(arg, &tag, &p);
+  if (0 /* nullptr */ == command) {
+    *p = '\0'; // terminate string at colon
+    error("X command with '%1' tag ignored; expected 'tty'", tag);
+    return;
+  }
   if (*command == '\0') {
     error("empty X command ignored");
     return;
@@ -482,6 +512,24 @@ void tty_printer::special(char *arg, const environment *env, char type)
     warning("unrecognized X command '%1' ignored", command);
 }
 
+// A page rendered by another process may start or end a hyperlink;
+// keep track, so that we diagnose and recover from unbalanced ones on
+// our pages as a sequential run would.
+void tty_printer::skip_special(char *arg, const environment *,
+			       char type)
+{
+  if ((type != 'p') || use_overstriking_drawing_scheme)
+    return;
+  char *tag;
+  char *p;
+  char *command = find_tty_command(arg, &tag, &p);
+  if ((0 /* nullptr */ == command) || (*command == '\0')
+      || (strncmp(command, "link", p - command) != 0))
+    return;
+  // As in special_link(), any argument starts a hyperlink.
+  is_link_active = ((*p != '\0') && (*p != '\n'));
+}
+
 // Produce an OSC 8 hyperlink.  Given ditroff input of the form:
 //   x X tty: link [URI[ KEY=VALUE] ...]
 // produce "OSC 8 [;KEY=VALUE];[URI] ST".  KEY/VALUE pairs can be
@@ -490,7 +538,6 @@ void tty_printer::special(char *arg, const environment *env, char type)
 // <https://gist.github.com/egmontkob/eb114294efbcd5adb1944c9f3cb5feda>.
 void tty_printer::special_link(const char *arg, const environment *env)
 {
-  static bool is_link_active = false;
   if (use_overstriking_drawing_scheme)
     return;
   for (const char *s = OSC8; *s != '\0'; s++)
@@ -715,61 +762,112 @@ void tty_printer::put_char(output_character wc)
 					| 0x80);
       while (count > 0);
     *++p = '\0';
-    putstring(buf);
+    output += buf;
   }
   else
-    putchar(wc);
+    output += char(wc);
 }
 
-void tty_printer::put_color(long color_index, int back)
+// Write a character cell, with the renditions it should have.
+
+void tty_printer::put_cell(output_character wc)
 {
+  update_sgr();
+  put_char(wc);
+}
+
+static void add_sgr_parameter(string &params, const char *p)
+{
+  if (!params.empty())
+    params += ';';
+  params += p;
+}
+
+void tty_printer::add_sgr_color(string &params, long color_index,
+				bool back)
+{
+  assert(color_index != DEFAULT_COLOR_IDX);
+  const size_t buflen = sizeof "48;2;255;255;255";
+  char buf[buflen];
   if (!want_sgr_truecolor) {
-    if (DEFAULT_COLOR_IDX == color_index) {
-      putstring(SGR_DEFAULT);
-      // set bold and underline again
-      if (is_boldfacing)
-        putstring(SGR_BOLD);
-      if (is_underlining) {
-        if (do_sgr_italics)
-          putstring(SGR_ITALIC);
-        else if (do_reverse_video)
-          putstring(SGR_REVERSE);
-        else
-          putstring(SGR_UNDERLINE);
-      }
-      // set other color again
-      back = !back;
-      color_index = back ? curr_back_idx : curr_fore_idx;
-    }
-    if (color_index != DEFAULT_COLOR_IDX) {
-      putstring(CSI);
-      if (back)
-        putchar('4');
-      else
-        putchar('3');
-      putchar(color_index + '0');
-      putchar('m');
-    }
+    buf[0] = back ? '4' : '3';
+    buf[1] = char(color_index + '0');
+    buf[2] = '\0';
   }
   else {
-    if (DEFAULT_COLOR_IDX == color_index) {
-      putstring(SGR_DEFAULT);
-      back = !back;
-      color_index = back ? curr_back_idx : curr_fore_idx;
-      if (DEFAULT_COLOR_IDX == color_index)
-	return;
-    }
-    putstring(CSI);
-    int fb = back ? 48 : 38;
-    const size_t buflen = sizeof "48;2;255;255;255m";
-    char buf[buflen];
-    size_t written = snprintf(buf, buflen, "%d;2;%lu;%lu;%lum", fb,
+    size_t written = snprintf(buf, buflen, "%d;2;%lu;%lu;%lu",
+			      back ? 48 : 38,
 			      (color_index >> 16),
 			      ((color_index >> 8) & 0xff),
 			      (color_index & 0xff));
     assert(written < buflen);
-    putstring(buf);
   }
+  add_sgr_parameter(params, buf);
+}
+
+// Bring the terminal's renditions up to date with those the next
+// character cell should have, in one control sequence.  Renditions
+// that change again before any cell is written cost nothing.
+
+void tty_printer::update_sgr()
+{
+  if (use_overstriking_drawing_scheme
+      || ((is_boldfacing == is_sgr_boldfacing)
+	  && (is_underlining == is_sgr_underlining)
+	  && (curr_fore_idx == sgr_fore_idx)
+	  && (curr_back_idx == sgr_back_idx)))
+    return;
+  string params;
+  if (((DEFAULT_COLOR_IDX == curr_fore_idx)
+       && (sgr_fore_idx != DEFAULT_COLOR_IDX))
+      || ((DEFAULT_COLOR_IDX == curr_back_idx)
+	  && (sgr_back_idx != DEFAULT_COLOR_IDX))) {
+    add_sgr_parameter(params, SGR_DEFAULT);
+    is_sgr_boldfacing = false;
+    is_sgr_underlining = false;
+    sgr_fore_idx = DEFAULT_COLOR_IDX;
+    sgr_back_idx = DEFAULT_COLOR_IDX;
+  }
+  if (is_boldfacing != is_sgr_boldfacing) {
+    add_sgr_parameter(params, is_boldfacing ? SGR_BOLD : SGR_NO_BOLD);
+    is_sgr_boldfacing = is_boldfacing;
+  }
+  if (is_underlining != is_sgr_underlining) {
+    if (do_sgr_italics)
+      add_sgr_parameter(params, is_underlining ? SGR_ITALIC
+					       : SGR_NO_ITALIC);
+    else if (do_reverse_video)
+      add_sgr_parameter(params, is_underlining ? SGR_REVERSE
+					       : SGR_NO_REVERSE);
+    else
+      add_sgr_parameter(params, is_underlining ? SGR_UNDERLINE
+					       : SGR_NO_UNDERLINE);
+    is_sgr_underlining = is_underlining;
+  }
+  if (curr_fore_idx != sgr_fore_idx) {
+    add_sgr_color(params, curr_fore_idx, false);
+    sgr_fore_idx = curr_fore_idx;
+  }
+  if (curr_back_idx != sgr_back_idx) {
+    add_sgr_color(params, curr_back_idx, true);
+    sgr_back_idx = curr_back_idx;
+  }
+  if (!params.empty()) {
+    output += CSI;
+    output += params;
+    output += 'm';
+  }
+}
+
+// Write the page in one piece, so that a pager reading a long document
+// wakes once per page rather than once per stdio buffer.
+
+void tty_printer::write_output()
+{
+  size_t len = output.length();
+  if (fwrite(output.contents(), 1, len, stdout) != len)
+    fatal("cannot write output: %1", strerror(errno));
+  output.clear();
 }
 
 // We could make this 70 where ISO paper formats are used.
@@ -835,13 +933,18 @@ void tty_printer::end_page(int page_length)
     curr_back_idx = DEFAULT_COLOR_IDX;
     is_underlining = false;
     is_boldfacing = false;
+    sgr_fore_idx = DEFAULT_COLOR_IDX;
+    sgr_back_idx = DEFAULT_COLOR_IDX;
+    is_sgr_underlining = false;
+    is_sgr_boldfacing = false;
     for (p = g; p; delete p, p = nextp) {
       nextp = p->next;
       if (p->mode & CU_MODE) {
 	is_continuously_underlining = (p->code != 0);
 	continue;
       }
-      if (nextp && p->hpos == nextp->hpos) {
+      if (nextp && p->hpos == nextp->hpos
+	  && !(p->mode & CONTROL_MODE)) {
 	// We expect HDRAW_MODE glyphs to always precede VDRAW_MODEs.
 	assert (!(p->draw_mode() == VDRAW_MODE
 		  && nextp->draw_mode() == HDRAW_MODE));
@@ -866,7 +969,7 @@ void tty_printer::end_page(int page_length)
       }
       if (hpos > p->hpos) {
 	do {
-	  putchar('\b');
+	  output += '\b';
 	  hpos--;
 	} while (hpos > p->hpos);
       }
@@ -878,98 +981,67 @@ void tty_printer::end_page(int page_length)
 	      break;
 	    if (is_continuously_underlining)
 	      make_underline(p->w);
-	    else if (!use_overstriking_drawing_scheme
-		     && is_underlining) {
-	      if (do_sgr_italics)
-		putstring(SGR_NO_ITALIC);
-	      else if (do_reverse_video)
-		putstring(SGR_NO_REVERSE);
-	      else
-		putstring(SGR_NO_UNDERLINE);
-	      is_underlining = false;
-	    }
+	    else
+	      stop_underlining();
 	    if ((next_tab_pos - hpos) > 1)
-	      putchar('\t');
+	      put_cell('\t');
 	    else
-	      putchar(' ');
+	      put_cell(' ');
 	    hpos = next_tab_pos;
 	  }
 	}
 	for (; hpos < p->hpos; hpos++) {
 	  if (is_continuously_underlining)
 	    make_underline(p->w);
-	  else if (!use_overstriking_drawing_scheme && is_underlining) {
-	    if (do_sgr_italics)
-	      putstring(SGR_NO_ITALIC);
-	    else if (do_reverse_video)
-	      putstring(SGR_NO_REVERSE);
-	    else
-	      putstring(SGR_NO_UNDERLINE);
-	    is_underlining = false;
-	  }
-	  putchar(' ');
+	  else
+	    stop_underlining();
+	  put_cell(' ');
 	}
       }
       assert(hpos == p->hpos);
+      // Control sequences occupy no cell and leave renditions alone.
+      if (p->mode & CONTROL_MODE) {
+	put_char(p->code);
+	continue;
+      }
       if (p->mode & COLOR_CHANGE) {
 	if (!use_overstriking_drawing_scheme) {
-	  if (p->fore_color_idx != curr_fore_idx) {
-	    put_color(p->fore_color_idx, 0);
-	    curr_fore_idx = p->fore_color_idx;
-	  }
-	  if (p->back_color_idx != curr_back_idx) {
-	    put_color(p->back_color_idx, 1);
-	    curr_back_idx = p->back_color_idx;
-	  }
+	  curr_fore_idx = p->fore_color_idx;
+	  curr_back_idx = p->back_color_idx;
 	}
 	continue;
       }
       if (p->mode & UNDERLINE_MODE)
 	make_underline(p->w);
-      else if (!use_overstriking_drawing_scheme && is_underlining) {
-	if (do_sgr_italics)
-	  putstring(SGR_NO_ITALIC);
-	else if (do_reverse_video)
-	  putstring(SGR_NO_REVERSE);
-	else
-	  putstring(SGR_NO_UNDERLINE);
-	is_underlining = false;
-      }
+      else
+	stop_underlining();
       if (p->mode & BOLD_MODE)
 	make_bold(p->code, p->w);
-      else if (!use_overstriking_drawing_scheme && is_boldfacing) {
-	putstring(SGR_NO_BOLD);
+      else
 	is_boldfacing = false;
-      }
       if (!use_overstriking_drawing_scheme) {
-	if (p->fore_color_idx != curr_fore_idx) {
-	  put_color(p->fore_color_idx, 0);
-	  curr_fore_idx = p->fore_color_idx;
-	}
-	if (p->back_color_idx != curr_back_idx) {
-	  put_color(p->back_color_idx, 1);
-	  curr_back_idx = p->back_color_idx;
-	}
+	curr_fore_idx = p->fore_color_idx;
+	curr_back_idx = p->back_color_idx;
       }
-      put_char(p->code);
+      put_cell(p->code);
       hpos += p->w / font::hor;
     }
-    if (!use_overstriking_drawing_scheme
-	&& (is_boldfacing || is_underlining
-	    || curr_fore_idx != DEFAULT_COLOR_IDX
-	    || curr_back_idx != DEFAULT_COLOR_IDX))
-      putstring(SGR_DEFAULT);
-    putchar('\n');
+    if (is_sgr_boldfacing || is_sgr_underlining
+	|| (sgr_fore_idx != DEFAULT_COLOR_IDX)
+	|| (sgr_back_idx != DEFAULT_COLOR_IDX))
+      output += CSI SGR_DEFAULT "m";
+    output += '\n';
   }
   if (want_form_feeds) {
     if (last_line < lines_per_page)
-      putchar('\f');
+      output += '\f';
   }
   else {
     for (; last_line < lines_per_page; last_line++)
-      putchar('\n');
+      output += '\n';
   }
   delete[] lines;
+  write_output();
 }
 
 font *tty_printer::make_font(const char *nm)
@@ -1014,7 +1086,7 @@ int main(int argc, char **argv)
     { "version", no_argument, 0 /* nullptr */, 'v' },
     { 0 /* nullptr */, 0, 0 /* nullptr */, 0 }
   };
-  while ((c = getopt_long(argc, argv, ":bBcdfF:hiI:ortuUv",
+  while ((c = getopt_long(argc, argv, ":bBcdfF:hiI:j:ortuUv",
 			  long_options, 0 /* nullptr */))
 	 != EOF)
     switch (c) {
@@ -1029,6 +1101,14 @@ int main(int argc, char **argv)
     case 'I':
       // ignore include search path
       break;
+    case 'j':
+      // Render pages in this many processes.
+      if (sscanf(optarg, "%d", &page_jobs) != 1 || page_jobs <= 0) {
+	error("expected positive integer argument to '-j' option, got"
+	      " '%1'; ignoring", optarg);
+	page_jobs = 1;
+      }
+      break;
     case 'b':
       // Do not embolden by overstriking.
       want_emboldening_by_overstriking = false;
@@ -1098,6 +1178,8 @@ int main(int argc, char **argv)
       assert(0 == "unhandled getopt_long return value");
     }
   update_options();
+  // tty_printer::write_output() buffers whole pages itself.
+  setvbuf(stdout, 0 /* nullptr */, _IONBF, 0);
   if (optind >= argc)
     interpret_troff_output_file("-");
   else {
@@ -1110,8 +1192,8 @@ int main(int argc, char **argv)
 static void usage(FILE *stream)
 {
   fprintf(stream,
-"usage: %s [-dfhot] [-i|-r] [-F font-directory] [file ...]\n"
-"usage: %s -c [-bBdfhouU] [-F font-directory] [file ...]\n"
+"usage: %s [-dfhot] [-i|-r] [-F font-directory] [-j jobs] [file ...]\n"
+"usage: %s -c [-bBdfhouU] [-F font-directory] [-j jobs] [file ...]\n"
 "usage: %s {-v | --version}\n"
 "usage: %s --help\n",
 	  program_name, program_name, program_name, program_name);
@@ -0,0 +1,65 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// Subsystems to which libgroff's replacement `operator new` (new.cpp)
+// attributes allocations when accounting for them; see
+// GROFF_ALLOCATION_REPORT in groff(1).  Other builds ignore these.
+
+enum allocation_category {
+  ALLOCATION_OTHER,
+  ALLOCATION_NODE,		// troff nodes
+  ALLOCATION_MACRO,		// troff macro, string, and argument storage
+  ALLOCATION_FONT,		// font and device description data
+  ALLOCATION_SYMBOL,		// symbol table
+  ALLOCATION_GLYPH,		// glyph indexer (chiefly output drivers)
+  ALLOCATION_CATEGORIES		// count of the above
+};
+
+extern allocation_category current_allocation_category;
+
+// Attribute allocations to a category for the lifetime of an object of
+// this class.
+
+class allocation_scope {
+  allocation_category saved;
+public:
+  allocation_scope(allocation_category c)
+  : saved(current_allocation_category)
+  {
+    current_allocation_category = c;
+  }
+  ~allocation_scope()
+  {
+    current_allocation_category = saved;
+  }
+};
+
+// Allocate `size` bytes with operator new, attributing them to
+// `category`, and release such storage.  A class can forward its own
+// operator new and operator delete to these.  Keeping both out of line
+// spares the compiler from pairing an inlined global operator delete
+// with the class's operator new (-Wmismatched-new-delete).
+
+void *allocate_in_category(size_t /* size */,
+			   allocation_category /* category */);
+void deallocate(void *);
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
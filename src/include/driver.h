@@ -21,6 +21,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 void interpret_troff_output_file(const char *);
 
+// If greater than 1, interpret_troff_output_file() renders the pages
+// of a document in up to this many processes at once.  A driver may
+// set it only if its printer writes nothing but its pages, in order,
+// and their rendering depends on no state that earlier pages change
+// other than the environment, the mounted fonts, and whatever the
+// printer follows in its skip_special() member function.
+extern int page_jobs;
+
 // Local Variables:
 // fill-column: 72
 // mode: C++
@@ -93,6 +93,7 @@ inline int glyph_to_index(glyph *g)
 struct font_kern_list;
 struct font_char_metric;
 struct font_widths_cache;
+class font_cache_reader;
 
 // A 'class font' instance represents the relevant information of a font of
 // the given device.  This includes the set of glyphs represented by the
@@ -323,6 +324,13 @@ private:
   void extend_ch();
   void compact();
 
+  // These methods restore a font from the cache file (arg3) recorded
+  // for its description file (arg1, located at arg2) by load().
+  bool load_cache(FILE *, const char *, const char *);
+  bool replay_cache(font_cache_reader &,	// reader
+		    const char *,		// path
+		    bool);			// want_effect
+
   void add_kern(glyph *, glyph *, int);	// Add to the kerning table a
 			// kerning amount (arg3) between two given glyphs
 			// (arg1 and arg2).
@@ -0,0 +1,69 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// Binary form of the device-independent output language (groff_out(5)).
+//
+// The command set and layout are unchanged; only integer arguments
+// differ.  Each is written as a length byte from 1 to 4 followed by
+// that many bytes of the value in two's complement, least significant
+// byte first.  Since the length bytes are control characters that
+// cannot begin a decimal integer, a reader can accept either form
+// wherever it expects an integer.  The first line of a binary file is
+// the comment GROUT_BINARY_MAGIC, so tools can tell the forms apart.
+
+#define GROUT_BINARY_MAGIC "# groff binary intermediate output\n"
+
+// An encoded integer occupies at most this many bytes.
+const int GROUT_INT_MAX_LEN = 5;
+
+inline bool grout_is_int_prefix(int c)
+{
+  return (c >= 1) && (c <= 4);
+}
+
+// Store the encoding of `n` in `buf`; return its length.
+inline int grout_encode_int(int n, unsigned char *buf)
+{
+  int len = 1;
+  while ((len < 4) && ((n < -(1 << (8 * len - 1)))
+		       || (n >= (1 << (8 * len - 1)))))
+    len++;
+  buf[0] = (unsigned char) len;
+  unsigned int u = (unsigned int) n;
+  for (int i = 1; i <= len; i++) {
+    buf[i] = (unsigned char) (u & 0xff);
+    u >>= 8;
+  }
+  return len + 1;
+}
+
+// Decode the `len` value bytes at `buf` (the length byte excluded).
+inline int grout_decode_int(const unsigned char *buf, int len)
+{
+  unsigned int u = 0;
+  for (int i = len - 1; i >= 0; i--)
+    u = (u << 8) | buf[i];
+  if ((len < 4) && (buf[len - 1] & 0x80))
+    u |= ~0U << (8 * len);
+  return (int) u;
+}
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
@@ -67,6 +67,8 @@ public:
   virtual font *make_font(const char *);
   virtual void end_of_line();
   virtual void special(char *, const environment *, char = 'p');
+  // follow a device control command on a page that isn't rendered
+  virtual void skip_special(char *, const environment *, char = 'p');
   virtual void devtag(char *, const environment *, char = 'p');
 
 protected:
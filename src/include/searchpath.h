@@ -30,6 +30,10 @@ public:
 			     const char * = 0 /* nullptr */);
 };
 
+// Note in the render cache's dependency log, if any, that the named
+// environment variable was read.
+void note_environment_lookup(const char * /* name */);
+
 // Local Variables:
 // fill-column: 72
 // mode: C++
@@ -29,6 +29,10 @@ with this program.  If not, see <http://www.gnu.org/licenses/>.
    device-independent troff output.
 
    See driver.h and error.h for an overview of the interface.
+
+   Integer arguments are also accepted in the binary encoding that
+   'troff -B' writes (see grout.h), so both forms of the output, or
+   a mixture of them, are read transparently.
 */
 
 /* Changes of the 2001 rewrite of this file.
@@ -237,15 +241,33 @@ with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <ctype.h> // isdigit()
 #include <errno.h>
-#include <stdio.h> // EOF, FILE, fclose(), fopen(), getc(), stdin,
-		   // ungetc()
-#include <stdlib.h> // strtol()
-#include <string.h> // strcmp(), strlen(), strncmp(), strncpy()
+#include <limits.h> // INT_MAX
+#include <stdio.h> // EOF, FILE, fclose(), fflush(), fopen(), fread(),
+		   // fwrite(), getc(), rewind(), stdin, stdout,
+		   // tmpfile(), ungetc()
+#include <stdlib.h> // exit(), EXIT_FAILURE, EXIT_SUCCESS, strtol()
+#include <string.h> // strcmp(), strerror(), strlen(), strncmp(),
+		    // strncpy()
+
+// operating system services
+#include "posix.h" // dup2(), fork(), fstat(), _exit(), S_ISREG(),
+		   // unlink()
+#include "nonposix.h"
+
+// Rendering pages in parallel forks a process for each range of pages.
+#if defined(__MSDOS__) || defined(_WIN32)
+# define MAY_FORK_PAGE_JOBS 0
+#else
+# define MAY_FORK_PAGE_JOBS 1
+# include <sys/wait.h> // waitpid(), WEXITSTATUS(), WIFEXITED()
+#endif
 
 // libgroff
 #include "symbol.h" // prerequisite of color.h
 #include "color.h"
 #include "device.h"
+#include "grout.h" // grout_is_int_prefix(), grout_decode_int()
+#include "lib.h" // xtmptemplate()
 
 // libdriver
 #include "driver.h" // interpret_troff_output_file()
@@ -365,6 +387,18 @@ FILE *current_file = 0;		// current input stream for parser
 //         _not_ the page number in the printout (can be set with 'p').
 int npages = 0;
 
+// The range of pages, counted like `npages`, passed to the printer.
+// Outside it, commands are interpreted only to keep the environment
+// current.  See render_pages_in_parallel().
+static int first_rendered_page = 1;
+static int last_rendered_page = INT_MAX;
+static bool is_rendering = true; // whether the current page is in range
+
+// Diagnostics about pages before the range are left to whoever renders
+// them, so that each is issued once.  While they are muted, this
+// holds a duplicate of the standard error stream's descriptor.
+static int saved_stderr_fd = -1;
+
 const ColorArg
 COLORARG_MAX = (ColorArg) 65536U; // == 0xFFFF + 1 == 0x10000
 
@@ -401,10 +435,13 @@ IntArray *get_D_fixed_args_odd_dummy(const size_t);
 IntArray *get_D_variable_args(void);
                                 // variable, even number of int args
 char *get_extended_arg(void);	// argument for 'x X' (several lines)
+IntArg get_binary_integer_arg(const Char);
+				// read in binary-encoded integer
 IntArg get_integer_arg(void);	// read in next integer argument
 IntArray *get_possibly_integer_args();
 				// 0 or more integer arguments
 char *get_string_arg(void);	// read in next string arg, ended by WS
+void skip_string_arg(void);	// skip next string arg, ended by WS
 inline bool is_space_or_tab(const Char);
 				// test on space/tab char
 Char next_arg_begin(void);	// skip whitespace on current line
@@ -773,12 +810,36 @@ get_extended_arg(void)
   return buf.make_string();
 }
 
+//////////////////////////////////////////////////////////////////////
+/*
+   Retrieve the value bytes of a binary-encoded integer argument.
+
+   len: In-parameter, the length byte that introduced the argument.
+
+   Fatal error if the input ends prematurely.
+
+   Return: Retrieved integer.
+*/
+IntArg
+get_binary_integer_arg(const Char len)
+{
+  unsigned char buf[GROUT_INT_MAX_LEN];
+  for (int i = 0; i < (int) len; i++) {
+    int c = getc(current_file);
+    if (EOF == c)
+      fatal("truncated binary integer argument");
+    buf[i] = (unsigned char) c;
+  }
+  return (IntArg) grout_decode_int(buf, (int) len);
+}
+
 //////////////////////////////////////////////////////////////////////
 /*
 
    Skip leading spaces and tabs, collect an optional '-' and all
    following decimal digits (at least one) up to the next non-digit,
-   which is restored onto the input queue.
+   which is restored onto the input queue.  Alternatively, read a
+   binary-encoded integer.
 
    Fatal error on all other situations.
 
@@ -787,8 +848,10 @@ get_extended_arg(void)
 IntArg
 get_integer_arg(void)
 {
-  StringBuf buf = StringBuf();
   Char c = next_arg_begin();
+  if (grout_is_int_prefix((int) c))
+    return get_binary_integer_arg(c);
+  StringBuf buf = StringBuf();
   if ((int) c == '-') {
     buf.append(c);
     c = get_char();
@@ -821,6 +884,7 @@ get_integer_arg(void)
    current line, even none.
    - The arguments are separated by an arbitrary sequence of space or
      tab characters.
+   - Each argument is decimal or binary-encoded.
    - A comment, a newline, or EOF indicates the end of processing.
    - Error on non-digit characters different from these.
    - No line skip is performed.
@@ -838,7 +902,11 @@ get_possibly_integer_args()
     buf.reset();
     while (is_space_or_tab(c))
       c = get_char();
-    if (c == '-') {
+    if (grout_is_int_prefix((int) c)) {
+      args->append(get_binary_integer_arg(c));
+      c = get_char();
+    }
+    else if (c == '-') {
       Char c1 = get_char();
       if (isdigit((int) c1)) {
 	buf.append(c);
@@ -916,6 +984,55 @@ get_string_arg(void)
   return buf.make_string();
 }
 
+//////////////////////////////////////////////////////////////////////
+/*
+   Discard diagnostics until unmute_diagnostics() is called.
+*/
+static void
+mute_diagnostics(void)
+{
+  if (saved_stderr_fd >= 0)
+    return;
+  FILE *null = fopen("/dev/null", "w");
+  if (0 /* nullptr */ == null)
+    return;
+  fflush(stderr);
+  saved_stderr_fd = dup(STDERR_FILENO);
+  if (saved_stderr_fd >= 0)
+    (void) dup2(fileno(null), STDERR_FILENO);
+  fclose(null);
+}
+
+//////////////////////////////////////////////////////////////////////
+/*
+   Issue diagnostics again after mute_diagnostics().
+*/
+static void
+unmute_diagnostics(void)
+{
+  if (saved_stderr_fd < 0)
+    return;
+  fflush(stderr);
+  (void) dup2(saved_stderr_fd, STDERR_FILENO);
+  close(saved_stderr_fd);
+  saved_stderr_fd = -1;
+}
+
+//////////////////////////////////////////////////////////////////////
+/*
+   Skip the next string argument, like get_string_arg() but without
+   storing it.
+*/
+void
+skip_string_arg(void)
+{
+  Char c = next_arg_begin();
+  while (!is_space_or_tab(c)
+	 && c != Char('\n') && c != Char(EOF))
+    c = get_char();
+  unget_char(c);		// restore whitespace
+}
+
 //////////////////////////////////////////////////////////////////////
 /*
    Test a character if it is a space or tab.
@@ -1087,7 +1204,8 @@ void
 send_draw(const Char subcmd, const IntArray * const args)
 {
   EnvInt n = (EnvInt) args->len();
-  pr->draw((int) subcmd, (IntArg *)args->get_data(), n, current_env);
+  if (is_rendering)
+    pr->draw((int) subcmd, (IntArg *)args->get_data(), n, current_env);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -1383,7 +1501,8 @@ parse_D_command()
 	delete current_env->fill;
 	current_env->fill = new color(current_env->col);
       }
-      pr->change_fill_color(current_env);
+      if (is_rendering)
+	pr->change_fill_color(current_env);
       // skip unused 'vertical' component (\D'...' always emits pairs)
       (void) get_integer_arg();
 #   ifdef STUPID_DRAWING_POSITIONING
@@ -1394,7 +1513,8 @@ parse_D_command()
     }
   case 'F':			// DF: set fill color, several formats
     parse_color_command(current_env->fill);
-    pr->change_fill_color(current_env);
+    if (is_rendering)
+      pr->change_fill_color(current_env);
     // no positioning (setting-only command)
     skip_line_x();
     break;
@@ -1513,7 +1633,8 @@ parse_x_command(void)
   case 'u':			// x underline: from .cu
     {
       char *str_arg = get_string_arg();
-      pr->special(str_arg, current_env, 'u');
+      if (is_rendering)
+	pr->special(str_arg, current_env, 'u');
       delete[] str_arg;
       skip_line_x();
       break;
@@ -1523,6 +1644,8 @@ parse_x_command(void)
       char *str_arg = get_extended_arg(); // includes line skip
       if (npages <= 0)
 	error("'x X' command invalid before first 'p' command");
+      else if (!is_rendering)
+	pr->skip_special(str_arg, current_env);
       else if (str_arg && (strncmp(str_arg, "devtag:",
 				   strlen("devtag:")) == 0))
 	pr->devtag(str_arg, current_env);
@@ -1544,14 +1667,18 @@ parse_x_command(void)
                      exported part (by driver.h)
  **********************************************************************/
 
+int page_jobs = 1;
+
 ////////////////////////////////////////////////////////////////////////
 /*
-   Interpret the output of a device-independent troff.
+   Interpret the output of a device-independent troff from `fp`,
+   passing pages from `first_rendered_page` to `last_rendered_page` to
+   the printer.
 
-   filename: "-" for standard input, normal file name otherwise
+   filename: name of the file for diagnostics
 */
-void
-interpret_troff_output_file(const char *filename)
+static void
+interpret_troff_output(FILE *fp, const char *filename)
 {
   Char command;
   bool stopped = false;		// terminating condition
@@ -1563,19 +1690,13 @@ interpret_troff_output_file(const char *filename)
   // setup of global variables
   npages = 0;
   current_lineno = 1;
+  is_rendering = (first_rendered_page <= 1);
+  if (!is_rendering)
+    mute_diagnostics();
   // 'pr' is initialized after the prologue.
   // 'device' is set by the 1st prologue command.
 
-  if (filename[0] == '-' && filename[1] == '\0')
-    current_file = stdin;
-  else {
-    errno = 0;
-    current_file = fopen(filename, "r");
-    if (errno != 0 || current_file == 0) {
-      error("can't open file '%1'", filename);
-      return;
-    }
-  }
+  current_file = fp;
   remember_filename(filename);
 
   if (current_env != 0)
@@ -1702,7 +1823,7 @@ interpret_troff_output_file(const char *filename)
 	c = next_arg_begin();
 	if ((int) c == '\n' || (int) c == EOF)
 	  error("character argument expected");
-	else
+	else if (is_rendering)
 	  pr->set_ascii_char((unsigned char) c, current_env);
 	break;
       }
@@ -1713,7 +1834,7 @@ interpret_troff_output_file(const char *filename)
 	Char c = next_arg_begin();
 	if (c == '\n' || c == EOF)
 	  error("missing argument to 'c' command");
-	else
+	else if (is_rendering)
 	  pr->set_ascii_char((unsigned char) c, current_env);
 	break;
       }
@@ -1721,6 +1842,10 @@ interpret_troff_output_file(const char *filename)
       {
 	if (npages <= 0)
 	  fatal_command(command);
+	if (!is_rendering) {
+	  skip_string_arg();
+	  break;
+	}
 	char *str_arg = get_string_arg();
 	pr->set_special_char(str_arg, current_env);
 	delete[] str_arg;
@@ -1753,26 +1878,45 @@ interpret_troff_output_file(const char *filename)
       break;
     case 'm':			// m: stroke color
       parse_color_command(current_env->col);
-      pr->change_color(current_env);
+      if (is_rendering)
+	pr->change_color(current_env);
       break;
     case 'n':			// n: print end of line
 				// ignore two arguments (historically)
       if (npages <= 0)
 	fatal_command(command);
-      pr->end_of_line();
+      if (is_rendering)
+	pr->end_of_line();
       (void) get_integer_arg();
       (void) get_integer_arg();
       break;
     case 'N':			// N: print char with given int code
       if (npages <= 0)
 	fatal_command(command);
-      pr->set_numbered_char(get_integer_arg(), current_env);
+      {
+	IntArg n = get_integer_arg();
+	if (is_rendering)
+	  pr->set_numbered_char(n, current_env);
+      }
       break;
     case 'p':			// p: start new page with given number
-      if (npages > 0)
+      if ((npages > 0) && is_rendering)
 	pr->end_page(current_env->vpos);
       npages++;			// increment # of processed pages
-      pr->begin_page(get_integer_arg());
+      if (npages > last_rendered_page) {
+	// Leave the rest to whoever renders the following pages.
+	is_rendering = false;
+	stopped = true;
+	break;
+      }
+      is_rendering = (npages >= first_rendered_page);
+      if (is_rendering)
+	unmute_diagnostics();
+      {
+	IntArg n = get_integer_arg();
+	if (is_rendering)
+	  pr->begin_page(n);
+      }
       current_env->vpos = 0;
       break;
     case 's':			// s: set point size
@@ -1785,6 +1929,10 @@ interpret_troff_output_file(const char *filename)
 	char c;
 	if (npages <= 0)
 	  fatal_command(command);
+	if (!is_rendering) {
+	  skip_string_arg();
+	  break;
+	}
 	char *str_arg = get_string_arg();
 	size_t i = 0;
 	while ((c = str_arg[i++]) != '\0') {
@@ -1801,6 +1949,10 @@ interpret_troff_output_file(const char *filename)
 	if (npages <= 0)
 	  fatal_command(command);
 	EnvInt kern = (EnvInt) get_integer_arg();
+	if (!is_rendering) {
+	  skip_string_arg();
+	  break;
+	}
 	char *str_arg = get_string_arg();
 	size_t i = 0;
 	while ((c = str_arg[i++]) != '\0') {
@@ -1834,7 +1986,8 @@ interpret_troff_output_file(const char *filename)
   } // end of while
 
   // end of file reached
-  if (npages > 0)
+  unmute_diagnostics();
+  if ((npages > 0) && is_rendering)
     pr->end_page(current_env->vpos);
   delete pr;
   pr = 0;
@@ -1845,6 +1998,215 @@ interpret_troff_output_file(const char *filename)
   delete_current_env();
 }
 
+#if MAY_FORK_PAGE_JOBS
+// Count the pages of the intermediate output file `fp`, each of which
+// begins with a line starting with a 'p' command; return -1 if the
+// file uses the binary integer encoding, in which a newline byte
+// doesn't necessarily end a line.
+
+static int
+count_pages(FILE *fp)
+{
+  const char *magic = GROUT_BINARY_MAGIC;
+  int n = 0;
+  bool is_line_start = true;
+  size_t magic_matched = 0;
+  bool may_be_binary = true;
+  int c;
+  while ((c = getc(fp)) != EOF) {
+    if (may_be_binary) {
+      if ((unsigned char) magic[magic_matched] == c) {
+	if ('\0' == magic[++magic_matched])
+	  return -1;
+      }
+      else
+	may_be_binary = false;
+    }
+    if (is_line_start && ('p' == c))
+      n++;
+    is_line_start = ('\n' == c);
+  }
+  return n;
+}
+
+// Copy `from` to the end of `to`.
+
+static void
+copy_file(FILE *from, FILE *to)
+{
+  char buf[BUFSIZ];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof buf, from)) > 0)
+    if (fwrite(buf, 1, n, to) != n)
+      fatal("cannot write output: %1", strerror(errno));
+}
+
+// Return a temporary file already unlinked, so that it disappears
+// with the last process to close it.
+
+static FILE *
+open_scratch_file(char **namep)
+{
+  char *templ = xtmptemplate(0 /* nullptr */, 0 /* nullptr */);
+  errno = 0;
+  int fd = mkstemp(templ);
+  if (fd < 0)
+    fatal("cannot create temporary file: %1", strerror(errno));
+  FILE *fp = fdopen(fd, "w+");
+  if (0 /* nullptr */ == fp)
+    fatal("cannot open temporary file: %1", strerror(errno));
+  if (namep != 0 /* nullptr */)
+    *namep = templ;
+  else {
+    unlink(templ);
+    delete[] templ;
+  }
+  return fp;
+}
+
+// Split the pages of intermediate output file `filename` into up to
+// `page_jobs` consecutive ranges and render each in a child process of
+// its own, which writes its output to a scratch file; then copy those
+// to the standard output stream in order.  Each child reads the input
+// from its start, tracking the environment but rendering nothing
+// before its range, and stops after it.  Only printers whose output
+// consists of the pages alone in sequence can work this way.
+//
+// Return false if the input is unsuitable, having fewer than two
+// pages or being in the binary encoding.
+
+static bool
+render_pages_in_parallel(const char *filename)
+{
+  FILE *fp;
+  char *copy_name = 0 /* nullptr */;
+  struct stat st;
+  bool is_stdin = (strcmp(filename, "-") == 0);
+  if (is_stdin)
+    fp = stdin;
+  else {
+    errno = 0;
+    fp = fopen(filename, "r");
+    if (0 /* nullptr */ == fp) {
+      error("can't open file '%1'", filename);
+      return true;
+    }
+  }
+  // Each child needs a stream of its own, so we need a regular file we
+  // can open repeatedly.
+  if (is_stdin || (fstat(fileno(fp), &st) < 0) || !S_ISREG(st.st_mode)) {
+    FILE *copy = open_scratch_file(&copy_name);
+    copy_file(fp, copy);
+    if (!is_stdin)
+      fclose(fp);
+    fp = copy;
+    rewind(fp);
+  }
+  int total_pages = count_pages(fp);
+  fclose(fp);
+  const char *input_name = (copy_name != 0 /* nullptr */) ? copy_name
+							  : filename;
+  if (total_pages < 2) {
+    bool is_done = false;
+    if (copy_name != 0 /* nullptr */) {
+      // We've consumed the standard input stream.
+      errno = 0;
+      fp = fopen(copy_name, "r");
+      if (0 /* nullptr */ == fp)
+	fatal("cannot reopen temporary file: %1", strerror(errno));
+      unlink(copy_name);
+      interpret_troff_output(fp, filename);
+      is_done = true;
+    }
+    delete[] copy_name;
+    return is_done;
+  }
+  int njobs = (page_jobs < total_pages) ? page_jobs : total_pages;
+  FILE **outputs = new FILE *[njobs];
+  pid_t *pids = new pid_t[njobs];
+  for (int k = 0; k < njobs; k++) {
+    errno = 0;
+    FILE *in = fopen(input_name, "r");
+    if (0 /* nullptr */ == in)
+      fatal("cannot open '%1': %2", input_name, strerror(errno));
+    outputs[k] = open_scratch_file(0 /* nullptr */);
+    fflush(stdout);
+    fflush(stderr);
+    pids[k] = fork();
+    if (pids[k] < 0)
+      fatal("cannot fork page rendering process: %1", strerror(errno));
+    if (0 == pids[k]) {
+      first_rendered_page = int((long(total_pages) * k) / njobs) + 1;
+      // The last process renders whatever remains, in case a page
+      // began other than at the start of a line.
+      last_rendered_page = (njobs - 1 == k)
+			   ? INT_MAX
+			   : int((long(total_pages) * (k + 1)) / njobs);
+      if (dup2(fileno(outputs[k]), STDOUT_FILENO) < 0)
+	fatal("cannot redirect output: %1", strerror(errno));
+      interpret_troff_output(in, filename);
+      if (fflush(stdout) < 0)
+	fatal("cannot write output: %1", strerror(errno));
+      fflush(stderr);
+      // Leave the parent's temporary files alone.
+      _exit(EXIT_SUCCESS);
+    }
+    fclose(in);
+  }
+  if (copy_name != 0 /* nullptr */) {
+    unlink(copy_name);
+    delete[] copy_name;
+  }
+  bool has_failed = false;
+  for (int k = 0; k < njobs; k++) {
+    int status;
+    if (waitpid(pids[k], &status, 0) < 0)
+      fatal("cannot wait for page rendering process: %1",
+	    strerror(errno));
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))
+      has_failed = true;
+  }
+  if (has_failed)
+    exit(EXIT_FAILURE);
+  for (int k = 0; k < njobs; k++) {
+    rewind(outputs[k]);
+    copy_file(outputs[k], stdout);
+    fclose(outputs[k]);
+  }
+  delete[] outputs;
+  delete[] pids;
+  return true;
+}
+#endif // MAY_FORK_PAGE_JOBS
+
+////////////////////////////////////////////////////////////////////////
+/*
+   Interpret the output of a device-independent troff, rendering its
+   pages in parallel if the driver has set `page_jobs`.
+
+   filename: "-" for standard input, normal file name otherwise
+*/
+void
+interpret_troff_output_file(const char *filename)
+{
+#if MAY_FORK_PAGE_JOBS
+  if ((page_jobs > 1) && render_pages_in_parallel(filename))
+    return;
+#endif
+  FILE *fp;
+  if (filename[0] == '-' && filename[1] == '\0')
+    fp = stdin;
+  else {
+    errno = 0;
+    fp = fopen(filename, "r");
+    if (errno != 0 || fp == 0) {
+      error("can't open file '%1'", filename);
+      return;
+    }
+  }
+  interpret_troff_output(fp, filename);
+}
+
 // Local Variables:
 // fill-column: 72
 // mode: C++
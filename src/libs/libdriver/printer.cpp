@@ -169,6 +169,10 @@ void printer::special(char *, const environment *, char)
 {
 }
 
+void printer::skip_special(char *, const environment *, char)
+{
+}
+
 void printer::devtag(char *, const environment *, char)
 {
 }
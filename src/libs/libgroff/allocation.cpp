@@ -0,0 +1,45 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stddef.h> // size_t
+
+#include "allocation.h"
+
+// This lives apart from new.cpp, which not every build includes, so
+// that allocation scopes always link.
+allocation_category current_allocation_category = ALLOCATION_OTHER;
+
+void *allocate_in_category(size_t size, allocation_category category)
+{
+  allocation_scope scope(category);
+  return ::operator new(size);
+}
+
+void deallocate(void *p)
+{
+  ::operator delete(p);
+}
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
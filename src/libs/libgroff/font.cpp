@@ -31,14 +31,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <string.h> // strerror()
 #include <wchar.h>
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h> // mmap(), munmap()
+#endif
+
 #include "lib.h"
 
+#include "allocation.h" // allocation_scope
+
 #include "errarg.h"
 #include "error.h"
 #include "cset.h"
 #include "font.h"
 #include "unicode.h"
 #include "paper.h"
+#include "posix.h"
+#include "nonposix.h"
 
 const char *const WS = " \t\n\r";
 
@@ -84,6 +92,7 @@ struct text_file {
   int linebufsize;
   bool recognize_comments;
   bool silent;
+  int error_count;
   char *buf;
   text_file(FILE *fp, char *p);
   ~text_file();
@@ -100,7 +109,7 @@ struct text_file {
 
 text_file::text_file(FILE *p, char *s) : fp(p), path(s), lineno(0),
   linebufsize(128), recognize_comments(true), silent(false),
-  buf(0 /* nullptr */)
+  error_count(0), buf(0 /* nullptr */)
 {
 }
 
@@ -161,6 +170,7 @@ void text_file::error(const char *format,
 		      const errarg &arg2,
 		      const errarg &arg3)
 {
+  error_count++;
   if (!silent)
     error_with_file_and_line(path, lineno, format, arg1, arg2, arg3);
 }
@@ -174,6 +184,305 @@ void text_file::fatal(const char *format,
     fatal_with_file_and_line(path, lineno, format, arg1, arg2, arg3);
 }
 
+/* font cache files */
+
+// If the environment variable GROFF_FONT_CACHE names a directory,
+// font::load() records there, for each font description file it
+// parses without error, the operations that parsing performed:  the
+// glyph names defined, their metrics, kerning pairs, and so on.  A
+// later load of the same file replays the record instead of parsing
+// the text again.  Glyph indices are particular to a process, so the
+// record keeps glyph names rather than indices; replaying it in order
+// assigns the same indices that parsing would.
+//
+// A cache file is used only if it matches this program's layout of
+// integers and the size and modification time of the description
+// file; otherwise it is rewritten.  Integers and strings are stored
+// in native byte order, each string preceded by its length (-1 for a
+// null pointer) and followed by a null byte.
+
+static const char FONT_CACHE_MAGIC[] = "groff font cache 1\n";
+static const int FONT_CACHE_BYTE_ORDER = 0x01020304;
+
+// operations recorded in a cache file
+enum {
+  FONT_CACHE_UNKNOWN = 'U',	// unrecognized directive
+  FONT_CACHE_ENTRY = 'E',	// 'charset' entry
+  FONT_CACHE_ALIAS = 'A',	// 'charset' alias (")
+  FONT_CACHE_KERN = 'K',	// 'kernpairs' entry
+  FONT_CACHE_RANGE = 'R',	// 'charset-range' entry
+  FONT_CACHE_END = 'Z'		// scalar attributes; last in file
+};
+
+// Return the name of the cache file for the font description file at
+// `path`, allocated with malloc(), or a null pointer if caching is off.
+static char *font_cache_file_name(const char *path)
+{
+  const char *dir = getenv("GROFF_FONT_CACHE");
+  if ((0 /* nullptr */ == dir) || ('\0' == *dir))
+    return 0 /* nullptr */;
+  size_t dirlen = strlen(dir);
+  char *name = (char *)malloc(dirlen + 1 + strlen(path) + 1);
+  if (0 /* nullptr */ == name)
+    return 0 /* nullptr */;
+  strcpy(name, dir);
+  char *q = name + dirlen;
+  *q++ = '/';
+  // Flatten the description file's path into a single file name.
+  for (const char *p = path; *p != '\0'; p++)
+    *q++ = (strchr(DIR_SEPS, *p) != 0 /* nullptr */) ? '%' : *p;
+  *q = '\0';
+  return name;
+}
+
+class font_cache_writer {
+  char *file_name;
+  char *buf;
+  size_t used;
+  size_t size;
+  void append(const void *, size_t);
+public:
+  font_cache_writer(char *);
+  ~font_cache_writer();
+  bool is_enabled() { return file_name != 0 /* nullptr */; }
+  const char *get_file_name() { return file_name; }
+  void put_int(int);
+  void put_double(double);
+  void put_string(const char *);
+  void put_metric(const font_char_metric &);
+  void put_header(FILE *, const char *);
+  void write();
+};
+
+// Take ownership of `nm`, which may be a null pointer.
+font_cache_writer::font_cache_writer(char *nm)
+: file_name(nm), buf(0 /* nullptr */), used(0), size(0)
+{
+}
+
+font_cache_writer::~font_cache_writer()
+{
+  free(file_name);
+  delete[] buf;
+}
+
+void font_cache_writer::append(const void *p, size_t n)
+{
+  if (used + n > size) {
+    size_t new_size = (0 == size) ? 4096 : size * 2;
+    while (used + n > new_size)
+      new_size *= 2;
+    char *old_buf = buf;
+    buf = new char[new_size];
+    if (old_buf != 0 /* nullptr */)
+      memcpy(buf, old_buf, used);
+    delete[] old_buf;
+    size = new_size;
+  }
+  memcpy(buf + used, p, n);
+  used += n;
+}
+
+void font_cache_writer::put_int(int n)
+{
+  if (is_enabled())
+    append(&n, sizeof n);
+}
+
+void font_cache_writer::put_double(double d)
+{
+  if (is_enabled())
+    append(&d, sizeof d);
+}
+
+void font_cache_writer::put_string(const char *s)
+{
+  if (!is_enabled())
+    return;
+  if (0 /* nullptr */ == s)
+    put_int(-1);
+  else {
+    size_t len = strlen(s);
+    put_int(int(len));
+    append(s, len + 1);
+  }
+}
+
+void font_cache_writer::put_metric(const font_char_metric &m)
+{
+  put_int(m.type);
+  put_int(m.code);
+  put_int(m.end_code);
+  put_int(m.width);
+  put_int(m.height);
+  put_int(m.depth);
+  put_int(m.pre_math_space);
+  put_int(m.italic_correction);
+  put_int(m.subscript_correction);
+  put_string(m.special_device_coding);
+}
+
+static bool get_file_stamp(FILE *fp, int *stamp)
+{
+  struct stat st;
+  if (fstat(fileno(fp), &st) < 0)
+    return false;
+  long long mtime = (long long) st.st_mtime;
+  stamp[0] = int(st.st_size);
+  stamp[1] = int(mtime & 0xffffffff);
+  stamp[2] = int(mtime >> 32);
+  return true;
+}
+
+// Record what identifies the description file `fp` located at `path`.
+void font_cache_writer::put_header(FILE *fp, const char *path)
+{
+  if (!is_enabled())
+    return;
+  int stamp[3];
+  if (!get_file_stamp(fp, stamp)) {
+    free(file_name);
+    file_name = 0 /* nullptr */;
+    return;
+  }
+  append(FONT_CACHE_MAGIC, sizeof FONT_CACHE_MAGIC);
+  put_int(FONT_CACHE_BYTE_ORDER);
+  for (int i = 0; i < 3; i++)
+    put_int(stamp[i]);
+  put_string(path);
+}
+
+// Write the record to a temporary file and rename it into place, so
+// that concurrent readers never see a partial cache file.  Failure is
+// silent; the description file is simply parsed next time.
+void font_cache_writer::write()
+{
+  if (!is_enabled())
+    return;
+  size_t len = strlen(file_name);
+  char *tem = (char *)malloc(len + sizeof ".tmp" + INT_DIGITS + 1);
+  if (0 /* nullptr */ == tem)
+    return;
+  sprintf(tem, "%s.tmp%d", file_name, int(getpid()));
+  int fd = open(tem, O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0666);
+  if (fd < 0) {
+    free(tem);
+    return;
+  }
+  bool is_written = (::write(fd, buf, used) == ssize_t(used));
+  if ((close(fd) < 0) || !is_written
+      || (rename(tem, file_name) < 0))
+    unlink(tem);
+  free(tem);
+}
+
+class font_cache_reader {
+  const char *p;
+  const char *end;
+public:
+  font_cache_reader(const char *, size_t);
+  bool get_int(int *);
+  bool get_double(double *);
+  bool get_string(const char **);
+  bool get_metric(font_char_metric *);
+  bool has_header(FILE *, const char *);
+  bool is_at_end() { return p == end; }
+};
+
+font_cache_reader::font_cache_reader(const char *start, size_t len)
+: p(start), end(start + len)
+{
+}
+
+bool font_cache_reader::get_int(int *np)
+{
+  if (size_t(end - p) < sizeof *np)
+    return false;
+  memcpy(np, p, sizeof *np);
+  p += sizeof *np;
+  return true;
+}
+
+bool font_cache_reader::get_double(double *dp)
+{
+  if (size_t(end - p) < sizeof *dp)
+    return false;
+  memcpy(dp, p, sizeof *dp);
+  p += sizeof *dp;
+  return true;
+}
+
+// Store a null pointer for a null string; otherwise point into the
+// cache file's contents.
+bool font_cache_reader::get_string(const char **sp)
+{
+  int len;
+  if (!get_int(&len))
+    return false;
+  if (-1 == len) {
+    *sp = 0 /* nullptr */;
+    return true;
+  }
+  if ((len < 0) || (size_t(end - p) <= size_t(len)) || p[len] != '\0')
+    return false;
+  *sp = p;
+  p += len + 1;
+  return true;
+}
+
+// The special device coding is left pointing into the cache file's
+// contents; a caller keeping the metric must copy it.
+bool font_cache_reader::get_metric(font_char_metric *m)
+{
+  int type;
+  if (!get_int(&type) || (type < 0) || (type > 255))
+    return false;
+  m->type = type;
+  const char *coding;
+  if (!get_int(&m->code)
+      || !get_int(&m->end_code)
+      || !get_int(&m->width)
+      || !get_int(&m->height)
+      || !get_int(&m->depth)
+      || !get_int(&m->pre_math_space)
+      || !get_int(&m->italic_correction)
+      || !get_int(&m->subscript_correction)
+      || !get_string(&coding))
+    return false;
+  m->special_device_coding = const_cast<char *>(coding);
+  m->next = 0 /* nullptr */;
+  return true;
+}
+
+bool font_cache_reader::has_header(FILE *fp, const char *path)
+{
+  if ((size_t(end - p) < sizeof FONT_CACHE_MAGIC)
+      || memcmp(p, FONT_CACHE_MAGIC, sizeof FONT_CACHE_MAGIC) != 0)
+    return false;
+  p += sizeof FONT_CACHE_MAGIC;
+  int n;
+  if (!get_int(&n) || (n != FONT_CACHE_BYTE_ORDER))
+    return false;
+  int stamp[3];
+  if (!get_file_stamp(fp, stamp))
+    return false;
+  for (int i = 0; i < 3; i++)
+    if (!get_int(&n) || (n != stamp[i]))
+      return false;
+  const char *s;
+  return get_string(&s) && (s != 0 /* nullptr */)
+	 && (strcmp(s, path) == 0);
+}
+
+static char *copy_string(const char *s)
+{
+  if (0 /* nullptr */ == s)
+    return 0 /* nullptr */;
+  char *t = new char[strlen(s) + 1];
+  strcpy(t, s);
+  return t;
+}
+
 static int glyph_to_ucs_codepoint(glyph *g)
 {
   const char *nm = glyph_to_name(g);
@@ -898,6 +1207,7 @@ again:
 
 bool font::load(bool want_diagnostic, bool validate_only)
 {
+  allocation_scope scope(ALLOCATION_FONT);
   char *path;
   FILE *fp = open_file(filename, &path);
   if (0 /* nullptr */ == fp) {
@@ -906,6 +1216,16 @@ bool font::load(bool want_diagnostic, bool validate_only)
 	    strerror(errno));
     return false;
   }
+  font_cache_writer cache(validate_only ? 0 /* nullptr */
+			   : font_cache_file_name(path));
+  if (cache.is_enabled()) {
+    if (load_cache(fp, path, cache.get_file_name())) {
+      fclose(fp);
+      free(path);
+      return true;
+    }
+    cache.put_header(fp, path);
+  }
   text_file t(fp, path);
   t.silent = validate_only;
   char *p = 0 /* nullptr */;
@@ -995,9 +1315,12 @@ bool font::load(bool want_diagnostic, bool validate_only)
     else if (strcmp(p, "kernpairs") != 0 && strcmp(p, "charset") != 0 &&
              strcmp(p, "charset-range") != 0) {
       char *directive = p;
-      p = strtok(0 /* nullptr */, "\n");
-      handle_unknown_font_command(directive, trim_arg(p), t.path,
-				  t.lineno);
+      char *arg = trim_arg(strtok(0 /* nullptr */, "\n"));
+      handle_unknown_font_command(directive, arg, t.path, t.lineno);
+      cache.put_int(FONT_CACHE_UNKNOWN);
+      cache.put_string(directive);
+      cache.put_string(arg);
+      cache.put_int(t.lineno);
     }
     else
       break;
@@ -1037,6 +1360,10 @@ bool font::load(bool want_diagnostic, bool validate_only)
 	glyph *g1 = name_to_glyph(c1);
 	glyph *g2 = name_to_glyph(c2);
 	add_kern(g1, g2, n);
+	cache.put_int(FONT_CACHE_KERN);
+	cache.put_string(c1);
+	cache.put_string(c2);
+	cache.put_int(n);
       }
     }
     // TODO: Rename this directive to "ranged-charset".
@@ -1108,6 +1435,8 @@ bool font::load(bool want_diagnostic, bool validate_only)
 	  }
 	  wcp->next = wch;
 	  wch = wcp;
+	  cache.put_int(FONT_CACHE_RANGE);
+	  cache.put_metric(*wcp);
 	  p = 0 /* nullptr */;
 	}
       }
@@ -1146,6 +1475,8 @@ bool font::load(bool want_diagnostic, bool validate_only)
 	  }
 	  glyph *g = name_to_glyph(nm);
 	  copy_entry(g, last_glyph);
+	  cache.put_int(FONT_CACHE_ALIAS);
+	  cache.put_string(nm);
 	}
 	else {
 	  font_char_metric metric;
@@ -1219,6 +1550,11 @@ bool font::load(bool want_diagnostic, bool validate_only)
 	    strcpy(nam, p);
 	    metric.special_device_coding = nam;
 	  }
+	  metric.end_code = 0;
+	  cache.put_int(FONT_CACHE_ENTRY);
+	  cache.put_string((strcmp(nm, "---") == 0) ? 0 /* nullptr */
+			   : nm);
+	  cache.put_metric(metric);
 	  if (strcmp(nm, "---") == 0) {
 	    last_glyph = number_to_glyph(metric.code);
 	    add_entry(last_glyph, metric);
@@ -1260,9 +1596,176 @@ bool font::load(bool want_diagnostic, bool validate_only)
     else
       space_width = scale_round(unitwidth, res, 72 * 3 * sizescale);
   }
+  if (0 == t.error_count) {
+    cache.put_int(FONT_CACHE_END);
+    cache.put_int(space_width);
+    cache.put_double(slant);
+    cache.put_int(int(ligatures));
+    cache.put_int(special);
+    cache.put_string(internalname);
+    cache.write();
+  }
   return true;
 }
 
+// Replay the cache file `cache_file_name` if it is valid for the font
+// description file `fp` located at `path`.  Return whether it was.
+bool font::load_cache(FILE *fp, const char *path,
+		      const char *cache_file_name)
+{
+  int fd = open(cache_file_name, O_RDONLY | O_BINARY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if ((fstat(fd, &st) < 0) || (st.st_size <= 0)) {
+    close(fd);
+    return false;
+  }
+  size_t len = size_t(st.st_size);
+  char *data = 0 /* nullptr */;
+  bool is_mapped = false;
+#ifdef HAVE_MMAP
+  void *addr = mmap(0 /* nullptr */, len, PROT_READ, MAP_PRIVATE, fd,
+		    0);
+  if (addr != MAP_FAILED) {
+    data = static_cast<char *>(addr);
+    is_mapped = true;
+  }
+#endif
+  if (!is_mapped) {
+    data = new char[len];
+    if (read(fd, data, len) != ssize_t(len)) {
+      delete[] data;
+      close(fd);
+      return false;
+    }
+  }
+  close(fd);
+  // Check the whole file before changing anything, so that a corrupt
+  // one leaves the font untouched for the caller to parse instead.
+  bool is_valid = false;
+  font_cache_reader check(data, len);
+  if (check.has_header(fp, path) && replay_cache(check, path, false)) {
+    font_cache_reader r(data, len);
+    (void) r.has_header(fp, path);
+    is_valid = replay_cache(r, path, true);
+    assert(is_valid);
+  }
+#ifdef HAVE_MMAP
+  if (is_mapped)
+    munmap(data, len);
+#endif
+  if (!is_mapped)
+    delete[] data;
+  return is_valid;
+}
+
+// Perform the operations recorded in a cache file if `want_effect`;
+// otherwise just check that they are well formed.
+bool font::replay_cache(font_cache_reader &r, const char *path,
+			bool want_effect)
+{
+  glyph *last_glyph = 0 /* nullptr */;
+  bool saw_entry = false;
+  for (;;) {
+    int op;
+    if (!r.get_int(&op))
+      return false;
+    switch (op) {
+    case FONT_CACHE_UNKNOWN:
+      {
+	const char *directive;
+	const char *arg;
+	int lineno;
+	if (!r.get_string(&directive) || (0 /* nullptr */ == directive)
+	    || !r.get_string(&arg) || !r.get_int(&lineno))
+	  return false;
+	if (want_effect)
+	  handle_unknown_font_command(directive, arg, path, lineno);
+	break;
+      }
+    case FONT_CACHE_ENTRY:
+      {
+	const char *nm;
+	font_char_metric metric;
+	if (!r.get_string(&nm) || !r.get_metric(&metric))
+	  return false;
+	saw_entry = true;
+	if (!want_effect)
+	  break;
+	metric.special_device_coding
+	  = copy_string(metric.special_device_coding);
+	if (0 /* nullptr */ == nm) {
+	  last_glyph = number_to_glyph(metric.code);
+	  add_entry(last_glyph, metric);
+	}
+	else {
+	  last_glyph = name_to_glyph(nm);
+	  add_entry(last_glyph, metric);
+	  copy_entry(number_to_glyph(metric.code), last_glyph);
+	}
+	break;
+      }
+    case FONT_CACHE_ALIAS:
+      {
+	const char *nm;
+	if (!r.get_string(&nm) || (0 /* nullptr */ == nm) || !saw_entry)
+	  return false;
+	if (want_effect)
+	  copy_entry(name_to_glyph(nm), last_glyph);
+	break;
+      }
+    case FONT_CACHE_KERN:
+      {
+	const char *nm1;
+	const char *nm2;
+	int amount;
+	if (!r.get_string(&nm1) || (0 /* nullptr */ == nm1)
+	    || !r.get_string(&nm2) || (0 /* nullptr */ == nm2)
+	    || !r.get_int(&amount))
+	  return false;
+	if (want_effect)
+	  add_kern(name_to_glyph(nm1), name_to_glyph(nm2), amount);
+	break;
+      }
+    case FONT_CACHE_RANGE:
+      {
+	font_char_metric metric;
+	if (!r.get_metric(&metric))
+	  return false;
+	if (want_effect) {
+	  font_char_metric *wcp = new font_char_metric(metric);
+	  wcp->special_device_coding
+	    = copy_string(metric.special_device_coding);
+	  wcp->next = wch;
+	  wch = wcp;
+	}
+	break;
+      }
+    case FONT_CACHE_END:
+      {
+	int sw, lig, sp;
+	double sl;
+	const char *nm;
+	if (!r.get_int(&sw) || !r.get_double(&sl) || !r.get_int(&lig)
+	    || !r.get_int(&sp) || !r.get_string(&nm) || !r.is_at_end())
+	  return false;
+	if (want_effect) {
+	  space_width = sw;
+	  slant = sl;
+	  ligatures = unsigned(lig);
+	  special = (sp != 0);
+	  internalname = copy_string(nm);
+	  compact();
+	}
+	return true;
+      }
+    default:
+      return false;
+    }
+  }
+}
+
 static struct numeric_directive {
   const char *name;
   int *ptr;
@@ -1283,6 +1786,7 @@ static struct numeric_directive {
 // it can be located and is valid, and a null pointer otherwise.
 const char *font::load_desc()
 {
+  allocation_scope scope(ALLOCATION_FONT);
   int nfonts = 0;
   char *path;
   FILE *fp = open_file("DESC", &path);
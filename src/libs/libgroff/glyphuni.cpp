@@ -22,22 +22,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #endif
 
 #include <stdcountof.h>
+#include <stdlib.h> // bsearch(), qsort()
+#include <string.h> // strcmp()
 
 #include "lib.h"
 
-#include "stringclass.h"
-#include "ptable.h"
 #include "unicode.h"
 
-struct glyph_to_unicode_map {
-  char *value;
-};
-
-declare_ptable(glyph_to_unicode_map)
-implement_ptable(glyph_to_unicode_map)
-
-PTABLE(glyph_to_unicode_map) glyph_to_unicode_table;
-
 // The entries commented out in the table below aren't easily used in
 // glyph names.  Getting at the names `[` and `]` would require use of
 // `\C`, and getting at `\` would require changing the escape character.
@@ -51,7 +42,7 @@ PTABLE(glyph_to_unicode_map) glyph_to_unicode_table;
 // This is the groff glyph list (GGL).  See groff_char(7).  Also see
 // "uniglyph.cpp".  The GGL <-> Unicode relation is _not_ bijective.
 
-struct S {
+static const struct glyph_to_unicode_map {
   const char *key;
   const char *value;
 } glyph_to_unicode_list[] = {
@@ -515,24 +506,43 @@ struct S {
   { "ra", "27E9" },
 };
 
-// global constructor
-static struct glyph_to_unicode_init {
-  glyph_to_unicode_init();
-} _glyph_to_unicode_init;
+// The GGL above is arranged for human readers, not by key.  Rather
+// than copy it into a hash table at startup, we sort an index of
+// pointers into it the first time a glyph name is looked up.
+
+static const glyph_to_unicode_map
+  *glyph_to_unicode_index[countof(glyph_to_unicode_list)];
 
-glyph_to_unicode_init::glyph_to_unicode_init()
+static int compare_entries(const void *p, const void *q)
 {
-  for (size_t i = 0; i < countof(glyph_to_unicode_list); i++) {
-    glyph_to_unicode_map *gtu = new glyph_to_unicode_map[1];
-    gtu->value = (char *)glyph_to_unicode_list[i].value;
-    glyph_to_unicode_table.define(glyph_to_unicode_list[i].key, gtu);
-  }
+  return strcmp((*static_cast<const glyph_to_unicode_map *const *>(p))
+		  ->key,
+		(*static_cast<const glyph_to_unicode_map *const *>(q))
+		  ->key);
+}
+
+static int compare_key(const void *key, const void *p)
+{
+  return strcmp(static_cast<const char *>(key),
+		(*static_cast<const glyph_to_unicode_map *const *>(p))
+		  ->key);
 }
 
 const char *glyph_name_to_unicode(const char *s)
 {
-  glyph_to_unicode_map *result = glyph_to_unicode_table.lookup(s);
-  return result ? result->value : 0 /* nullptr */;
+  static bool is_index_sorted = false;
+  if (!is_index_sorted) {
+    for (size_t i = 0; i < countof(glyph_to_unicode_list); i++)
+      glyph_to_unicode_index[i] = &glyph_to_unicode_list[i];
+    qsort(glyph_to_unicode_index, countof(glyph_to_unicode_index),
+	  sizeof glyph_to_unicode_index[0], compare_entries);
+    is_index_sorted = true;
+  }
+  const glyph_to_unicode_map *const *result
+    = static_cast<const glyph_to_unicode_map *const *>(bsearch(s,
+	glyph_to_unicode_index, countof(glyph_to_unicode_index),
+	sizeof glyph_to_unicode_index[0], compare_key));
+  return result ? (*result)->value : 0 /* nullptr */;
 }
 
 // Local Variables:
@@ -28,6 +28,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "lib.h" // strsave()
 
+#include "allocation.h" // allocation_scope
+
 #include "errarg.h"
 #include "error.h"
 #include "font.h"
@@ -96,6 +98,7 @@ static const size_t char_prefix_len = sizeof char_prefix;
 glyph *character_indexer::ascii_char_glyph(unsigned char c)
 {
   if (UNDEFINED_GLYPH == ascii_glyph[c]) {
+    allocation_scope scope(ALLOCATION_GLYPH);
     char buf[sizeof char_prefix + 3 + 1]; // "char" + nnn + '\0'
     (void) memcpy(buf, char_prefix, char_prefix_len);
     (void) strcpy(buf + char_prefix_len, i_to_a(c));
@@ -121,6 +124,7 @@ inline glyph *character_indexer::named_char_glyph(const char *s)
   }
   charinfo *ci = table.lookupassoc(&s);
   if (0 /* nullptr */ == ci) {
+    allocation_scope scope(ALLOCATION_GLYPH);
     ci = new charinfo[1];
     ci->index = next_index++;
     ci->number = -1;
@@ -133,6 +137,7 @@ inline glyph *character_indexer::numbered_char_glyph(int n)
 {
   if ((n >= 0) && (n < NSMALL)) {
     if (UNDEFINED_GLYPH == small_number_glyph[n]) {
+      allocation_scope scope(ALLOCATION_GLYPH);
       charinfo *ci = new charinfo;
       ci->index = next_index++;
       ci->number = n;
@@ -143,6 +148,7 @@ inline glyph *character_indexer::numbered_char_glyph(int n)
   }
   charinfo *ci = ntable.lookup(n);
   if (0 /* nullptr */ == ci) {
+    allocation_scope scope(ALLOCATION_GLYPH);
     ci = new charinfo[1];
     ci->index = next_index++;
     ci->number = n;
@@ -1,4 +1,4 @@
-/* Copyright 1989-2020 Free Software Foundation, Inc.
+/* Copyright 1989-2026 Free Software Foundation, Inc.
 
 Written by James Clark (jjc@jclark.com)
 
@@ -17,29 +17,148 @@ for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <attribute.h> // gnulib: MAYBE_UNUSED
 
 #include "lib.h"
 
 #include <stddef.h>
-#include <stdlib.h>
+#include <stdio.h> // FILE, fclose(), fopen(), fprintf(), fputs()
+#include <stdlib.h> // atexit(), free(), getenv(), malloc()
 
 #include "posix.h"
 #include "nonposix.h"
 
+#include "allocation.h"
+#include "json-encode.h"
+
 extern "C" const char *program_name;
 
+// A build can substitute another allocator for malloc(3) and free(3)
+// by defining both of these, for instance in CPPFLAGS.
+#ifndef GROFF_MALLOC
+#define GROFF_MALLOC malloc
+#define GROFF_FREE free
+#endif
+
 static void ewrite(const char *s)
 {
   write(2, s, strlen(s));
 }
 
+// If the environment variable GROFF_ALLOCATION_REPORT names a file
+// when a program first allocates, we prefix each block with its size
+// and category, tally them, and append a JSON summary to the file at
+// exit.  The decision holds for the life of the process, so operator
+// delete finds a header on any block that operator new returned.  It
+// cannot recognize other storage; memory from malloc(3), such as the
+// result of string::extract(), must go to free(3) instead.
+
+union allocation_header {
+  struct {
+    size_t size;
+    allocation_category category;
+  } h;
+  // Keep the caller's part of the block suitably aligned.
+  long double ld;
+  void *vp;
+};
+
+struct allocation_tally {
+  unsigned long count;
+  unsigned long bytes;
+  unsigned long live;
+  unsigned long peak;
+};
+
+static const char *allocation_category_name[ALLOCATION_CATEGORIES] = {
+  "other",
+  "node",
+  "macro",
+  "font",
+  "symbol",
+  "glyph",
+};
+
+enum { ACCOUNTING_UNDECIDED, ACCOUNTING_OFF, ACCOUNTING_ON };
+static int accounting = ACCOUNTING_UNDECIDED;
+static const char *report_file_name = 0 /* nullptr */;
+static allocation_tally tally[ALLOCATION_CATEGORIES];
+static allocation_tally total;
+
+static void write_json_string(FILE *fp, const char *s)
+{
+  putc('"', fp);
+  for (; *s != '\0'; s++) {
+    json_char jc = json_encode_char((unsigned char) *s);
+    fwrite(jc.buf, 1, jc.len, fp);
+  }
+  putc('"', fp);
+}
+
+static void write_tally(FILE *fp, const allocation_tally *t)
+{
+  fprintf(fp, "{\"allocations\": %lu, \"bytes\": %lu,"
+	  " \"peak bytes\": %lu, \"live bytes\": %lu}",
+	  t->count, t->bytes, t->peak, t->live);
+}
+
+static void write_allocation_report()
+{
+  FILE *fp = fopen(report_file_name, "a");
+  if (0 /* nullptr */ == fp) {
+    if (program_name) {
+      ewrite(program_name);
+      ewrite(": ");
+    }
+    ewrite("cannot open allocation report file\n");
+    return;
+  }
+  fputs("{\"program\": ", fp);
+  write_json_string(fp, program_name ? program_name : "");
+  fprintf(fp, ", \"process\": %ld, \"total\": ", long(getpid()));
+  write_tally(fp, &total);
+  for (int i = 0; i < ALLOCATION_CATEGORIES; i++) {
+    fprintf(fp, ", \"%s\": ", allocation_category_name[i]);
+    write_tally(fp, &tally[i]);
+  }
+  fputs("}\n", fp);
+  fclose(fp);
+}
+
+static void decide_accounting()
+{
+  report_file_name = getenv("GROFF_ALLOCATION_REPORT");
+  if ((report_file_name != 0 /* nullptr */)
+      && (report_file_name[0] != '\0')
+      && (atexit(write_allocation_report) == 0))
+    accounting = ACCOUNTING_ON;
+  else
+    accounting = ACCOUNTING_OFF;
+}
+
+static void count_allocation(allocation_tally *t, size_t size)
+{
+  t->count++;
+  t->bytes += size;
+  t->live += size;
+  if (t->live > t->peak)
+    t->peak = t->live;
+}
+
 void *operator new(size_t size)
 {
   // Avoid relying on the behaviour of malloc(0).
   if (size == 0)
     size++;
-  char *p = (char *)malloc(unsigned(size));
+  if (ACCOUNTING_UNDECIDED == accounting)
+    decide_accounting();
+  size_t header_size = (ACCOUNTING_ON == accounting)
+			? sizeof(allocation_header) : 0;
+  char *p = (char *)GROFF_MALLOC(size + header_size);
   if (p == 0) {
     if (program_name) {
       ewrite(program_name);
@@ -48,13 +167,31 @@ void *operator new(size_t size)
     ewrite("out of memory\n");
     _exit(-1);
   }
-  return p;
+  if (ACCOUNTING_ON == accounting) {
+    allocation_header *hp = (allocation_header *)p;
+    hp->h.size = size;
+    hp->h.category = current_allocation_category;
+    count_allocation(&tally[hp->h.category], size);
+    count_allocation(&total, size);
+  }
+  return p + header_size;
+}
+
+static void release(void *p)
+{
+  if (ACCOUNTING_ON == accounting) {
+    allocation_header *hp = (allocation_header *)p - 1;
+    tally[hp->h.category].live -= hp->h.size;
+    total.live -= hp->h.size;
+    p = hp;
+  }
+  GROFF_FREE(p);
 }
 
 void operator delete(void *p) throw()
 {
   if (p)
-    free(p);
+    release(p);
 }
 
 void operator delete(void *p, MAYBE_UNUSED long unsigned int size)
@@ -67,7 +204,7 @@ void operator delete(void *p, MAYBE_UNUSED long unsigned int size)
   //   warning: deleting 'void*' is undefined [-Wdelete-incomplete]
   //delete p;
   if (p)
-    free(p);
+    release(p);
 }
 
 // Local Variables:
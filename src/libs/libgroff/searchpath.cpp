@@ -23,15 +23,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <assert.h>
 #include <errno.h>
-#include <stdlib.h>
+#include <stdlib.h> // bsearch(), free(), getenv(), qsort()
 
 // for stat(2)
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <fcntl.h> // open(), O_APPEND, O_WRONLY
+
+#ifdef HAVE_DIRENT_H
+# include <dirent.h> // closedir(), opendir(), readdir()
+#endif
+
 #include "lib.h"
 
+#include "ptable.h"
 #include "searchpath.h"
 #include "nonposix.h"
 
@@ -52,6 +59,157 @@ static bool is_directory(const char *name)
   return false;
 }
 
+// Looking up a macro file or font description typically fails in most
+// directories of a search path before it succeeds in one; each failure
+// costs an fopen() system call.  We instead read each directory that
+// we are asked about once per process, and consult its sorted listing
+// to skip candidates that cannot exist.  The files such lookups find
+// are installed resources that are not expected to appear while we
+// run; open_file_cautiously(), which serves input files that a
+// document may itself have written, does not use the listings.
+
+struct directory_listing {
+  char **names;			// sorted with strcmp()
+  int count;			// -1 if the directory can't be listed
+  directory_listing();
+  ~directory_listing();
+};
+
+directory_listing::directory_listing()
+: names(0 /* nullptr */), count(-1)
+{
+}
+
+directory_listing::~directory_listing()
+{
+  for (int i = 0; i < count; i++)
+    delete[] names[i];
+  delete[] names;
+}
+
+declare_ptable(directory_listing)
+implement_ptable(directory_listing)
+
+static PTABLE(directory_listing) directory_listing_table;
+
+static int compare_names(const void *p1, const void *p2)
+{
+  return strcmp(*static_cast<char * const *>(p1),
+		*static_cast<char * const *>(p2));
+}
+
+static void read_directory_listing(directory_listing *dl,
+				   const char *dir)
+{
+#ifdef HAVE_DIRENT_H
+  DIR *dp = opendir(dir);
+  if (0 /* nullptr */ == dp) {
+    // A directory that doesn't exist contains nothing.  Any other
+    // failure (such as a directory that is searchable but not
+    // readable) leaves us ignorant, and we fall back to fopen().
+    if ((ENOENT == errno) || (ENOTDIR == errno))
+      dl->count = 0;
+    return;
+  }
+  int allocated = 16;
+  int n = 0;
+  char **names = new char *[allocated];
+  struct dirent *de;
+  while ((de = readdir(dp)) != 0 /* nullptr */) {
+    if (n >= allocated) {
+      char **old = names;
+      allocated *= 2;
+      names = new char *[allocated];
+      memcpy(names, old, n * sizeof(char *));
+      delete[] old;
+    }
+    names[n] = new char[strlen(de->d_name) + 1];
+    strcpy(names[n], de->d_name);
+    n++;
+  }
+  closedir(dp);
+  qsort(names, n, sizeof(char *), compare_names);
+  dl->names = names;
+  dl->count = n;
+#endif
+}
+
+// Return false if 'path' certainly does not exist, judging from a
+// cached listing of the directory that would contain it.
+
+static bool might_exist(const char *path)
+{
+#ifdef _WIN32
+  // File names are case-insensitive and might be subject to
+  // relocation; don't second-guess the file system.
+  return true;
+#else
+  const char *base = 0 /* nullptr */;
+  for (const char *p = path; *p != '\0'; p++)
+    if (strchr(DIR_SEPS, *p) != 0 /* nullptr */)
+      base = p + 1;
+  if ((0 /* nullptr */ == base) || (*base == '\0'))
+    return true;
+  size_t dirlen = base - path - 1;
+  char *dir = new char[(dirlen > 0 ? dirlen : 1) + 1];
+  if (dirlen > 0) {
+    memcpy(dir, path, dirlen);
+    dir[dirlen] = '\0';
+  }
+  else
+    strcpy(dir, "/");
+  directory_listing *dl = directory_listing_table.lookup(dir);
+  if (0 /* nullptr */ == dl) {
+    dl = new directory_listing[1];
+    read_directory_listing(dl, dir);
+    directory_listing_table.define(dir, dl);
+  }
+  delete[] dir;
+  if (dl->count < 0)
+    return true;
+  return (bsearch(&base, dl->names, dl->count, sizeof(char *),
+		  compare_names) != 0 /* nullptr */);
+#endif
+}
+
+// If the environment variable GROFF_DEPENDENCY_LOG__ names a file,
+// which groff(1) arranges when it keeps a render cache, we append to it
+// a line for each file we open for reading ("f path") and each
+// candidate we find missing on the way ("m path"), so that groff can
+// later tell whether a lookup would still find the same files.  troff
+// also notes each environment variable it interpolates ("v name").  Every
+// program in a pipeline may append to the log at once; each line is a
+// single write() to a descriptor opened for appending, so lines don't
+// interleave.
+
+static void note_lookup(char kind, const char *path)
+{
+  static int fd = -2;
+  if (-2 == fd) {
+    const char *log = getenv("GROFF_DEPENDENCY_LOG__");
+    fd = -1;
+    if ((log != 0 /* nullptr */) && (*log != '\0'))
+      fd = open(log, O_WRONLY | O_APPEND);
+  }
+  if (fd < 0)
+    return;
+  int saved_errno = errno;
+  size_t len = strlen(path);
+  char *line = new char[2 + len + 1];
+  line[0] = kind;
+  line[1] = ' ';
+  memcpy(line + 2, path, len);
+  line[2 + len] = '\n';
+  (void) write(fd, line, 2 + len + 1);
+  delete[] line;
+  errno = saved_errno;
+}
+
+void note_environment_lookup(const char *name)
+{
+  note_lookup('v', name);
+}
+
 search_path::search_path(const char *envvar, const char *standard,
 			 int add_home, int add_current)
 {
@@ -123,12 +281,20 @@ FILE *search_path::open_file(const char *name, char **pathp)
     }
     FILE *fp = fopen(name, "r");
     if (fp != 0 /* nullptr */) {
+      note_lookup('f', name);
       if (pathp != 0 /* nullptr */)
 	*pathp = strsave(name);
       return fp;
     }
-    else
+    else {
+      if (ENOENT == errno)
+	note_lookup('m', name);
       return 0 /* nullptr */;
+    }
+  }
+  if (is_directory(name)) {
+    errno = EISDIR;
+    return 0 /* nullptr */;
   }
   unsigned namelen = strlen(name);
   char *p = dirs;
@@ -150,13 +316,14 @@ FILE *search_path::open_file(const char *name, char **pathp)
 #if 0
     fprintf(stderr, "trying '%s'\n", path);
 #endif
-    if (is_directory(name)) {
-      errno = EISDIR;
-      return 0 /* nullptr */;
+    FILE *fp = 0 /* nullptr */;
+    int err = ENOENT;
+    if (might_exist(path)) {
+      fp = fopen(path, "r");
+      err = errno;
     }
-    FILE *fp = fopen(path, "r");
-    int err = errno;
     if (fp != 0 /* nullptr */) {
+      note_lookup('f', path);
       if (pathp != 0 /* nullptr */)
 	*pathp = path;
       else {
@@ -165,6 +332,8 @@ FILE *search_path::open_file(const char *name, char **pathp)
       }
       return fp;
     }
+    if (ENOENT == err)
+      note_lookup('m', path);
     free(path);
     errno = err;
     if (*end == '\0')
@@ -192,12 +361,21 @@ FILE *search_path::open_file_cautiously(const char *name, char **pathp,
     }
     FILE *fp = fopen(name, mode);
     if (fp != 0 /* nullptr */) {
+      if (reading)
+	note_lookup('f', name);
       if (pathp != 0 /* nullptr */)
 	*pathp = strsave(name);
       return fp;
     }
-    else
+    else {
+      if (reading && (ENOENT == errno))
+	note_lookup('m', name);
       return 0 /* nullptr */;
+    }
+  }
+  if (is_directory(name)) {
+    errno = EISDIR;
+    return 0 /* nullptr */;
   }
   unsigned namelen = strlen(name);
   char *p = dirs;
@@ -220,13 +398,10 @@ FILE *search_path::open_file_cautiously(const char *name, char **pathp,
 #if 0
     fprintf(stderr, "trying '%s'\n", path);
 #endif
-    if (is_directory(name)) {
-      errno = EISDIR;
-      return 0 /* nullptr */;
-    }
     FILE *fp = fopen(path, mode);
     int err = errno;
     if (fp != 0 /* nullptr */) {
+      note_lookup('f', path);
       if (pathp != 0 /* nullptr */)
 	*pathp = path;
       else {
@@ -235,6 +410,8 @@ FILE *search_path::open_file_cautiously(const char *name, char **pathp,
       }
       return fp;
     }
+    if (ENOENT == err)
+      note_lookup('m', path);
     free(path);
     errno = err;
     if (err != ENOENT)
@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "json-encode.h" // json_char, json_encode_char()
 #include "lib.h"
 
+#include "allocation.h" // allocation_scope
 #include "errarg.h"
 #include "error.h"
 #include "symbol.h"
@@ -97,6 +98,7 @@ symbol::symbol(const char *p, int how)
     s = "";
     return;
   }
+  allocation_scope scope(ALLOCATION_SYMBOL);
   if (table == 0 /* nullptr */) {
     table_size = table_sizes[0];
     table = const_cast<const char **>(new char *[table_size]);
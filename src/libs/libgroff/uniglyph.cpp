@@ -22,25 +22,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #endif
 
 #include <stdcountof.h>
+#include <stdlib.h> // bsearch()
+#include <string.h> // strcmp()
 
 #include "lib.h"
 
-#include "stringclass.h"
-#include "ptable.h"
 #include "unicode.h"
 
-struct unicode_to_glyph {
-  char *value;
-};
-
-declare_ptable(unicode_to_glyph)
-implement_ptable(unicode_to_glyph)
-
-PTABLE(unicode_to_glyph) unicode_to_glyph_table;
-
 // See "uniglyph.cpp".  The GGL <-> Unicode relation is _not_ bijective.
 
-struct S {
+// The table is read-only data searched in place; keep its keys sorted
+// as strcmp() orders them.
+
+static const struct unicode_to_glyph {
   const char *key;
   const char *value;
 } unicode_to_glyph_list[] = {
@@ -429,24 +423,19 @@ struct S {
   { "27E9", "ra" },
 };
 
-// global constructor
-static struct unicode_to_glyph_init {
-  unicode_to_glyph_init();
-} _unicode_to_glyph_init;
-
-unicode_to_glyph_init::unicode_to_glyph_init()
+static int compare_key(const void *key, const void *entry)
 {
-  for (unsigned int i = 0; i < countof(unicode_to_glyph_list); i++) {
-    unicode_to_glyph *utg = new unicode_to_glyph[1];
-    utg->value = (char *)unicode_to_glyph_list[i].value;
-    unicode_to_glyph_table.define(unicode_to_glyph_list[i].key, utg);
-  }
+  return strcmp(static_cast<const char *>(key),
+		static_cast<const unicode_to_glyph *>(entry)->key);
 }
 
 const char *unicode_to_glyph_name(const char *s)
 {
-  unicode_to_glyph *result = unicode_to_glyph_table.lookup(s);
-  return result ? result->value : 0;
+  const unicode_to_glyph *result
+    = static_cast<const unicode_to_glyph *>(bsearch(s,
+	unicode_to_glyph_list, countof(unicode_to_glyph_list),
+	sizeof unicode_to_glyph_list[0], compare_key));
+  return result ? result->value : 0 /* nullptr */;
 }
 
 // Local Variables:
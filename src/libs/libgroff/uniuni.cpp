@@ -22,30 +22,24 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #endif
 
 #include <stdcountof.h>
+#include <stdlib.h> // bsearch()
+#include <string.h> // strcmp(), strlen()
 
 #include "lib.h"
 
-#include "stringclass.h"
-#include "ptable.h"
 #include "unicode.h"
 
 // This code has been algorithmically derived from the file
 // UnicodeData.txt, version 17.0.0, available from unicode.org,
 // on 2025-10-09.
 
-struct unicode_decompose {
-  char *value;
-};
-
-declare_ptable(unicode_decompose)
-implement_ptable(unicode_decompose)
-
-PTABLE(unicode_decompose) unicode_decompose_table;
-
 // The first digit in the composite string gives the number of
 // characters in the decomposed sequence of simple characters.
+//
+// The table is read-only data searched in place; its keys must stay in
+// ascending order of code point, the order of UnicodeData.txt.
 
-struct S {
+static const struct unicode_decompose {
   const char *key;
   const char *value;
 } unicode_decompose_list[] = {
@@ -2132,25 +2126,26 @@ struct S {
   { "2FA1D", "12A600" },
 };
 
-// global constructor
-
-static struct unicode_decompose_init {
-  unicode_decompose_init();
-} _unicode_decompose_init;
-
-unicode_decompose_init::unicode_decompose_init()
+// Keys are upper-case hexadecimal numerals without leading zeroes
+// beyond four digits, so a shorter key is always the smaller one.
+static int compare_code_point(const void *key, const void *entry)
 {
-  for (size_t i = 0; i < countof(unicode_decompose_list); i++) {
-    unicode_decompose *dec = new unicode_decompose[1];
-    dec->value = const_cast<char *>(unicode_decompose_list[i].value);
-    unicode_decompose_table.define(unicode_decompose_list[i].key, dec);
-  }
+  const char *s = static_cast<const char *>(key);
+  const char *t = static_cast<const unicode_decompose *>(entry)->key;
+  size_t slen = strlen(s);
+  size_t tlen = strlen(t);
+  if (slen != tlen)
+    return (slen < tlen) ? -1 : 1;
+  return strcmp(s, t);
 }
 
 const char *decompose_unicode(const char *s)
 {
-  unicode_decompose *result = unicode_decompose_table.lookup(s);
-  return result ? result->value : 0;
+  const unicode_decompose *result
+    = static_cast<const unicode_decompose *>(bsearch(s,
+	unicode_decompose_list, countof(unicode_decompose_list),
+	sizeof unicode_decompose_list[0], compare_code_point));
+  return result ? result->value : 0 /* nullptr */;
 }
 
 // Local Variables:
@@ -22,6 +22,9 @@
 #define MAXPOINTS	200
 #define LINELENGTH	1
 #define PointsPerInterval 64
+#define Flatness	(res / 1000.0)	/* greatest deviation of flattened */
+					/* curves from true ones, in device */
+					/* units                            */
 #define pi		3.14159265358979324
 #define twopi		(2.0 * pi)
 #define len(a, b)	hypot((double)(b.x-a.x), \
@@ -67,6 +70,7 @@ void tmove(POINT * ptr);
 void cr();
 void drawwig(POINT * ptr, int type);
 void HGtline(int x1, int y1);
+void curveline(int x, int y, int *length);
 void deltax(double x);
 void deltay(double y);
 void HGArc(int cx, int cy, int px, int py, int angle);
@@ -164,11 +168,8 @@ HGPrintElt(ELT *element,
 	  /* brushf = style of outline; size = color of fill:
 	   * on first pass (polyfill=FILL), do the interior using 'P'
 	   *    unless size=0
-	   * on second pass (polyfill=OUTLINE), do the outline using a
-	   *    series of vectors. It might make more sense to use \D'p
-	   *    ...', but there is no uniform way to specify a 'fill
-	   *    character' that prints as 'no fill' on all output
-	   *    devices (and stipple fonts).
+	   * on second pass (polyfill=OUTLINE), do the outline using
+	   *    \D'p ...' if it is solid, else a series of vectors
 	   * If polyfill=BOTH, just use the \D'p ...' command.
 	   */
 	  double firstx = p1->x;
@@ -252,6 +253,23 @@ HGPrintElt(ELT *element,
 	  length = 0;		/* keep track of line length */
 	  tmove(p1);
 
+	  /* solid outlines can be drawn by the output device */
+	  if (linmod == SOLID) {
+	    printf("\\D'p");
+	    while (!Nullpoint((PTNextPoint(p1)))) {
+	      p1 = PTNextPoint(p1);
+	      deltax((double) p1->x);
+	      deltay((double) p1->y);
+	      if (length++ > LINELENGTH) {
+		length = 0;
+		printf("\\\n");
+	      }
+	    }			/* end while */
+	    putchar('\'');
+	    cr();
+	    break;
+	  }
+
 	  while (!Nullpoint((PTNextPoint(p1)))) {
 	    p1 = PTNextPoint(p1);
 	    HGtline((int) (p1->x * troffscale),
@@ -645,7 +663,11 @@ HGArc(int cx,
  |
  | Results:	Draws a curve delimited by (not through) the line
  |		segments traced by (xpoints, ypoints) point list.  This
- |		is the 'Pic'-style curve.
+ |		is the 'Pic'-style curve.  An open curve drawn with
+ |		solid lines is exactly troff's \D'~' spline, so the
+ |		output device draws it; otherwise, each parabolic arc of
+ |		the curve is flattened into as few lines as keep it
+ |		within 'Flatness' of the true arc.
  *--------------------------------------------------------------------*/
 
 void
@@ -672,6 +694,21 @@ picurve(int *x,
     y[0] = y[1];		/* the line segments                */
     x[npts + 1] = x[npts];
     y[npts + 1] = y[npts];
+    if (linmod == SOLID && npts > 1) {
+      tmove2(x[1], y[1]);
+      printf("\\D'~");
+      for (i = 2; i <= npts; i++) {
+	printf(" %du %du", x[i] - x[i - 1], y[i] - y[i - 1]);
+	if (length++ > LINELENGTH) {
+	  length = 0;
+	  printf("\\\n");
+	}
+      }
+      putchar('\'');
+      lastx = x[npts];
+      lastyline = lasty = y[npts];
+      return;
+    }
   }
 
   pxp = (x[0] + x[1]) / 2;	/* make the last point pointers       */
@@ -679,19 +716,19 @@ picurve(int *x,
   tmove2(pxp, pyp);
 
   for (; npts--; x++, y++) {	/* traverse the line segments */
-    xp = x[0] - x[1];
-    yp = y[0] - y[1];
-    nseg = (int) hypot((double) xp, (double) yp);
-    xp = x[1] - x[2];
-    yp = y[1] - y[2];
-				/* 'nseg' is the number of line    */
-				/* segments that will be drawn for */
-				/* each curve segment.             */
-    nseg = (int) ((double) (nseg + (int) hypot((double) xp,
-					       (double) yp)) /
-		  res * PointsPerInterval);
-
-    for (i = 1; i < nseg; i++) {
+    /*
+     * The arc runs from the midpoint of the first line segment to
+     * that of the second, guided by the point they share.  Each of
+     * 'nseg' chords strays from it by at most |x0 - 2x1 + x2| / 8
+     * divided by the square of 'nseg'.
+     */
+    w = hypot((double) (x[0] - 2 * x[1] + x[2]),
+	      (double) (y[0] - 2 * y[1] + y[2])) / 8;
+    nseg = (int) ceil(sqrt(w / Flatness));
+    if (nseg < 1)
+      nseg = 1;
+
+    for (i = 1; i <= nseg; i++) {
       w = (double) i / (double) nseg;
       t1 = w * w;
       t3 = t1 + 1.0 - (w + w);
@@ -699,11 +736,7 @@ picurve(int *x,
       xp = (((int) (t1 * x[2] + t2 * x[1] + t3 * x[0])) + 1) / 2;
       yp = (((int) (t1 * y[2] + t2 * y[1] + t3 * y[0])) + 1) / 2;
 
-      HGtline(xp, yp);
-      if (length++ > LINELENGTH) {
-	length = 0;
-	printf("\\\n");
-      }
+      curveline(xp, yp, &length);
     }
   }
 }
@@ -727,8 +760,10 @@ HGCurve(int *x,
   double h[MAXPOINTS], dx[MAXPOINTS], dy[MAXPOINTS];
   double d2x[MAXPOINTS], d2y[MAXPOINTS], d3x[MAXPOINTS], d3y[MAXPOINTS];
   double t, t2, t3;
+  double d2;			/* greatest 2nd derivative in interval */
   int j;
   int k;
+  int nk;
   int nx;
   int ny;
   int lx, ly;
@@ -754,24 +789,33 @@ HGCurve(int *x,
   }
 
   /*
-   * Generate the curve using the above information and
-   * PointsPerInterval vectors between each specified knot.
+   * Generate the curve using the above information and as many
+   * vectors between each specified knot, up to PointsPerInterval, as
+   * keep it within Flatness of the true curve.  A vector spanning 't'
+   * of the parameter strays from the curve by at most t^2/8 times the
+   * magnitude of the curve's second derivative, which is linear in 't'
+   * and so greatest at an end of the interval.
    */
 
   for (j = 1; j < numpoints; ++j) {
     if ((x[j] == x[j + 1]) && (y[j] == y[j + 1]))
       continue;
-    for (k = 0; k <= PointsPerInterval; ++k) {
-      t = (double) k *h[j] / (double) PointsPerInterval;
+    d2 = hypot(d2x[j], d2y[j]);
+    t = hypot(d2x[j] + h[j] * d3x[j], d2y[j] + h[j] * d3y[j]);
+    if (t > d2)
+      d2 = t;
+    nk = (int) ceil(h[j] * sqrt(d2 / (8 * Flatness)));
+    if (nk < 1)
+      nk = 1;
+    else if (nk > PointsPerInterval)
+      nk = PointsPerInterval;
+    for (k = 0; k <= nk; ++k) {
+      t = (double) k *h[j] / (double) nk;
       t2 = t * t;
       t3 = t * t * t;
       nx = x[j] + (int) (t * dx[j] + t2 * d2x[j] / 2 + t3 * d3x[j] / 6);
       ny = y[j] + (int) (t * dy[j] + t2 * d2y[j] / 2 + t3 * d3y[j] / 6);
-      HGtline(nx, ny);
-      if (length++ > LINELENGTH) {
-	length = 0;
-	printf("\\\n");
-      }
+      curveline(nx, ny, &length);
     }				/* end for k */
   }				/* end for j */
 }				/* end HGCurve */
@@ -943,6 +987,30 @@ NaturalEndSpline(double h[],	/* parameterization */
 }				/* end NaturalEndSpline */
 
 
+/*--------------------------------------------------------------------*
+ | Routine:	curveline (x_position, y_position, length_pointer)
+ |
+ | Results:	Draws a line from current position to (x, y) as part of
+ |		a flattened curve, unless it would have no length, and
+ |		breaks the troff input line every few lines, counting
+ |		them in *length.
+ *--------------------------------------------------------------------*/
+
+void
+curveline(int x,
+	  int y,
+	  int *length)
+{
+  if (x == lastx && y == lasty)
+    return;
+  HGtline(x, y);
+  if ((*length)++ > LINELENGTH) {
+    *length = 0;
+    printf("\\\n");
+  }
+}
+
+
 /*--------------------------------------------------------------------*
  | Routine:	change (x_position, y_position, visible_flag)
  |
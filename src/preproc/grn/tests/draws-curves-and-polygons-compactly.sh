@@ -0,0 +1,97 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+grn="${abs_top_builddir:-.}/grn"
+fontdir="${abs_top_builddir:-.}/font"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+tmpfile=grn-test-$$.g
+
+cleanup () {
+  rm -f "$tmpfile"
+}
+
+# A process handling a fatal signal should:
+#   1.  Mask all fatal signals of interest.  (GBR often excludes ABRT.)
+#   2.  Perform cleanup operations.
+#   3.  Unmask the signal (removing the handler).
+#   4.  Signal its own process group with the signal caught so that the
+#       the children exit and shell accurately reports how the process
+#       died.
+fatals="HUP INT QUIT TERM"
+for s in $fatals
+do
+  trap "trap '' $fatals; cleanup; trap - $fatals; kill -$s -$$" $s
+done
+
+# A solid open B-spline, a straight interpolated curve, and a solid
+# polygon outline.
+cat > "$tmpfile" <<EOF2
+sungremlinfile
+0 0.00 0.00
+CURVE BSPLINE
+100.00 100.00
+150.00 200.00
+200.00 100.00
+*
+5 0
+0
+CURVE
+100.00 300.00
+150.00 300.00
+200.00 300.00
+*
+5 0
+0
+POLYGON
+300.00 100.00
+400.00 100.00
+350.00 200.00
+*
+5 0
+0
+-1
+EOF2
+
+output=$(printf '.GS\nfile %s\n.GE\n' "$tmpfile" \
+  | "$grn" -F "$fontdir" -Tps)
+echo "$output"
+
+echo "checking that a solid B-spline is drawn with a single command" >&2
+echo "$output" | grep -Fq "\\D'~ 72000u -144000u 72000u 144000u'" \
+  || wail
+
+echo "checking that a solid polygon outline is drawn with a single" \
+  "command" >&2
+echo "$output" | grep -Fq "\\D'p 144000u 0u -72000u -144000u'" || wail
+
+echo "checking that a straight curve is not split into many lines" >&2
+echo "$output" | grep -Fqx "\\D'l 72000u 0u'\\D'l 72000u 0u'" || wail
+
+cleanup
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=4 tabstop=4 textwidth=72:
@@ -37,6 +37,7 @@ declare_ptable(char)
 implement_ptable(char)
 
 PTABLE(char) macro_table;
+static int macro_table_changes = 0;
 
 // First character of the range representing $1-$<MAX_ARG>.
 // All of them must be invalid input characters.
@@ -79,6 +80,11 @@ int input::get_location(const char **, int *)
   return 0;
 }
 
+int input::get_lexed_token()
+{
+  return 0;
+}
+
 file_input::file_input(FILE *f, const char *fn)
 : fp(f), filename(fn), lineno(0), ptr("")
 {
@@ -273,6 +279,11 @@ public:
   static int get_location(const char **fnp, int *lnp);
   static void push_back(unsigned char c, int was_bol = 0);
   static int bol();
+  static int get_lexed_token();
+  // Make the given input the only one, so that text can be lexed out of
+  // its context, and return the stack it replaces for restore().
+  static input *isolate(input *, int /* bol */, int * /* saved_bol */);
+  static void restore(input *, int /* saved_bol */);
 };
 
 input *input_stack::current_input = 0;
@@ -374,6 +385,66 @@ void input_stack::push_back(unsigned char c, int was_bol)
   bol_flag = was_bol;
 }
 
+int input_stack::get_lexed_token()
+{
+  if (current_input == 0)
+    return 0;
+  int t = current_input->get_lexed_token();
+  if (t != 0)
+    bol_flag = t == '\n';
+  return t;
+}
+
+input *input_stack::isolate(input *in, int bol, int *saved_bol)
+{
+  input *saved = current_input;
+  *saved_bol = bol_flag;
+  in->next = 0;
+  current_input = in;
+  bol_flag = bol;
+  return saved;
+}
+
+void input_stack::restore(input *saved, int saved_bol)
+{
+  // Discard anything pushed back onto the isolated input.
+  while (current_input != 0 && current_input->next != 0) {
+    input *tem = current_input;
+    current_input = current_input->next;
+    delete tem;
+  }
+  current_input = saved;
+  bol_flag = saved_bol;
+}
+
+// The characters of a string that the caller keeps.
+
+class string_input : public input {
+  const char *p;
+public:
+  string_input(const char *);
+  int get();
+  int peek();
+};
+
+string_input::string_input(const char *s) : p(s)
+{
+}
+
+int string_input::get()
+{
+  if (*p == '\0')
+    return EOF;
+  return (unsigned char)*p++;
+}
+
+int string_input::peek()
+{
+  if (*p == '\0')
+    return EOF;
+  return (unsigned char)*p;
+}
+
 int input_stack::get_location(const char **fnp, int *lnp)
 {
   for (input *p = current_input; p; p = p->next)
@@ -936,6 +1007,9 @@ int get_token_after_dot(int c)
 
 int get_token(int lookup_flag)
 {
+  int t = input_stack::get_lexed_token();
+  if (t != 0)
+    return t;
   context_buffer.clear();
   for (;;) {
     int n = 0;
@@ -1416,6 +1490,7 @@ void do_define()
     return;
   token_buffer += '\0';
   macro_table.define(name, strsave(token_buffer.contents()));
+  macro_table_changes++;
 }
 
 void do_undef()
@@ -1427,6 +1502,7 @@ void do_undef()
   }
   token_buffer += '\0';
   macro_table.define(token_buffer.contents(), 0);
+  macro_table_changes++;
 }
 
 
@@ -1539,6 +1615,22 @@ void do_copy(const char *filename)
   input_stack::push(new file_input(fp, filename));
 }
 
+// A token of the body of 'copy thru', lexed in advance.
+
+struct thru_token {
+  int type;			// as from get_token(), or THRU_ARG
+  int n;			// token_int, or index of argument
+  double x;			// token_double
+  string text;			// token_buffer
+  string context;		// context_buffer
+};
+
+#define THRU_ARG (-2)
+
+// Rather than lex the body afresh for each line of data, we lex it
+// once, and for each line whose arguments are all numbers, return its
+// tokens with the numbers put in place of the arguments.
+
 class copy_thru_input : public input {
   int done;
   char *body;
@@ -1548,13 +1640,26 @@ class copy_thru_input : public input {
   int argv[MAX_ARG];
   int argc;
   string line;
+  enum { UNLEXED, LEXED, UNLEXABLE } lex_state;
+  int macro_table_state;
+  thru_token *tokens;
+  int ntokens;
+  int tp;			// next token, or -1 between lines
+  int did_minus;		// returned '-' of negative argument
+  unsigned long used_args;	// bit i set if body uses argument i
+  int arg_is_negative[MAX_ARG];
+  double arg_value[MAX_ARG];
+  string arg_context[MAX_ARG];
   int get_line();
+  int lex_body();
+  int lex_args();
   virtual int inget() = 0;
 public:
   copy_thru_input(const char *b, const char *u);
   ~copy_thru_input();
   int get();
   int peek();
+  int get_lexed_token();
 };
 
 class copy_file_thru_input : public copy_thru_input {
@@ -1612,7 +1717,8 @@ int copy_rest_thru_input::inget()
 }
 
 copy_thru_input::copy_thru_input(const char *b, const char *u)
-: done(0)
+: done(0), lex_state(UNLEXED), macro_table_state(macro_table_changes),
+  tokens(0), ntokens(0), tp(-1), did_minus(0), used_args(0)
 {
   ap = 0;
   body = process_body(b);
@@ -1625,10 +1731,219 @@ copy_thru_input::~copy_thru_input()
 {
   delete[] body;
   delete[] until;
+  delete[] tokens;
+}
+
+static int is_arg_char(int c)
+{
+  return c >= ARG1 && c <= ARG1 + MAX_ARG - 1;
+}
+
+// Can 'c' be part of the same token as a number next to it?
+
+static int is_number_glue(int c)
+{
+  return is_arg_char(c) || csalnum(c) || c == '_' || c == '.';
+}
+
+// Lex the body into 'tokens'; return 0 if its tokens could depend on
+// the arguments or on when it is lexed.
+
+int copy_thru_input::lex_body()
+{
+  // Lexing must not find fault with the body; the only faults possible
+  // are unclosed strings.
+  int in_string = 0;
+  const char *s;
+  for (s = body; *s != '\0'; s++) {
+    if (in_string) {
+      if (*s == '\\' && s[1] == '"')
+	s++;
+      else if (*s == '"')
+	in_string = 0;
+      else if (*s == '\n')
+	return 0;
+    }
+    else if (*s == '"')
+      in_string = 1;
+    else if (*s == '#')
+      while (s[1] != '\0' && s[1] != '\n')
+	s++;
+  }
+  if (in_string)
+    return 0;
+  // Nothing may join an argument to the characters around it, and it
+  // must not begin a line, lest it be taken for a command line.
+  for (s = body; *s != '\0'; s++)
+    if (is_arg_char((unsigned char)*s)) {
+      int prev = (s == body) ? '\n' : (unsigned char)s[-1];
+      if (prev == '\n' || prev == '<' || is_number_glue(prev)
+	  || is_number_glue((unsigned char)s[1]))
+	return 0;
+    }
+  string text(body);
+  text += '\n';
+  text += '\0';
+  string_input in(text.contents());
+  int saved_bol;
+  input *saved = input_stack::isolate(&in, 1, &saved_bol);
+  int ok = 1;
+  int size = 16;
+  tokens = new thru_token[size];
+  for (;;) {
+    int t = get_token(0);
+    if (t == EOF)
+      break;
+    if (ntokens >= size) {
+      thru_token *old_tokens = tokens;
+      size *= 2;
+      tokens = new thru_token[size];
+      for (int i = 0; i < ntokens; i++)
+	tokens[i] = old_tokens[i];
+      delete[] old_tokens;
+    }
+    thru_token *tok = &tokens[ntokens++];
+    tok->type = t;
+    tok->context = context_buffer;
+    if (is_arg_char(t)) {
+      tok->type = THRU_ARG;
+      tok->n = t - ARG1;
+      used_args |= 1UL << tok->n;
+      continue;
+    }
+    switch (t) {
+    case NUMBER:
+      tok->x = token_double;
+      break;
+    case ORDINAL:
+      tok->n = token_int;
+      break;
+    case LABEL:
+    case VARIABLE:
+      token_buffer += '\0';
+      if (macro_table.lookup(token_buffer.contents()) != 0)
+	ok = 0;
+      token_buffer.set_length(token_buffer.length() - 1);
+      // fall through
+    case TEXT:
+      for (int i = 0; i < token_buffer.length(); i++)
+	if (is_arg_char((unsigned char)token_buffer[i]))
+	  ok = 0;
+      tok->text = token_buffer;
+      break;
+    // These read the characters that follow them themselves.
+    case COMMAND_LINE:
+    case COPY:
+    case DEFINE:
+    case ELSE:
+    case FOR:
+    case IF:
+    case SH:
+    case THRU:
+    case UNDEF:
+      ok = 0;
+      break;
+    }
+  }
+  input_stack::restore(saved, saved_bol);
+  // A body ending in an escaped newline continues on the next line.
+  if (ntokens == 0 || tokens[ntokens - 1].type != '\n')
+    ok = 0;
+  return ok;
+}
+
+// Lex the arguments that the body uses; return 0 unless each is a
+// number, possibly negative.
+
+int copy_thru_input::lex_args()
+{
+  for (int i = 0; i < argc; i++)
+    if (used_args & (1UL << i)) {
+      string_input in(line.contents() + argv[i]);
+      int saved_bol;
+      input *saved = input_stack::isolate(&in, 0, &saved_bol);
+      int t = get_token(0);
+      arg_is_negative[i] = (t == '-');
+      if (t == '-')
+	t = get_token(0);
+      int ok = (t == NUMBER);
+      if (ok) {
+	arg_value[i] = token_double;
+	arg_context[i] = context_buffer;
+	ok = (get_token(0) == EOF);
+      }
+      input_stack::restore(saved, saved_bol);
+      if (!ok)
+	return 0;
+    }
+  return 1;
+}
+
+int copy_thru_input::get_lexed_token()
+{
+  if (tp < 0) {
+    if (p != 0 || ap != 0 || lex_state == UNLEXABLE)
+      return 0;
+    if (lex_state == UNLEXED)
+      lex_state = lex_body() ? LEXED : UNLEXABLE;
+    // A change of macro definitions might change the body's tokens.
+    if (macro_table_state != macro_table_changes)
+      lex_state = UNLEXABLE;
+    if (lex_state == UNLEXABLE || !get_line())
+      return 0;
+    if (!lex_args()) {
+      // Substitute this line's arguments as text.
+      p = body;
+      return 0;
+    }
+    tp = 0;
+    did_minus = 0;
+  }
+  for (;;) {
+    thru_token *tok = &tokens[tp];
+    if (tok->type == THRU_ARG) {
+      int i = tok->n;
+      if (i < argc && line[argv[i]] != '\0') {
+	if (arg_is_negative[i] && !did_minus) {
+	  did_minus = 1;
+	  context_buffer = '-';
+	  return '-';
+	}
+	did_minus = 0;
+	if (++tp == ntokens)
+	  tp = -1;
+	token_double = arg_value[i];
+	context_buffer = arg_context[i];
+	return NUMBER;
+      }
+      if (++tp == ntokens)
+	tp = -1;
+      continue;
+    }
+    if (++tp == ntokens)
+      tp = -1;
+    context_buffer = tok->context;
+    switch (tok->type) {
+    case NUMBER:
+      token_double = tok->x;
+      break;
+    case ORDINAL:
+      token_int = tok->n;
+      break;
+    case LABEL:
+    case VARIABLE:
+    case TEXT:
+      token_buffer = tok->text;
+      break;
+    }
+    return tok->type;
+  }
 }
 
 int copy_thru_input::get()
 {
+  // Any tokens left of this line are lost.
+  tp = -1;
   if (ap) {
     if (*ap != '\0')
       return (unsigned char)*ap++;
@@ -1660,6 +1975,7 @@ int copy_thru_input::get()
 
 int copy_thru_input::peek()
 {
+  tp = -1;
   if (ap) {
     if (*ap != '\0')
       return (unsigned char)*ap;
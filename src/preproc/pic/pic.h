@@ -43,6 +43,9 @@ public:
   virtual int get() = 0;
   virtual int peek() = 0;
   virtual int get_location(const char **, int *);
+  // Return the next token if this input supplies tokens already lexed,
+  // or 0 if the lexer is to read characters from it.
+  virtual int get_lexed_token();
   friend class input_stack;
   friend class copy_rest_thru_input;
 };
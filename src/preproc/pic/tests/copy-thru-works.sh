@@ -0,0 +1,67 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+pic="${abs_top_builddir:-.}/pic"
+
+fail=
+
+wail () {
+    echo ...FAILED >&2
+    fail=YES
+}
+
+# Numeric arguments are bound to a body lexed only once; others are
+# substituted as text.  Both must give the same results.
+
+input='.
+.PS
+x = 10
+copy thru { print $1 + $2; print "<$3>" } until "end"
+1 2 a
+-3 4
+x 5 c
+.5 1e1
+end
+copy thru { print $1.5 } until "end"
+2
+end
+.PE
+.'
+
+output=$(echo "$input" | "$pic" 2>&1 >/dev/null)
+printf "%s\n" "$output"
+
+echo "checking that arguments are substituted" >&2
+expected='3
+<a>
+1
+<>
+15
+<c>
+10.5
+<>'
+test "$(printf "%s\n" "$output" | head -n 8)" = "$expected" || wail
+
+echo "checking that an argument joined to other text is substituted" >&2
+printf "%s\n" "$output" | sed -n 9p | grep -Fqx 2.5 || wail
+
+test -z "$fail"
+
+# vim:set ai et sw=4 ts=4 tw=72:
@@ -36,10 +36,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <stdcountof.h>
 #include <stdio.h> // EOF, FILE, fclose(), ferror(), fflush(), fileno(),
 		   // fopen(), fprintf(), fread(), fseek(), ftell(),
-		   // getc(), printf(), putchar(), rewind(), SEEK_SET,
+		   // fwrite(), getc(), printf(), rewind(), SEEK_SET,
 		   // stderr, stdin, stdout, ungetc()
 #include <stdlib.h> // calloc(), exit(), EXIT_SUCCESS, free(), malloc()
-#include <string.h> // sterror()
+#include <string.h> // memcpy(), sterror()
 #include <sys/stat.h> // fstat(), stat
 #ifdef HAVE_UCHARDET
 #include <uchardet/uchardet.h>
@@ -411,28 +411,95 @@ emacs2mime(char *emacs_enc)
   return emacs_enc;
 }
 
+// ---------------------------------------------------------
+// Buffered output.
+//
+// Converters write to the standard output stream through a
+// large buffer: runs of ASCII are copied into it in bulk and
+// escape sequences are formatted in place, sparing a stdio
+// call per character.  Anything else writing to stdout must
+// call 'flush_output' first.
+// ---------------------------------------------------------
+static char output_buffer[65536];
+static size_t output_used = 0;
+
+static void
+flush_output()
+{
+  if (output_used > 0) {
+    (void) fwrite(output_buffer, 1, output_used, stdout);
+    output_used = 0;
+  }
+}
+
+static void
+write_output(const unsigned char *p, size_t n)
+{
+  if (n > (sizeof output_buffer - output_used)) {
+    flush_output();
+    if (n >= sizeof output_buffer) {
+      (void) fwrite(p, 1, n, stdout);
+      return;
+    }
+  }
+  memcpy(output_buffer + output_used, p, n);
+  output_used += n;
+}
+
+// ---------------------------------------------------------
+// Return the length of the run of ASCII bytes at the start of
+// 'p' (at most 'n').  Test a machine word at a time for a byte
+// with its high bit set.
+// ---------------------------------------------------------
+static size_t
+ascii_run_length(const unsigned char *p, size_t n)
+{
+  static const unsigned long high_bits
+    = static_cast<unsigned long>(-1) / 0xFF * 0x80;
+  size_t i = 0;
+  while ((i + sizeof (unsigned long)) <= n) {
+    unsigned long word;
+    memcpy(&word, p + i, sizeof word);
+    if (word & high_bits)
+      break;
+    i += sizeof word;
+  }
+  while ((i < n) && (p[i] < 0x80))
+    i++;
+  return i;
+}
+
 // ---------------------------------------------------------
 // Print out Unicode entity if value is greater than 0x7F.
 // ---------------------------------------------------------
 inline void
 unicode_entity(int u)
 {
+  static const char hexdigits[] = "0123456789ABCDEF";
+  // Ensure room for the longest escape sequence, "\[u10FFFF]".
+  if ((sizeof output_buffer - output_used) < 10)
+    flush_output();
+  char *p = output_buffer + output_used;
   if (u < 0x80)
-    putchar(u);
+    *p++ = u;
   else {
+    *p++ = '\\';
     // Handle no-break space and soft hyphen specially--they are input
     // characters only, not glyphs.  See groff_char(7).
-    if (u == 0xA0) {
-      putchar('\\');
-      putchar('~');
+    if (u == 0xA0)
+      *p++ = '~';
+    else if (u == 0xAD)
+      *p++ = '%';
+    else {
+      *p++ = '[';
+      *p++ = 'u';
+      int ndigits = (u > 0xFFFFF) ? 6 : (u > 0xFFFF) ? 5 : 4;
+      for (int shift = (ndigits - 1) * 4; shift >= 0; shift -= 4)
+	*p++ = hexdigits[(u >> shift) & 0xF];
+      *p++ = ']';
     }
-    else if (u == 0xAD) {
-      putchar('\\');
-      putchar('%');
-    }
-    else
-      printf("\\[u%04X]", u);
   }
+  output_used = p - output_buffer;
 }
 
 // ---------------------------------------------------------
@@ -440,18 +507,32 @@ unicode_entity(int u)
 // normally holds the first two lines, and a file pointer.
 // ---------------------------------------------------------
 
+// Convert a block of ISO-8859-1 (aka Latin-1) to Unicode.
+static void
+convert_latin1_block(const unsigned char *p, size_t n)
+{
+  size_t i = 0;
+  while (i < n) {
+    size_t run = ascii_run_length(p + i, n - i);
+    write_output(p + i, run);
+    i += run;
+    if (i < n)
+      unicode_entity(p[i++]);
+  }
+}
+
 // Conversion from ISO-8859-1 (aka Latin-1) to Unicode.
 static void
 conversion_latin1(FILE *fp, const string &data)
 {
-  int len = data.length();
-  const unsigned char *ptr
-    = reinterpret_cast<const unsigned char *>(data.contents());
-  for (int i = 0; i < len; i++)
-    unicode_entity(ptr[i]);
-  int c = -1;
-  while ((c = getc(fp)) != EOF)
-    unicode_entity(c);
+  convert_latin1_block(
+    reinterpret_cast<const unsigned char *>(data.contents()),
+    data.length());
+  unsigned char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof buf, fp)) > 0)
+    convert_latin1_block(buf, n);
+  flush_output();
 }
 
 // A future version of groff shall support UTF-8 natively.
@@ -617,20 +698,79 @@ utf8::incomplete()
   byte = FIRST;
 }
 
+// Convert a block of UTF-8 to Unicode.  Copy runs of ASCII in
+// bulk and decode well-formed sequences lying wholly within the
+// block directly, applying the same validity checks as
+// 'utf8::add'; feed anything else (a sequence in progress, one
+// split across blocks, or an invalid one) to 'u' a byte at a
+// time.
+static void
+convert_utf8_block(utf8 &u, const unsigned char *p, size_t n)
+{
+  size_t i = 0;
+  while (i < n) {
+    if (u.byte != utf8::FIRST) {
+      u.add(p[i++]);
+      continue;
+    }
+    size_t run = ascii_run_length(p + i, n - i);
+    write_output(p + i, run);
+    i += run;
+    if (i >= n)
+      break;
+    const unsigned char *s = p + i;
+    size_t left = n - i;
+    if ((s[0] >= 0xC2) && (s[0] < 0xE0)
+	&& (left >= 2)
+	&& ((s[1] & 0xC0) == 0x80)) {
+      unicode_entity(((s[0] & 0x1F) << 6)
+		     | (s[1] ^ 0x80));
+      i += 2;
+    }
+    else if ((s[0] >= 0xE0) && (s[0] < 0xF0)
+	     && (left >= 3)
+	     && ((s[1] & 0xC0) == 0x80)
+	     && ((s[2] & 0xC0) == 0x80)
+	     && (s[0] >= 0xE1 || s[1] >= 0xA0)) {
+      unicode_entity(((s[0] & 0x1F) << 12)
+		     | ((s[1] ^ 0x80) << 6)
+		     | (s[2] ^ 0x80));
+      i += 3;
+    }
+    else if ((s[0] >= 0xF0) && (s[0] < 0xF8)
+	     && (left >= 4)
+	     && ((s[1] & 0xC0) == 0x80)
+	     && ((s[2] & 0xC0) == 0x80)
+	     && ((s[3] & 0xC0) == 0x80)
+	     && (s[0] >= 0xF1 || s[1] >= 0x90)
+	     && (s[0] < 0xF4 || (s[0] == 0xF4 && s[1] < 0x90))) {
+      unicode_entity(((s[0] & 0x07) << 18)
+		     | ((s[1] ^ 0x80) << 12)
+		     | ((s[2] ^ 0x80) << 6)
+		     | (s[3] ^ 0x80));
+      i += 4;
+    }
+    else
+      u.add(p[i++]);
+  }
+}
+
 // Conversion from UTF-8 to Unicode.
 static void
 conversion_utf8(FILE *fp, const string &data)
 {
-  utf8 u(fp);
-  int len = data.length();
-  const unsigned char *ptr
-    = reinterpret_cast<const unsigned char *>(data.contents());
-  for (int i = 0; i < len; i++)
-    u.add(ptr[i]);
-  int c = -1;
-  while ((c = getc(fp)) != EOF)
-    u.add(c);
-  return;
+  {
+    utf8 u(fp);
+    convert_utf8_block(u,
+      reinterpret_cast<const unsigned char *>(data.contents()),
+      data.length());
+    unsigned char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof buf, fp)) > 0)
+      convert_utf8_block(u, buf, n);
+    // The destructor reports an incomplete final sequence.
+  }
+  flush_output();
 }
 
 // Conversion from cp1047 (EBCDIC) to UTF-8.
@@ -679,6 +819,7 @@ conversion_cp1047(FILE *fp, const string &data)
   int c = -1;
   while ((c = getc(fp)) != EOF)
     unicode_entity(cp1047[c]);
+  flush_output();
 }
 
 // Locale-sensible conversion.
@@ -772,6 +913,7 @@ conversion_iconv(FILE *fp, const string &data, char *enc)
     - outbytes_left;
   for (int *ptr = outbuf; (char *)ptr < limit; ptr++)
     unicode_entity(*ptr);
+  flush_output();
 }
 #endif /* HAVE_ICONV */
 
@@ -31,6 +31,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <getopt.h> // getopt_long()
 
 #include "table.h"
+#include "device.h"
+#include "font.h"
 
 #define MAX_POINT_SIZE 99
 #define MAX_VERTICAL_SPACING 72
@@ -359,6 +361,7 @@ void process_input_file(FILE *fp)
 struct options {
   unsigned flags;
   int linesize;
+  int chunk_rows;
   char delim[2];
   char tab_char;
   char decimal_point_char;
@@ -367,7 +370,8 @@ struct options {
 };
 
 options::options()
-: flags(0), linesize(0), tab_char('\t'), decimal_point_char('.')
+: flags(0), linesize(0), chunk_rows(0), tab_char('\t'),
+  decimal_point_char('.')
 {
   delim[0] = delim[1] = '\0';
 }
@@ -470,6 +474,18 @@ options *process_options(table_input &in)
 	}
       }
     }
+    else if (strieq(p, "chunk")) {
+      if (!arg)
+	error("'chunk' region option requires argument in parentheses");
+      else {
+	if (sscanf(arg, "%d", &opt->chunk_rows) != 1)
+	  error("invalid argument to 'chunk' region option: '%1'", arg);
+	else if (opt->chunk_rows <= 0) {
+	  error("'chunk' region option argument must be positive");
+	  opt->chunk_rows = 0;
+	}
+      }
+    }
     else if (strieq(p, "delim")) {
       if (!arg)
 	error("'delim' region option requires argument in parentheses");
@@ -533,6 +549,11 @@ options *process_options(table_input &in)
 	  opt->decimal_point_char = arg[0];
       }
     }
+    else if (strieq(p, "measure")) {
+      if (arg)
+	error("'measure' region option does not take an argument");
+      opt->flags |= table::MEASURE;
+    }
     else if (strieq(p, "experimental")) {
       opt->flags |= table::EXPERIMENTAL;
     }
@@ -1315,16 +1336,24 @@ format *process_format(table_input &in, options *opt,
   return f;
 }
 
-table *process_data(table_input &in, format *f, options *opt)
+// Read table data into a new table object.  If the 'chunk' region
+// option is in effect, stop before the data line that would exceed its
+// row count, marking the table as having a successor; `*format_indexp`
+// carries our place in the format from one chunk to the next.
+
+table *process_data(table_input &in, format *f, options *opt,
+		    int *format_indexp, bool is_continuation)
 {
   char tab_char = opt->tab_char;
   int ncolumns = f->ncolumns;
   int current_row = 0;
-  int format_index = 0;
+  int format_index = *format_indexp;
   bool give_up = false;
   enum { DATA_INPUT_LINE, TROFF_INPUT_LINE, SINGLE_HRULE, DOUBLE_HRULE } type;
   table *tbl = new table(ncolumns, opt->flags, opt->linesize,
 			 opt->decimal_point_char);
+  if (is_continuation)
+    tbl->flags |= table::HAS_PREVIOUS_CHUNK;
   if (opt->delim[0] != '\0')
     tbl->set_delim(opt->delim[0], opt->delim[1]);
   for (;;) {
@@ -1362,6 +1391,13 @@ table *process_data(table_input &in, format *f, options *opt)
     else {
       type = DATA_INPUT_LINE;
     }
+    // Any lookahead in classifying a data line has been pushed back.
+    if ((DATA_INPUT_LINE == type) && (opt->chunk_rows > 0)
+	&& (current_row >= opt->chunk_rows)) {
+      in.unget(c);
+      tbl->flags |= table::HAS_NEXT_CHUNK;
+      break;
+    }
     switch (type) {
     case DATA_INPUT_LINE:
       {
@@ -1603,6 +1639,7 @@ table *process_data(table_input &in, format *f, options *opt)
     delete tbl;
     return 0;
   }
+  *format_indexp = format_index;
   // Do this here rather than at the beginning in case continued formats
   // change it.
   int i;
@@ -1626,13 +1663,25 @@ void process_table(table_input &in)
   options *opt = 0 /* nullptr */;
   format *fmt = 0 /* nullptr */;
   table *tbl = 0 /* nullptr */;
+  bool is_valid = false;
   if ((opt = process_options(in)) != 0 /* nullptr */
-      && (fmt = process_format(in, opt)) != 0 /* nullptr */
-      && (tbl = process_data(in, fmt, opt)) != 0 /* nullptr */) {
-    tbl->print();
-    delete tbl;
+      && (fmt = process_format(in, opt)) != 0 /* nullptr */) {
+    // Print each chunk before reading the next so that our memory use
+    // doesn't depend on the number of rows in the table.
+    bool is_continuation = false;
+    int format_index = 0;
+    while ((tbl = process_data(in, fmt, opt, &format_index,
+			       is_continuation)) != 0 /* nullptr */) {
+      tbl->print();
+      is_continuation = (tbl->flags & table::HAS_NEXT_CHUNK);
+      delete tbl;
+      if (!is_continuation) {
+	is_valid = true;
+	break;
+      }
+    }
   }
-  else {
+  if (!is_valid) {
     error("giving up on this table region");
     while (in.get() != EOF)
       ;
@@ -1646,7 +1695,7 @@ void process_table(table_input &in)
 static void usage(FILE *stream)
 {
   fprintf(stream,
-"usage: %s [-C] [file ...]\n"
+"usage: %s [-C] [-F dir] [-T dev] [file ...]\n"
 "usage: %s {-v | --version}\n"
 "usage: %s --help\n",
 	 program_name, program_name, program_name);
@@ -1669,13 +1718,19 @@ int main(int argc, char **argv)
     { "version", no_argument, 0 /* nullptr */, 'v' },
     { 0 /* nullptr */, 0, 0 /* nullptr */, 0 }
   };
-  while ((opt = getopt_long(argc, argv, ":vC", long_options,
+  while ((opt = getopt_long(argc, argv, ":vCF:T:", long_options,
 			    0 /* nullptr */))
          != EOF)
     switch (opt) {
     case 'C':
       compatible_flag = 1;
       break;
+    case 'F':
+      font::command_line_font_dir(optarg);
+      break;
+    case 'T':
+      device = optarg;
+      break;
     case 'v':
       {
 	printf("GNU tbl (groff) version %s\n", Version_string);
@@ -1695,7 +1750,6 @@ int main(int argc, char **argv)
       usage(stderr);
       exit(2);
       break;
-    // in case we ever accept options that take arguments
     case ':':
       error("command-line option '%1' requires an argument",
            char(optopt));
@@ -22,8 +22,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <stdio.h> // fputs(), fwrite(), putchar(), stdout
 #include <stdlib.h> // free()
+#include <string.h> // strcmp(), strlen()
 
 #include "table.h"
+#include "device.h"
+#include "font.h"
 
 #define BAR_HEIGHT ".25m"
 #define DOUBLE_LINE_SEP "2p"
@@ -80,6 +83,7 @@ const int DEFAULT_COLUMN_SEPARATION = 3;
 #define STARTING_PAGE_REG PREFIX "starting-page"
 #define IS_BOXED_REG PREFIX "is-boxed"
 #define PREVIOUS_PAGE_REG PREFIX "previous-page"
+#define MEASURED_REG PREFIX "measured"
 
 // this must be one character
 #define COMPATIBLE_REG PREFIX "c"
@@ -105,6 +109,7 @@ const int DEFAULT_COLUMN_SEPARATION = 3;
 #define COLUMN_END_PREFIX PREFIX "ce"
 #define COLUMN_DIVIDE_PREFIX PREFIX "cd"
 #define ROW_TOP_PREFIX PREFIX "rt"
+#define CHUNK_PREFIX PREFIX "chunk-"
 
 string block_width_reg(int, int);
 string block_diversion_name(int, int);
@@ -153,6 +158,332 @@ void prints(const string &s)
     fwrite(s.contents(), 1, s.length(), stdout);
 }
 
+// Support for the `measure` region option.  We measure text entries
+// with the device's font metrics as GNU troff would format them in the
+// font and type size it starts with, and it uses our measurements only
+// if the table begins in that state.
+
+static bool is_device_loaded = false;
+static string default_font_name;
+static int default_type_size;	// in scaled points
+
+static glyph *glyph_f;
+static glyph *glyph_i;
+static glyph *glyph_l;
+static glyph *glyph_ff;
+static glyph *glyph_fi;
+static glyph *glyph_fl;
+static glyph *glyph_ffi;
+static glyph *glyph_ffl;
+
+// Return the name of the font GNU troff selects given `nm`, or an empty
+// string if it is a mounting position.
+
+static string resolve_font_name(const string &nm)
+{
+  string result;
+  if (nm.empty() || csdigit(nm[0]))
+    return result;
+  string s(nm);
+  s += '\0';
+  if (font::family != 0 /* nullptr */ && font::style_table != 0)
+    for (int i = 0; font::style_table[i] != 0; i++)
+      if (strcmp(font::style_table[i], s.contents()) == 0) {
+	result = font::family;
+	break;
+      }
+  result += nm;
+  return result;
+}
+
+static bool load_device()
+{
+  static bool have_tried = false;
+  if (!have_tried) {
+    have_tried = true;
+    if (0 /* nullptr */ == font::load_desc())
+      warning("cannot load 'DESC' description file for device"
+	      " '%1'; not measuring table entries", device);
+    else {
+      is_device_loaded = true;
+      default_font_name = resolve_font_name("R");
+      default_type_size = 10 * font::sizescale;
+      glyph_f = name_to_glyph("f");
+      glyph_i = name_to_glyph("i");
+      glyph_l = name_to_glyph("l");
+      glyph_ff = name_to_glyph("ff");
+      glyph_fi = name_to_glyph("fi");
+      glyph_fl = name_to_glyph("fl");
+      glyph_ffi = name_to_glyph("Fi");
+      glyph_ffl = name_to_glyph("Fl");
+    }
+  }
+  return is_device_loaded;
+}
+
+struct measured_font {
+  string name;
+  font *fm;			// null if it can't be loaded
+  measured_font *next;
+};
+
+static measured_font *measured_font_list = 0 /* nullptr */;
+
+static font *find_font(const string &nm)
+{
+  measured_font *p;
+  for (p = measured_font_list; p != 0 /* nullptr */; p = p->next)
+    if (p->name == nm)
+      return p->fm;
+  p = new measured_font;
+  p->name = nm;
+  string s(nm);
+  s += '\0';
+  p->fm = font::load_font(s.contents(), false /* want diagnostic */);
+  p->next = measured_font_list;
+  measured_font_list = p;
+  return p->fm;
+}
+
+// GNU troff snaps other type sizes to the nearest valid one; we don't
+// bother.
+
+static bool is_valid_type_size(int n)
+{
+  for (int *p = font::sizes; *p != 0; p += 2)
+    if (n >= p[0] && n <= p[1])
+      return true;
+  return false;
+}
+
+static glyph *get_ligature(font *fm, glyph *g1, glyph *g2)
+{
+  glyph *lig = 0 /* nullptr */;
+  if (g1 == glyph_f) {
+    if (g2 == glyph_f && fm->has_ligature(font::LIG_ff))
+      lig = glyph_ff;
+    else if (g2 == glyph_i && fm->has_ligature(font::LIG_fi))
+      lig = glyph_fi;
+    else if (g2 == glyph_l && fm->has_ligature(font::LIG_fl))
+      lig = glyph_fl;
+  }
+  else if (g1 == glyph_ff) {
+    if (g2 == glyph_i && fm->has_ligature(font::LIG_ffi))
+      lig = glyph_ffi;
+    else if (g2 == glyph_l && fm->has_ligature(font::LIG_ffl))
+      lig = glyph_ffl;
+  }
+  if (lig != 0 /* nullptr */ && fm->contains(lig))
+    return lig;
+  return 0 /* nullptr */;
+}
+
+// GNU troff merges each glyph it formats with the node before it into
+// a ligature or a kerned pair, and the second member of a kerned pair
+// goes on merging with the glyphs that follow; when it does, the first
+// member gets to merge with the result.  A `glyph_run` represents the
+// node glyphs can still merge with as a chain of kerned pairs: pair `i`
+// kerns `first[i]` by `kern[i]` against pair `i + 1`, and `last` ends
+// the chain.
+
+class glyph_run {
+  font *fm;
+  int size;
+  glyph **first;
+  int *kern;
+  int depth;
+  glyph *last;
+  bool merge(int, glyph *);
+public:
+  glyph_run(font *, int, int);
+  ~glyph_run();
+  void start(glyph *);
+  bool add(glyph *);
+  int width();
+};
+
+glyph_run::glyph_run(font *f, int sz, int maxlen)
+: fm(f), size(sz), depth(0), last(0 /* nullptr */)
+{
+  first = new glyph *[maxlen];
+  kern = new int[maxlen];
+}
+
+glyph_run::~glyph_run()
+{
+  delete[] first;
+  delete[] kern;
+}
+
+void glyph_run::start(glyph *g)
+{
+  depth = 0;
+  last = g;
+}
+
+bool glyph_run::merge(int i, glyph *g)
+{
+  if (i == depth) {
+    glyph *lig = get_ligature(fm, last, g);
+    if (lig != 0 /* nullptr */) {
+      last = lig;
+      return true;
+    }
+    int k = fm->get_kern(last, g, size);
+    if (0 == k)
+      return false;
+    first[depth] = last;
+    kern[depth] = k;
+    depth++;
+    last = g;
+    return true;
+  }
+  if (!merge(i + 1, g))
+    return false;
+  if (i + 1 == depth) {
+    glyph *lig = get_ligature(fm, first[i], last);
+    if (lig != 0 /* nullptr */) {
+      depth = i;
+      last = lig;
+    }
+    else {
+      int k = fm->get_kern(first[i], last, size);
+      if (k != 0)
+	kern[i] = k;
+    }
+  }
+  return true;
+}
+
+// Return whether `g` merged with the run; if not, the caller should
+// start a new one.
+
+bool glyph_run::add(glyph *g)
+{
+  if (0 /* nullptr */ == last)
+    return false;
+  return merge(0, g);
+}
+
+int glyph_run::width()
+{
+  if (0 /* nullptr */ == last)
+    return 0;
+  int w = fm->get_width(last, size);
+  for (int i = 0; i < depth; i++)
+    w += fm->get_width(first[i], size) + kern[i];
+  return w;
+}
+
+// Store in `*widthp` the width in basic units of the `len` characters
+// at `s` in a table entry with modifier `m`; return whether we can
+// tell.  We can't if they include an escape sequence, an eqn delimiter,
+// or something else GNU troff might not format as a glyph of the font,
+// or a run of spaces, which can end a sentence.
+
+static bool measure_text(const char *s, int len, const entry_modifier *m,
+			 const char *delim, int *widthp)
+{
+  if (!load_device())
+    return false;
+  int size = default_type_size;
+  if (m->type_size.whole != 0) {
+    int n = m->type_size.whole * font::sizescale;
+    if (m->type_size.relativity == size_expression::INCREMENT)
+      size += n;
+    else if (m->type_size.relativity == size_expression::DECREMENT)
+      size -= n;
+    else
+      size = n;
+  }
+  if (!is_valid_type_size(size))
+    return false;
+  font *fm = find_font(m->font.empty() ? default_font_name
+			: resolve_font_name(m->font));
+  if (0 /* nullptr */ == fm)
+    return false;
+  glyph_run run(fm, size, len);
+  int w = 0;
+  for (int i = 0; i < len; i++) {
+    unsigned char c = s[i];
+    if (' ' == c) {
+      if (0 == i || (len - 1) == i || ' ' == s[i + 1])
+	return false;
+      w += run.width();
+      run.start(0 /* nullptr */);
+      w += fm->get_space_width(size);
+      continue;
+    }
+    if (c <= ' ' || c >= 127 || '\\' == c
+	|| (delim[0] != '\0' && (delim[0] == c || delim[1] == c)))
+      return false;
+    char nm[2] = { char(c), '\0' };
+    glyph *g = name_to_glyph(nm);
+    if (!fm->contains(g))
+      return false;
+    if (!run.add(g)) {
+      w += run.width();
+      run.start(g);
+    }
+  }
+  *widthp = w + run.width();
+  return true;
+}
+
+// The largest width measured for each register, in order of first
+// appearance
+
+class width_maxima {
+  struct maximum {
+    string reg;
+    int width;
+    maximum *next;
+  };
+  maximum *list;
+  maximum **tailp;
+public:
+  width_maxima();
+  ~width_maxima();
+  void note(const string &, int);
+  void print();
+};
+
+width_maxima::width_maxima()
+: list(0 /* nullptr */), tailp(&list)
+{
+}
+
+width_maxima::~width_maxima()
+{
+  while (list != 0 /* nullptr */) {
+    maximum *tem = list;
+    list = list->next;
+    delete tem;
+  }
+}
+
+void width_maxima::note(const string &reg, int w)
+{
+  for (maximum *p = list; p != 0 /* nullptr */; p = p->next)
+    if (p->reg == reg) {
+      if (w > p->width)
+	p->width = w;
+      return;
+    }
+  maximum *p = new maximum;
+  p->reg = reg;
+  p->width = w;
+  p->next = 0 /* nullptr */;
+  *tailp = p;
+  tailp = &p->next;
+}
+
+void width_maxima::print()
+{
+  for (maximum *p = list; p != 0 /* nullptr */; p = p->next)
+    printfs(".nr %1 \\n[%1]>?%2\n", p->reg, as_string(p->width));
+}
+
 struct horizontal_span {
   horizontal_span *next;
   int start_col;
@@ -169,6 +500,7 @@ friend class table;
   table_entry *next;
   int input_lineno;
   const char *input_filename;
+  bool is_measured;
 protected:
   int start_row;
   int end_row;
@@ -182,6 +514,10 @@ public:
   virtual ~table_entry();
   virtual int divert(int, const string *, int *, int);
   virtual void do_width();
+  virtual bool measure(const char *);
+  virtual void do_measured_width(width_maxima *);
+  virtual int get_widest_measurement();
+  virtual void print_widest_measured_text();
   virtual void do_depth();
   virtual void print() = 0;
   virtual void position_vertically() = 0;
@@ -216,6 +552,7 @@ protected:
 public:
   text_entry(const table *, const entry_modifier *, char *);
   ~text_entry();
+  void print_widest_measured_text();
 };
 
 void text_entry::print_contents()
@@ -232,9 +569,13 @@ public:
 };
 
 class simple_text_entry : public text_entry {
+  int measured_width;
 public:
   simple_text_entry(const table *, const entry_modifier *, char *);
   void do_width();
+  bool measure(const char *);
+  void do_measured_width(width_maxima *);
+  int get_widest_measurement();
 };
 
 class left_text_entry : public simple_text_entry {
@@ -260,16 +601,26 @@ public:
 
 class numeric_text_entry : public text_entry {
   int dot_pos;
+  int measured_left_width;
+  int measured_right_width;
 public:
   numeric_text_entry(const table *, const entry_modifier *, char *, int);
   void do_width();
+  bool measure(const char *);
+  void do_measured_width(width_maxima *);
+  int get_widest_measurement();
+  void print_widest_measured_text();
   void simple_print(int);
 };
 
 class alphabetic_text_entry : public text_entry {
+  int measured_width;
 public:
   alphabetic_text_entry(const table *, const entry_modifier *, char *);
   void do_width();
+  bool measure(const char *);
+  void do_measured_width(width_maxima *);
+  int get_widest_measurement();
   void simple_print(int);
   void add_tab();
 };
@@ -354,7 +705,7 @@ public:
 };
 
 table_entry::table_entry(const table *p, const entry_modifier *m)
-: next(0), input_lineno(-1), input_filename(0),
+: next(0), input_lineno(-1), input_filename(0), is_measured(false),
   start_row(-1), end_row(-1), start_col(-1), end_col(-1), parent(p),
   mod(m)
 {
@@ -373,6 +724,30 @@ void table_entry::do_width()
 {
 }
 
+// Measure the entry's width(s) for do_measured_width(), given the eqn
+// delimiters; return whether we could.
+
+bool table_entry::measure(const char *)
+{
+  return false;
+}
+
+void table_entry::do_measured_width(width_maxima *)
+{
+}
+
+// Return the largest width measure() found.  The text measured to it
+// is printed by print_widest_measured_text(), for troff to check.
+
+int table_entry::get_widest_measurement()
+{
+  return 0;
+}
+
+void table_entry::print_widest_measured_text()
+{
+}
+
 single_line_entry *table_entry::to_single_line_entry()
 {
   return 0;
@@ -485,6 +860,11 @@ text_entry::~text_entry()
   free(contents); // `malloc()`ed by `string::extract()`
 }
 
+void text_entry::print_widest_measured_text()
+{
+  print_contents();
+}
+
 repeated_char_entry::repeated_char_entry(const table *p,
 					 const entry_modifier *m,
 					 char *s)
@@ -505,7 +885,7 @@ void repeated_char_entry::simple_print(int)
 
 simple_text_entry::simple_text_entry(const table *p,
 				     const entry_modifier *m, char *s)
-: text_entry(p, m, s)
+: text_entry(p, m, s), measured_width(0)
 {
 }
 
@@ -518,6 +898,22 @@ void simple_text_entry::do_width()
   prints(DELIMITER_CHAR "\n");
 }
 
+bool simple_text_entry::measure(const char *delim)
+{
+  return measure_text(contents, strlen(contents), mod, delim,
+		      &measured_width);
+}
+
+void simple_text_entry::do_measured_width(width_maxima *w)
+{
+  w->note(span_width_reg(start_col, end_col), measured_width);
+}
+
+int simple_text_entry::get_widest_measurement()
+{
+  return measured_width;
+}
+
 left_text_entry::left_text_entry(const table *p,
 				 const entry_modifier *m, char *s)
 : simple_text_entry(p, m, s)
@@ -578,7 +974,8 @@ void center_text_entry::add_tab()
 numeric_text_entry::numeric_text_entry(const table *p,
 				       const entry_modifier *m,
 				       char *s, int pos)
-: text_entry(p, m, s), dot_pos(pos)
+: text_entry(p, m, s), dot_pos(pos), measured_left_width(0),
+  measured_right_width(0)
 {
 }
 
@@ -610,6 +1007,43 @@ void numeric_text_entry::do_width()
   }
 }
 
+bool numeric_text_entry::measure(const char *delim)
+{
+  return (measure_text(contents, dot_pos, mod, delim,
+		       &measured_left_width)
+	  && measure_text(contents + dot_pos, strlen(contents + dot_pos),
+			  mod, delim, &measured_right_width));
+}
+
+void numeric_text_entry::do_measured_width(width_maxima *w)
+{
+  printfs(".nr %1 %2\n", block_width_reg(start_row, start_col),
+	  as_string(measured_left_width));
+  if (dot_pos != 0)
+    w->note(span_left_numeric_width_reg(start_col, end_col),
+	    measured_left_width);
+  if (contents[dot_pos] != '\0')
+    w->note(span_right_numeric_width_reg(start_col, end_col),
+	    measured_right_width);
+}
+
+int numeric_text_entry::get_widest_measurement()
+{
+  return (measured_left_width > measured_right_width
+	  ? measured_left_width : measured_right_width);
+}
+
+void numeric_text_entry::print_widest_measured_text()
+{
+  set_inline_modifier(mod);
+  if (measured_left_width > measured_right_width)
+    for (int i = 0; i < dot_pos; i++)
+      prints(contents[i]);
+  else
+    prints(contents + dot_pos);
+  restore_inline_modifier(mod);
+}
+
 void numeric_text_entry::simple_print(int)
 {
   printfs("\\h'|(\\n[%1]u-\\n[%2]u-\\n[%3]u/2u+\\n[%2]u+\\n[%4]u-\\n[%5]u)'",
@@ -624,7 +1058,7 @@ void numeric_text_entry::simple_print(int)
 alphabetic_text_entry::alphabetic_text_entry(const table *p,
 					     const entry_modifier *m,
 					     char *s)
-: text_entry(p, m, s)
+: text_entry(p, m, s), measured_width(0)
 {
 }
 
@@ -637,6 +1071,23 @@ void alphabetic_text_entry::do_width()
   prints(DELIMITER_CHAR "\n");
 }
 
+bool alphabetic_text_entry::measure(const char *delim)
+{
+  return measure_text(contents, strlen(contents), mod, delim,
+		      &measured_width);
+}
+
+void alphabetic_text_entry::do_measured_width(width_maxima *w)
+{
+  w->note(span_alphabetic_width_reg(start_col, end_col),
+	  measured_width);
+}
+
+int alphabetic_text_entry::get_widest_measurement()
+{
+  return measured_width;
+}
+
 void alphabetic_text_entry::simple_print(int)
 {
   printfs("\\h'|\\n[%1]u'", column_start_reg(start_col));
@@ -661,7 +1112,7 @@ block_entry::block_entry(const table *p, const entry_modifier *m,
 
 block_entry::~block_entry()
 {
-  delete[] contents;
+  free(contents); // `malloc()`ed by `string::extract()`
 }
 
 void block_entry::position_vertically()
@@ -2156,6 +2607,35 @@ void init_span_reg(int start_col, int end_col)
 	  span_right_numeric_width_reg(start_col, end_col));
 }
 
+// When a table is emitted in chunks, each chunk starts its column
+// width computation where the previous one left off, so that the
+// columns of successive chunks line up (unless a later chunk holds a
+// wider entry, which widens its column from then on).
+
+void save_span_reg(int col)
+{
+  printfs(".nr " CHUNK_PREFIX "%1 \\n[%1]\n"
+	  ".nr " CHUNK_PREFIX "%2 \\n[%2]\n"
+	  ".nr " CHUNK_PREFIX "%3 \\n[%3]\n"
+	  ".nr " CHUNK_PREFIX "%4 \\n[%4]\n",
+	  span_width_reg(col, col),
+	  span_alphabetic_width_reg(col, col),
+	  span_left_numeric_width_reg(col, col),
+	  span_right_numeric_width_reg(col, col));
+}
+
+void restore_span_reg(int col)
+{
+  printfs(".nr %1 \\n[" CHUNK_PREFIX "%1]\n"
+	  ".nr %2 \\n[" CHUNK_PREFIX "%2]\n"
+	  ".nr %3 \\n[" CHUNK_PREFIX "%3]\n"
+	  ".nr %4 \\n[" CHUNK_PREFIX "%4]\n",
+	  span_width_reg(col, col),
+	  span_alphabetic_width_reg(col, col),
+	  span_left_numeric_width_reg(col, col),
+	  span_right_numeric_width_reg(col, col));
+}
+
 void compute_span_width(int start_col, int end_col)
 {
   printfs(".nr %1 \\n[%1]>?(\\n[%2]+\\n[%3])\n"
@@ -2477,6 +2957,75 @@ void table::make_columns_equal()
   }
 }
 
+static bool is_same_size(const size_expression &s1,
+			 const size_expression &s2)
+{
+  return (s1.whole == s2.whole) && (s1.relativity == s2.relativity);
+}
+
+// Emit the widths of the text entries we can measure, and have troff
+// fall back to measuring them itself if the table doesn't begin in the
+// state we measured them in.  Requests such as `cs`, `bd`, and `tkf`
+// change widths without changing any state we can test, so also have
+// troff compare its width of the widest entry in each font and size
+// with ours.
+
+void table::measure_widths()
+{
+  table_entry *q;
+  int nmeasured = 0;
+  for (q = entry_list; q; q = q->next)
+    if (!q->mod->zero_width && q->measure(delim)) {
+      q->is_measured = true;
+      nmeasured++;
+    }
+  if (0 == nmeasured)
+    return;
+  prints(".nr " MEASURED_REG " 0\n");
+  printfs(".if '\\*[.T]'%1' .if '\\n[.fn]'%2' ", device,
+	  default_font_name);
+  if (font::family != 0 /* nullptr */ && font::style_table != 0)
+    printfs(".if '\\n[.fam]'%1' ", font::family);
+  printfs(".if (\\n[.ps]=%1)&(\\n[.ss]=12)&\\n[.kern]&(\\n[.lg]=1)"
+	  " .nr " MEASURED_REG " 1\n", as_string(default_type_size));
+  table_entry **widest = new table_entry *[nmeasured];
+  int nwidest = 0;
+  for (q = entry_list; q; q = q->next)
+    if (q->is_measured) {
+      int i;
+      for (i = 0; i < nwidest; i++)
+	if ((widest[i]->mod->font == q->mod->font)
+	    && is_same_size(widest[i]->mod->type_size,
+			    q->mod->type_size))
+	  break;
+      if (i == nwidest)
+	widest[nwidest++] = q;
+      else if (q->get_widest_measurement()
+	       > widest[i]->get_widest_measurement())
+	widest[i] = q;
+    }
+  for (int i = 0; i < nwidest; i++)
+    if (widest[i]->get_widest_measurement() > 0) {
+      prints(".if \\n[" MEASURED_REG "] .if !(\\w" DELIMITER_CHAR);
+      widest[i]->print_widest_measured_text();
+      printfs(DELIMITER_CHAR "=%1) .nr " MEASURED_REG " 0\n",
+	      as_string(widest[i]->get_widest_measurement()));
+    }
+  delete[] widest;
+  prints(".ie \\n[" MEASURED_REG "] \\{\\\n");
+  width_maxima w;
+  for (q = entry_list; q; q = q->next)
+    if (q->is_measured)
+      q->do_measured_width(&w);
+  w.print();
+  prints(".\\}\n"
+	 ".el \\{\\\n");
+  for (q = entry_list; q; q = q->next)
+    if (q->is_measured)
+      q->do_width();
+  prints(".\\}\n");
+}
+
 void table::compute_widths()
 {
   prints(".\\\" compute column widths\n");
@@ -2486,20 +3035,34 @@ void table::compute_widths()
   // These values get refined later.
   prints(".nr " SEPARATION_FACTOR_REG " 1n\n");
   for (i = 0; i < ncolumns; i++) {
-    init_span_reg(i, i);
-    if (!minimum_width[i].empty())
-      printfs(".nr %1 (n;%2)\n", span_width_reg(i, i), minimum_width[i]);
+    if (flags & HAS_PREVIOUS_CHUNK) {
+      restore_span_reg(i);
+      if (!minimum_width[i].empty())
+	printfs(".nr %1 \\n[%1]>?(n;%2)\n", span_width_reg(i, i),
+		minimum_width[i]);
+    }
+    else {
+      init_span_reg(i, i);
+      if (!minimum_width[i].empty())
+	printfs(".nr %1 (n;%2)\n", span_width_reg(i, i),
+		minimum_width[i]);
+    }
   }
   for (p = span_list; p; p = p->next)
     init_span_reg(p->start_col, p->end_col);
   // Compute all field widths except for blocks.
   table_entry *q;
+  if (flags & MEASURE)
+    measure_widths();
   for (q = entry_list; q; q = q->next)
-    if (!q->mod->zero_width)
+    if (!q->mod->zero_width && !q->is_measured)
       q->do_width();
   // Compute all span widths, not handling blocks yet.
   for (i = 0; i < ncolumns; i++)
     compute_span_width(i, i);
+  if (flags & HAS_NEXT_CHUNK)
+    for (i = 0; i < ncolumns; i++)
+      save_span_reg(i);
   for (p = span_list; p; p = p->next)
     compute_span_width(p->start_col, p->end_col);
   // Making columns equal normally increases the width of some columns.
@@ -3122,7 +3685,15 @@ void table::do_top()
     prints(".nr " IS_BOXED_REG " 0\n");
   if (!(flags & NOKEEP) && (flags & (BOX | DOUBLEBOX | ALLBOX)))
     prints("." TABLE_KEEP_MACRO_NAME "\n");
-  if (flags & DOUBLEBOX) {
+  if (flags & HAS_PREVIOUS_CHUNK) {
+    // The box, if any, is already open; only `allbox` needs a rule
+    // between this chunk's first row and the previous chunk's last.
+    if (flags & DOUBLEBOX)
+      prints("." REPEATED_MARK_MACRO " " TOP_REG "\n");
+    else if (flags & ALLBOX)
+      print_single_hrule(0);
+  }
+  else if (flags & DOUBLEBOX) {
     prints(".ls 1\n"
 	   ".vs " LINE_SEP ">?\\n[.V]u\n"
 	   "\\v'" BODY_DEPTH "'\\s[\\n[" LINESIZE_REG "]]\\D'l \\n[TW]u 0'\\s0\n"
@@ -3166,8 +3737,12 @@ void table::do_bottom()
   if (!(flags & NOKEEP))
     prints(".if \\n[" USE_KEEPS_REG "] ." RELEASE_MACRO_NAME "\n");
   printfs(".mk %1\n", row_top_reg(nrows));
-  prints(".nr " NEED_BOTTOM_RULE_REG " 1\n"
-	 ".nr T. 1\n"
+  // A chunk followed by another leaves the box open.
+  if (flags & HAS_NEXT_CHUNK)
+    prints(".nr " NEED_BOTTOM_RULE_REG " 0\n");
+  else
+    prints(".nr " NEED_BOTTOM_RULE_REG " 1\n");
+  prints(".nr T. 1\n"
 	 // protect # in macro name against eqn
 	 ".ig\n"
 	 ".EQ\n"
@@ -3182,17 +3757,19 @@ void table::do_bottom()
 	 "..\n");
   if (!(flags & NOKEEP) && (flags & (BOX | DOUBLEBOX | ALLBOX)))
     prints("." TABLE_RELEASE_MACRO_NAME "\n");
-  if (flags & DOUBLEBOX)
-    prints(".sp " DOUBLE_LINE_SEP "\n");
-  // Horizontal box lines take up an entire row on nroff devices (maybe
-  // a half-row if we ever support [emulators of] devices like the
-  // Teletype Model 37 with half-line motions).
-  if (flags & (BOX | DOUBLEBOX | ALLBOX))
-    prints(".if n .sp \\\" avoid overprinting box bottom\n");
-  // Space again for the doublebox option, until we can draw that more
-  // attractively; see Savannah #43637.
-  if (flags & DOUBLEBOX)
-    prints(".if n .sp \\\" avoid overprinting doublebox bottom\n");
+  if (!(flags & HAS_NEXT_CHUNK)) {
+    if (flags & DOUBLEBOX)
+      prints(".sp " DOUBLE_LINE_SEP "\n");
+    // Horizontal box lines take up an entire row on nroff devices
+    // (maybe a half-row if we ever support [emulators of] devices like
+    // the Teletype Model 37 with half-line motions).
+    if (flags & (BOX | DOUBLEBOX | ALLBOX))
+      prints(".if n .sp \\\" avoid overprinting box bottom\n");
+    // Space again for the doublebox option, until we can draw that
+    // more attractively; see Savannah #43637.
+    if (flags & DOUBLEBOX)
+      prints(".if n .sp \\\" avoid overprinting doublebox bottom\n");
+  }
   prints("." RESET_MACRO_NAME "\n"
 	 ".nn \\n[" SAVED_NUMBERING_SUPPRESSION_COUNT "]\n"
 	 ".ie \\n[" SAVED_NUMBERING_ENABLED "] "
@@ -103,6 +103,7 @@ class table {
   void do_vspan(int r, int c);
   void allocate(int r);
   void compute_widths();
+  void measure_widths();
   void divide_span(int, int);
   void sum_columns(int, int, int);
   void compute_total_separation();
@@ -141,6 +142,10 @@ public:
     HAS_TOP_HRULE  = 0x00000200,
     HAS_DATA_HRULE = 0x00000400,
     GAP_EXPAND     = 0x00000800,
+    // The next two describe a table emitted in chunks (see `chunk`).
+    HAS_PREVIOUS_CHUNK = 0x00001000,
+    HAS_NEXT_CHUNK = 0x00002000,
+    MEASURE        = 0x00004000,
     EXPERIMENTAL   = 0x80000000 // undocumented
     };
   char *expand;
@@ -0,0 +1,62 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+tbl="${abs_top_builddir:-.}/tbl"
+
+fail=
+
+wail () {
+    echo ...FAILED >&2
+    fail=YES
+}
+
+# Ensure that a table emitted in chunks looks like one that isn't, when
+# the first chunk has the widest entries.
+
+input='.TS
+box chunk(2) tab(@);
+l n.
+epsilon@333.125
+beta@22.25
+_
+gamma@33
+delta@4.1
+alpha@5
+.TE'
+
+echo "checking that chunked table has one box" >&2
+chunked=$(printf "%s\n" "$input" | "$groff" -t -Tascii)
+echo "$chunked"
+whole=$(printf "%s\n" "$input" | sed 's/ chunk(2)//' \
+    | "$groff" -t -Tascii)
+echo "$whole"
+test "$chunked" = "$whole" || wail
+
+echo "checking that tbl emits a chunk per two rows" >&2
+output=$(printf "%s\n" "$input" | "$tbl")
+printf "%s\n" "$output" | grep -c '^\.\\" do top' | grep -qx 3 || wail
+
+echo "checking that column widths carry over to later chunks" >&2
+printf "%s\n" "$output" | grep -Fq '.nr 3w0 \n[3chunk-3w0]' || wail
+
+test -z "$fail"
+
+# vim:set ai et sw=4 ts=4 tw=72:
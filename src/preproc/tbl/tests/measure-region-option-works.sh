@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+tbl="${abs_top_builddir:-.}/tbl"
+
+fail=
+
+wail () {
+    echo ...FAILED >&2
+    fail=YES
+}
+
+# Ensure that column widths tbl measures itself match those troff
+# measures, including kerning and ligatures.
+
+input='.TS
+measure tab(@);
+l n cfB a rp12.
+AVOW office@3.14159@Toffee@WAVE@affluent
+To yawn@-22.5@LT@Ta@x
+\fIescaped\fP@1000@fiffle@y@ffl
+.TE'
+
+for device in ps utf8
+do
+    echo "checking measured table on device '$device'" >&2
+    measured=$(printf "%s\n" "$input" | "$groff" -t -T$device -Z)
+    unmeasured=$(printf "%s\n" "$input" | sed 's/^measure //' \
+        | "$groff" -t -T$device -Z)
+    test "$measured" = "$unmeasured" || wail
+done
+
+echo "checking that tbl emits literal widths" >&2
+output=$(printf "%s\n" "$input" | "$tbl" -Tps)
+echo "$output"
+printf "%s\n" "$output" | grep -Eq '^\.nr 3w0 \\n\[3w0\]>\?[0-9]+$' \
+    || wail
+
+echo "checking that tbl leaves escape sequences to troff" >&2
+printf "%s\n" "$output" | grep -Fq '\w\[tbl]\fIescaped\fP\[tbl]' || wail
+
+echo "checking fallback when table begins in another font" >&2
+measured=$(printf ".ft B\n%s\n" "$input" | "$groff" -t -Tps -Z)
+unmeasured=$(printf ".ft B\n%s\n" "$input" | sed 's/^measure //' \
+    | "$groff" -t -Tps -Z)
+test "$measured" = "$unmeasured" || wail
+
+# Constant spacing, artificial emboldening, and track kerning change
+# widths without changing any state tbl's output can test.
+for request in '.cs R 20' '.bd R 3' '.tkf R 8 1p 12 2p' '.bd B 3'
+do
+    echo "checking fallback after '$request'" >&2
+    measured=$(printf "%s\n%s\n" "$request" "$input" \
+        | "$groff" -t -Tps -Z)
+    unmeasured=$(printf "%s\n%s\n" "$request" "$input" \
+        | sed 's/^measure //' | "$groff" -t -Tps -Z)
+    test "$measured" = "$unmeasured" || wail
+done
+
+test -z "$fail"
+
+# vim:set ai et sw=4 ts=4 tw=72:
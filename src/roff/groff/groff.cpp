@@ -52,6 +52,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "device.h"
 #include "pipeline.h"
 #include "relocate.h"
+#include "rendercache.h"
 #include "defs.h"
 
 #define GXDITVIEW "gxditview"
@@ -113,6 +114,7 @@ bool need_postdriver = true;
 possible_command commands[NCOMMANDS];
 
 int run_commands(bool no_pipe);
+int run_commands_cached(const char *dir, int nfiles, char **files);
 void print_commands(FILE *);
 void append_arg_to_string(const char *arg, string &str);
 void handle_unknown_desc_command(const char *command, const char *arg,
@@ -137,6 +139,14 @@ static void xsetenv(const char *name, const char *value, int overwrite)
   return;
 }
 
+// GNU troff reads UTF-8 itself (see its `-K` option); preconv(1) is
+// needed only for other encodings.
+static bool is_utf8_encoding_name(const char *s)
+{
+  return ((strcasecmp(s, "utf-8") == 0)
+	  || (strcasecmp(s, "utf8") == 0));
+}
+
 static void xexit(int status) {
   free(spooler);
   free(predriver);
@@ -152,6 +162,7 @@ int main(int argc, char **argv)
   assert(NCOMMANDS <= MAX_COMMANDS);
   string Pargs, Largs, Fargs;
   int Kflag = 0;
+  bool is_K_utf8 = false;	// -K named UTF-8, which troff decodes
   bool want_version_info = false;
   int Vflag = 0;
   int zflag = 0;
@@ -206,6 +217,11 @@ int main(int argc, char **argv)
     case 'K':
       commands[PRECONV_INDEX].append_arg("-e", optarg);
       Kflag = 1;
+      is_K_utf8 = is_utf8_encoding_name(optarg);
+      if (is_K_utf8) {
+	commands[TROFF_INDEX].append_arg("-K", "utf-8");
+	break;
+      }
       // fall through
     case 'k':
       commands[PRECONV_INDEX].set_name("preconv");
@@ -396,10 +412,15 @@ int main(int argc, char **argv)
   }
   if (need_pic)
     commands[PIC_INDEX].set_name(command_prefix, "pic");
-  if (encoding != 0 /* nullptr */) {
-    commands[PRECONV_INDEX].set_name("preconv");
-    if (!Kflag && *encoding)
-      commands[PRECONV_INDEX].append_arg("-e", encoding);
+  // An encoding given with -K overrides GROFF_ENCODING.
+  if ((encoding != 0 /* nullptr */) && !is_K_utf8) {
+    if (!Kflag && is_utf8_encoding_name(encoding))
+      commands[TROFF_INDEX].append_arg("-K", "utf-8");
+    else {
+      commands[PRECONV_INDEX].set_name("preconv");
+      if (!Kflag && *encoding)
+	commands[PRECONV_INDEX].append_arg("-e", encoding);
+    }
   }
   if (is_safer_mode_locked) {
     commands[TROFF_INDEX].insert_arg("-S");
@@ -502,6 +523,7 @@ int main(int argc, char **argv)
   else
     commands[EQN_INDEX].append_arg("-T", device);
 
+  commands[TBL_INDEX].append_arg("-T", device);
   commands[GRN_INDEX].append_arg("-T", device);
 
   int first_index;
@@ -549,8 +571,23 @@ int main(int argc, char **argv)
     print_commands(Vflag == 1 ? stdout : stderr);
   if (Vflag == 1)
     xexit(EXIT_SUCCESS);
+  // Runs that read the standard input stream, print, or interact with
+  // the user aren't worth caching; nor are those that may run other
+  // programs on the document's behalf.
+  const char *cache_dir = getenv("GROFF_RENDER_CACHE");
+  bool want_render_cache = ((cache_dir != 0 /* nullptr */)
+			    && (*cache_dir != '\0')
+			    && !want_version_info && !Vflag && !lflag
+			    && !Xflag && !iflag && !want_unsafe_mode
+			    && (optind < argc));
+  for (int i = optind; want_render_cache && (i < argc); i++)
+    if (strcmp(argv[i], "-") == 0)
+      want_render_cache = false;
   // We need the lower two bits of the exit status for ourselves.
-  int status = run_commands(want_version_info) << 2;
+  int status = (want_render_cache
+		? run_commands_cached(cache_dir, argc - optind,
+				      argv + optind)
+		: run_commands(want_version_info)) << 2;
   assert(status < 65 || 0 == "run_commands() returned too many bits");
   xexit(status);
 }
@@ -641,6 +678,33 @@ int run_commands(bool no_pipe)
   return run_pipeline(ncommands, v, no_pipe);
 }
 
+// Run the commands, or replay their output from the render cache in
+// `dir` if they have been run before on the same input `files`.
+// Return the code with which to exit.
+
+int run_commands_cached(const char *dir, int nfiles, char **files)
+{
+  render_cache cache(dir);
+  for (int i = 0; i < NCOMMANDS; i++) {
+    if (commands[i].get_name() != 0 /* nullptr */) {
+      char **argv = commands[i].get_argv();
+      int argc = 0;
+      while (argv[argc] != 0 /* nullptr */)
+	argc++;
+      cache.add_key(i_to_a(argc));
+      for (int j = 0; j < argc; j++)
+	cache.add_key(argv[j]);
+    }
+  }
+  for (int i = 0; i < nfiles; i++)
+    if (!cache.add_key_file(files[i]))
+      // Let the pipeline report the problem.
+      return run_commands(false);
+  if (cache.replay())
+    return 0;
+  return cache.run(run_commands);
+}
+
 possible_command::possible_command()
 : name(0), argv(0)
 {
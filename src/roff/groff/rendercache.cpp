@@ -0,0 +1,496 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// Keep the output of groff runs in a directory, so that a later run
+// with the same input files, command lines, and environment can write
+// it again without running the pipeline.
+//
+// A run is described by a key:  the groff version, the working
+// directory, the argument vectors of the commands in the pipeline, the
+// environment variables that affect them, and the length and a hash of
+// each input file's contents.  The cache entry for a run is named by a
+// hash of its key, and holds the key itself, so a hash collision is a
+// miss rather than a wrong answer.
+//
+// The entry also holds the files the programs in the pipeline opened
+// through their search paths (macro files, font descriptions, and files
+// sourced by requests such as `so`), with the size and modification
+// time of each, and the candidates they found missing on the way; a
+// search path lookup notes these in a log file that we name in the
+// environment variable GROFF_DEPENDENCY_LOG__.  troff notes there too
+// any environment variable that the document interpolates with `\V`,
+// since those are not among the variables in the key; the entry records
+// each one's value, or that it was unset.  An entry is replayed only if
+// each such file is unchanged, each such candidate is still missing,
+// and each such variable has the same value.
+//
+// Each entry is a file in this format:
+//
+//   groff render cache 1
+//   <length of key>
+//   <key>f <size> <mtime> <path>
+//   m <path>
+//   v <name>=<value>
+//   u <name>
+//   ...
+//   <empty line>
+//   <output>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h> // fflush(), fwrite(), sprintf(), sscanf(), stderr,
+		   // stdout
+#include <stdlib.h> // free(), getenv(), malloc(), qsort(), setenv()
+#include <string.h> // memchr(), memcmp(), memcpy(), strchr(), strcmp(),
+		    // strlen()
+
+#include <sys/types.h>
+#include <sys/stat.h> // fstat(), stat()
+#include <fcntl.h> // open(), O_CREAT, O_EXCL, O_RDONLY, O_WRONLY
+
+#include "posix.h" // close(), dup(), dup2(), getcwd(), getpid(),
+		   // read(), rename(), unlink(), write()
+#include "nonposix.h"
+
+#include "lib.h"
+
+#include "stringclass.h"
+#include "rendercache.h"
+
+extern "C" const char *Version_string;
+
+static const char RENDER_CACHE_MAGIC[] = "groff render cache 1\n";
+
+// Environment variables that affect what the pipeline writes, beyond
+// those groff itself turns into command-line arguments.  PATH selects
+// the programs run; HOME is in the macro search path.
+static const char *key_variables[] = {
+  "GROFF_FONT_PATH",
+  "GROFF_NO_SGR",
+  "GROFF_TMAC_PATH",
+  "HOME",
+  "LANG",
+  "LC_ALL",
+  "LC_CTYPE",
+  "PATH",
+  "SOURCE_DATE_EPOCH",
+  "TZ",
+};
+
+// 64-bit FNV-1a
+
+struct render_hash {
+  unsigned long long h;
+  render_hash() : h(0xcbf29ce484222325ULL) {}
+  void add(const char *, size_t);
+  unsigned long high() { return (unsigned long) (h >> 32); }
+  unsigned long low() { return (unsigned long) (h & 0xffffffffUL); }
+};
+
+void render_hash::add(const char *p, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    h ^= (unsigned char) p[i];
+    h *= 0x100000001b3ULL;
+  }
+}
+
+render_cache::render_cache(const char *d)
+: dir(strsave(d)), entry_name(0 /* nullptr */)
+{
+  add_key(RENDER_CACHE_MAGIC);
+  add_key(Version_string);
+  size_t size = 256;
+  char *cwd;
+  for (;;) {
+    cwd = new char[size];
+    if (getcwd(cwd, size) != 0 /* nullptr */ || errno != ERANGE)
+      break;
+    delete[] cwd;
+    size *= 2;
+  }
+  // If we can't tell, each run gets a key of its own.
+  add_key((*cwd != '\0') ? cwd : i_to_a(int(getpid())));
+  delete[] cwd;
+  for (size_t i = 0; i < sizeof key_variables / sizeof key_variables[0];
+       i++) {
+    const char *value = getenv(key_variables[i]);
+    add_key(key_variables[i]);
+    add_key((value != 0 /* nullptr */) ? value : "");
+  }
+}
+
+render_cache::~render_cache()
+{
+  free(dir);
+  delete[] entry_name;
+}
+
+void render_cache::add_key(const char *s)
+{
+  key += s;
+  key += '\0';
+}
+
+bool render_cache::add_key_file(const char *filename)
+{
+  int fd = open(filename, O_RDONLY | O_BINARY);
+  if (fd < 0)
+    return false;
+  render_hash h;
+  unsigned long total = 0;
+  char buf[8192];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof buf)) > 0) {
+    h.add(buf, size_t(n));
+    total += n;
+  }
+  close(fd);
+  if (n < 0)
+    return false;
+  char digest[2 * INT_DIGITS + 8];
+  sprintf(digest, "%lu %08lx%08lx", total, h.high(), h.low());
+  add_key(filename);
+  add_key(digest);
+  return true;
+}
+
+const char *render_cache::get_entry_name()
+{
+  if (0 /* nullptr */ == entry_name) {
+    render_hash h;
+    h.add(key.contents(), key.length());
+    entry_name = new char[strlen(dir) + 1 + 16 + 1];
+    sprintf(entry_name, "%s/%08lx%08lx", dir, h.high(), h.low());
+  }
+  return entry_name;
+}
+
+// Read all of the file `name` into storage allocated with new[];
+// return a null pointer if it can't be read.
+
+static char *read_file(const char *name, size_t *lenp)
+{
+  int fd = open(name, O_RDONLY | O_BINARY);
+  if (fd < 0)
+    return 0 /* nullptr */;
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return 0 /* nullptr */;
+  }
+  size_t len = size_t(st.st_size);
+  char *buf = new char[len + 1];
+  size_t got = 0;
+  while (got < len) {
+    ssize_t n = read(fd, buf + got, len - got);
+    if (n <= 0)
+      break;
+    got += n;
+  }
+  close(fd);
+  if (got != len) {
+    delete[] buf;
+    return 0 /* nullptr */;
+  }
+  buf[len] = '\0';
+  *lenp = len;
+  return buf;
+}
+
+static bool write_all(int fd, const char *p, size_t len)
+{
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n <= 0)
+      return false;
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+static void copy_to_stream(const char *p, size_t len, FILE *fp)
+{
+  if (len > 0)
+    fwrite(p, 1, len, fp);
+  fflush(fp);
+}
+
+// Return whether the dependency line [p, end) still holds.
+
+static bool is_current(const char *p, const char *end)
+{
+  string path;
+  if (('m' == *p) && (end - p > 2)) {
+    path.append(p + 2, end - p - 2);
+    path += '\0';
+    struct stat st;
+    return (stat(path.contents(), &st) < 0) && (ENOENT == errno);
+  }
+  if (('v' == *p) || ('u' == *p)) {
+    string name;
+    const char *eq = ('v' == *p) ? static_cast<const char *>(
+			memchr(p, '=', end - p)) : end;
+    if ((0 /* nullptr */ == eq) || (eq - p <= 2))
+      return false;
+    name.append(p + 2, eq - p - 2);
+    name += '\0';
+    const char *value = getenv(name.contents());
+    if ('u' == *p)
+      return (0 /* nullptr */ == value);
+    return ((value != 0 /* nullptr */)
+	    && (strlen(value) == size_t(end - eq - 1))
+	    && (memcmp(value, eq + 1, end - eq - 1) == 0));
+  }
+  long long size, mtime;
+  int offset;
+  if (('f' == *p)
+      && (sscanf(p, "f %lld %lld %n", &size, &mtime, &offset) == 2)
+      && (offset < end - p)) {
+    path.append(p + offset, end - p - offset);
+    path += '\0';
+    struct stat st;
+    return ((stat(path.contents(), &st) == 0)
+	    && ((long long) st.st_size == size)
+	    && ((long long) st.st_mtime == mtime));
+  }
+  return false;
+}
+
+bool render_cache::replay()
+{
+  size_t len;
+  char *buf = read_file(get_entry_name(), &len);
+  if (0 /* nullptr */ == buf)
+    return false;
+  const char *p = buf;
+  const char *end = buf + len;
+  size_t magic_len = sizeof RENDER_CACHE_MAGIC - 1;
+  unsigned long key_len;
+  int offset;
+  bool is_valid = ((len > magic_len)
+		   && (memcmp(p, RENDER_CACHE_MAGIC, magic_len) == 0)
+		   && (sscanf(p + magic_len, "%lu\n%n", &key_len,
+			      &offset) == 1));
+  if (is_valid) {
+    p += magic_len + offset;
+    is_valid = ((key_len == (unsigned long) key.length())
+		&& (size_t(end - p) >= key_len)
+		&& (memcmp(p, key.contents(), key_len) == 0));
+    p += key_len;
+  }
+  while (is_valid) {
+    const char *eol = (const char *) memchr(p, '\n', end - p);
+    if (0 /* nullptr */ == eol)
+      is_valid = false;
+    else if (eol == p) {
+      p++;
+      break;
+    }
+    else
+      is_valid = is_current(p, eol);
+    p = eol + 1;
+  }
+  if (is_valid)
+    copy_to_stream(p, end - p, stdout);
+  delete[] buf;
+  return is_valid;
+}
+
+static int compare_lines(const void *p1, const void *p2)
+{
+  return strcmp(*static_cast<char * const *>(p1),
+		*static_cast<char * const *>(p2));
+}
+
+// Turn the dependency log in `log` into lines of a cache entry in
+// `deps`; return false if a file in it can't be examined or a variable
+// in it can't be recorded.
+
+static bool get_dependencies(char *log, size_t log_len, string &deps)
+{
+  int n = 0;
+  for (size_t i = 0; i < log_len; i++)
+    if ('\n' == log[i])
+      n++;
+  char **lines = new char *[n > 0 ? n : 1];
+  int nlines = 0;
+  for (char *p = log; nlines < n; p++) {
+    lines[nlines++] = p;
+    p = strchr(p, '\n');
+    *p = '\0';
+  }
+  // The same file is typically opened by several programs.
+  qsort(lines, nlines, sizeof lines[0], compare_lines);
+  bool is_ok = true;
+  for (int i = 0; is_ok && (i < nlines); i++) {
+    if ((i > 0) && (strcmp(lines[i], lines[i - 1]) == 0))
+      continue;
+    const char *p = lines[i];
+    if (('m' == p[0]) && (' ' == p[1]) && (p[2] != '\0')) {
+      deps += p;
+      deps += '\n';
+    }
+    else if (('f' == p[0]) && (' ' == p[1]) && (p[2] != '\0')) {
+      struct stat st;
+      if (stat(p + 2, &st) < 0)
+	is_ok = false;
+      else {
+	char stamp[2 * INT_DIGITS + 8];
+	sprintf(stamp, "f %lld %lld ", (long long) st.st_size,
+		(long long) st.st_mtime);
+	deps += stamp;
+	deps += p + 2;
+	deps += '\n';
+      }
+    }
+    else if (('v' == p[0]) && (' ' == p[1]) && (p[2] != '\0')
+	     && (0 /* nullptr */ == strchr(p + 2, '='))) {
+      // A value with a newline in it can't be recorded in a line.
+      const char *value = getenv(p + 2);
+      if (0 /* nullptr */ == value) {
+	deps += 'u';
+	deps += p + 1;
+	deps += '\n';
+      }
+      else if (strchr(value, '\n') != 0 /* nullptr */)
+	is_ok = false;
+      else {
+	deps += p;
+	deps += '=';
+	deps += value;
+	deps += '\n';
+      }
+    }
+    else
+      is_ok = false;
+  }
+  delete[] lines;
+  return is_ok;
+}
+
+// Write an entry to a temporary file and rename it into place, so that
+// concurrent readers never see a partial entry.  Failure is silent;
+// the next such run simply runs the pipeline again.
+
+bool render_cache::write_entry(const char *tem, const char *log,
+			       size_t log_len, const char *output,
+			       size_t output_len)
+{
+  string deps;
+  if (!get_dependencies(const_cast<char *>(log), log_len, deps))
+    return false;
+  int fd = open(tem, O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0666);
+  if (fd < 0)
+    return false;
+  const char *key_len = ui_to_a((unsigned int) key.length());
+  bool is_written = (write_all(fd, RENDER_CACHE_MAGIC,
+			       sizeof RENDER_CACHE_MAGIC - 1)
+		     && write_all(fd, key_len, strlen(key_len))
+		     && write_all(fd, "\n", 1)
+		     && write_all(fd, key.contents(), key.length())
+		     && write_all(fd, deps.contents(), deps.length())
+		     && write_all(fd, "\n", 1)
+		     && write_all(fd, output, output_len));
+  if ((close(fd) < 0) || !is_written
+      || (rename(tem, get_entry_name()) < 0)) {
+    unlink(tem);
+    return false;
+  }
+  return true;
+}
+
+int render_cache::run(int (*run)(bool))
+{
+  const char *entry = get_entry_name();
+  char *names = new char[4 * (strlen(entry) + INT_DIGITS + 6)];
+  char *out_name = names;
+  sprintf(out_name, "%s.%d.out", entry, int(getpid()));
+  char *err_name = out_name + strlen(out_name) + 1;
+  sprintf(err_name, "%s.%d.err", entry, int(getpid()));
+  char *log_name = err_name + strlen(err_name) + 1;
+  sprintf(log_name, "%s.%d.log", entry, int(getpid()));
+  char *tem_name = log_name + strlen(log_name) + 1;
+  sprintf(tem_name, "%s.%d.tmp", entry, int(getpid()));
+  int flags = O_WRONLY | O_CREAT | O_EXCL | O_BINARY;
+  int out_fd = open(out_name, flags, 0666);
+  int err_fd = open(err_name, flags, 0666);
+  int log_fd = open(log_name, flags, 0666);
+  int saved_out = -1, saved_err = -1;
+  fflush(stdout);
+  fflush(stderr);
+  bool is_capturing = ((out_fd >= 0) && (err_fd >= 0) && (log_fd >= 0)
+		       && (setenv("GROFF_DEPENDENCY_LOG__", log_name, 1)
+			   == 0)
+		       && ((saved_out = dup(STDOUT_FILENO)) >= 0)
+		       && ((saved_err = dup(STDERR_FILENO)) >= 0)
+		       && (dup2(out_fd, STDOUT_FILENO) >= 0)
+		       && (dup2(err_fd, STDERR_FILENO) >= 0));
+  if (!is_capturing) {
+    if (saved_out >= 0) {
+      dup2(saved_out, STDOUT_FILENO);
+      close(saved_out);
+    }
+    if (saved_err >= 0)
+      close(saved_err);
+  }
+  if (out_fd >= 0)
+    close(out_fd);
+  if (err_fd >= 0)
+    close(err_fd);
+  if (log_fd >= 0)
+    close(log_fd);
+  int status = run(false);
+  if (is_capturing) {
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_out, STDOUT_FILENO);
+    dup2(saved_err, STDERR_FILENO);
+    close(saved_out);
+    close(saved_err);
+    size_t out_len = 0, err_len = 0, log_len = 0;
+    char *output = read_file(out_name, &out_len);
+    char *diagnostics = read_file(err_name, &err_len);
+    char *log = read_file(log_name, &log_len);
+    if (diagnostics != 0 /* nullptr */)
+      copy_to_stream(diagnostics, err_len, stderr);
+    if (output != 0 /* nullptr */)
+      copy_to_stream(output, out_len, stdout);
+    if ((0 == status) && (output != 0 /* nullptr */)
+	&& (diagnostics != 0 /* nullptr */) && (0 == err_len)
+	&& (log != 0 /* nullptr */))
+      (void) write_entry(tem_name, log, log_len, output, out_len);
+    delete[] output;
+    delete[] diagnostics;
+    delete[] log;
+  }
+  unlink(out_name);
+  unlink(err_name);
+  unlink(log_name);
+  delete[] names;
+  return status;
+}
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
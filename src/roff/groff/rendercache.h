@@ -0,0 +1,52 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// A cache of rendered documents; see GROFF_RENDER_CACHE in groff(1).
+//
+// groff doesn't yet use include guards, so until it does, any source
+// file needing symbols from this one must #include "stringclass.h"
+// first.
+
+class render_cache {
+  char *dir;
+  string key;
+  char *entry_name;
+  const char *get_entry_name();
+  bool write_entry(const char *, const char *, size_t, const char *,
+		   size_t);
+public:
+  render_cache(const char * /* directory */);
+  ~render_cache();
+  // Add a string to the description of the run.
+  void add_key(const char *);
+  // Add the contents of an input file; return false if it can't be
+  // read.
+  bool add_key_file(const char *);
+  // If a valid rendering of the run described so far is cached, write
+  // it to the standard output stream and return true.
+  bool replay();
+  // Call `run`, capturing the standard output and error streams of the
+  // programs it runs; pass them on, and cache the output if the run
+  // succeeded without diagnostics.  Return what `run` returned.
+  int run(int (*run)(bool));
+};
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
@@ -0,0 +1,81 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+report="allocation-report-works.$$.json"
+
+cleanup () {
+  rm -f "$report"
+}
+
+# A process handling a fatal signal should:
+#   1.  Mask all fatal signals of interest.  (GBR often excludes ABRT.)
+#   2.  Perform cleanup operations.
+#   3.  Unmask the signal (removing the handler).
+#   4.  Signal its own process group with the signal caught so that the
+#       the children exit and shell accurately reports how the process
+#       died.
+fatals="HUP INT QUIT TERM"
+for s in $fatals
+do
+  trap "trap '' $fatals; cleanup; trap - $fatals; kill -$s -$$" $s
+done
+
+# A text block makes tbl release storage obtained from malloc(3).
+
+input='.
+.TS
+l l.
+T{
+A text block.
+T}	entry
+.TE
+'
+
+output=$(printf "%s\n" "$input" \
+  | GROFF_ALLOCATION_REPORT="$report" "$groff" -t -T ascii)
+status=$?
+echo "$output"
+cat "$report"
+
+echo "checking that accounted pipeline succeeds" >&2
+test $status -eq 0 || wail
+echo "$output" | grep -q 'A text block\. *entry' || wail
+
+echo "checking report from tbl" >&2
+grep -q '^{"program": "tbl", "process": [0-9]*, "total": ' "$report" \
+  || wail
+
+echo "checking report from troff" >&2
+grep -q '^{"program": "troff", "process": [0-9]*, "total": ' "$report" \
+  || wail
+
+cleanup
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
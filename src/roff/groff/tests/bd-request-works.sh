@@ -63,6 +63,29 @@ echo "$output" | grep -Eq 'C *pl +h *19 +C *pl +x font [0-9]+ +TB +f *[0-9]+ +h
 echo "checking that unconditional un-emboldening works" >&2
 echo "$output" | grep -Eq 'C *pl +f *[0-9]+ +h *[0-9]+ +[ct] *Z' || wail
 
+# Conditional emboldening must apply to a font already used.
+
+input='.
+.nf
+.ft TB
+\(plV
+.bd S TB 20
+\(plW
+.'
+
+output=$(printf '%s\n' "$input" | "$groff" -Z)
+echo "$output"
+
+output=$(echo "$output" | tr '\n' ' ')
+
+# Expected (with line breaks added for comment readability):
+# x T ps x res 72000 1 1 x init p1 x font 11 S f11 s10000 md DFd V12000
+# H72000 Cpl x font 38 TB f38 h5490 tV n12000 0 f11 V24000 H72000 Cpl
+# h19 Cpl f38 h5490 tW n12000 0 x trailer V792000 x stop
+
+echo "checking that conditional emboldening works after font use" >&2
+echo "$output" | grep -Eq 'C *pl +h *19 +C *pl +f *[0-9]+ +h *[0-9]+ +[ct] *W' || wail
+
 # Deal with the ambiguous case.
 
 input='.
@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+# The formatter remembers where it found a glyph missing from the
+# current font; defining or removing characters must void that.
+
+input='.nf
+1\[foo]
+.fschar R \[foo] A
+2\[foo]
+.rfschar R \[foo]
+3\[foo]
+.schar \[foo] B
+4\[foo]
+.rchar \[foo]
+5\[foo]'
+
+output=$(printf '%s\n' "$input" | "$groff" -T ascii -W char)
+echo "$output"
+
+echo "checking glyph missing before any definition" >&2
+echo "$output" | grep -qx '1' || wail
+
+echo "checking font-specific fallback character" >&2
+echo "$output" | grep -qx '2A' || wail
+
+echo "checking glyph missing after removal of font-specific character" >&2
+echo "$output" | grep -qx '3' || wail
+
+echo "checking special fallback character" >&2
+echo "$output" | grep -qx '4B' || wail
+
+echo "checking glyph missing after removal of special character" >&2
+echo "$output" | grep -qx '5' || wail
+
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
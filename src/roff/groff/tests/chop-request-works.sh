@@ -0,0 +1,126 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo ...FAILED >&2
+  fail=yes
+}
+
+# Chop strings and diversions, then append to them again.  Use strings
+# longer than troff's internal storage block size (128 bytes).
+
+input='.
+.ds s 0123456789\"
+.nr i 5
+.while \n[i] \{\
+.  as s "\*s
+.  nr i -1
+.\}
+.length n \*s
+.tm length=\nn
+.nr i 100
+.while \n[i] \{\
+.  chop s
+.  nr i -1
+.\}
+.as s X
+.substring s -12
+.tm tail=\*s
+.ds t abc
+.de m
+.  chop t
+.  as t Z
+..
+.ds t \*t\*m
+.tm t=\*t
+.ds u x\h'"'"'1m'"'"'y
+.chop u
+.as u Q
+.tm u=\*u
+.di d
+One.
+.br
+.di
+.chop d
+.chop d
+.da d
+Two.
+.br
+.da
+.nf
+.d
+'
+
+output=$(printf "%s\n" "$input" | "$groff" -T ascii 2>&1)
+echo "$output"
+
+echo "checking length of string built by repeated appends" >&2
+echo "$output" | grep -Fqx 'length=320' || wail
+
+echo "checking chopped and re-extended string" >&2
+echo "$output" | grep -Fqx 'tail=90123456789X' || wail
+
+echo "checking string chopped during its own interpolation" >&2
+echo "$output" | grep -Fqx 't=abc.chop tZ' || wail
+
+echo "checking string with a node chopped and re-extended" >&2
+echo "$output" | grep -Fqx "u=x\\h'1m'Q" || wail
+
+echo "checking chopped and re-extended diversion" >&2
+echo "$output" | grep -Fqx 'One.Two.' || wail
+
+# Chop a character stored as a node from a string defined in
+# compatibility mode, so that a mode-restoring token follows it, then
+# append more nodes.  The nodes must stay matched to their positions.
+# Use Cyrillic letters, which troff stores as nodes with -K utf-8.
+
+ghe=$(printf '\320\223')
+de=$(printf '\320\224')
+ie=$(printf '\320\225')
+
+input=".
+.ds D $de
+.ds1 s x\\*[D]
+.chop s
+.as s \\*[D]
+.ds1 t x$ghe
+.chop t
+.as t $de$ie
+A\\*sB
+.br
+C\\*tD
+"
+
+output=$(printf "%s\n" "$input" | "$groff" -K utf-8 -T utf8 2>&1)
+echo "$output"
+
+echo "checking chopped node in compatibility-mode string" >&2
+echo "$output" | grep -Fqx "Ax${de}B" || wail
+
+echo "checking nodes appended after chopped node" >&2
+echo "$output" | grep -Fqx "Cx$de${ie}D" || wail
+
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
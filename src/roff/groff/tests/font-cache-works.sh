@@ -0,0 +1,87 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+cachedir="font-cache-works.$$"
+
+cleanup () {
+  rm -rf "$cachedir"
+}
+
+# A process handling a fatal signal should:
+#   1.  Mask all fatal signals of interest.  (GBR often excludes ABRT.)
+#   2.  Perform cleanup operations.
+#   3.  Unmask the signal (removing the handler).
+#   4.  Signal its own process group with the signal caught so that the
+#       the children exit and shell accurately reports how the process
+#       died.
+fatals="HUP INT QUIT TERM"
+for s in $fatals
+do
+  trap "trap '' $fatals; cleanup; trap - $fatals; kill -$s -$$" $s
+done
+
+mkdir "$cachedir" || exit 77
+
+# Exercise kerning, ligatures, special characters, and a font with a
+# special device coding.
+input='.
+AV To office \[co] \(em \[u2013]
+.ft BI
+affluent WAVE \[*a]\[*b]
+.ft S
+\[*a]\[*b]\[lh]
+.'
+
+expected=$(printf "%s\n" "$input" | "$groff" -Z -Tps)
+
+echo "checking that output is unchanged when cache is written" >&2
+output=$(printf "%s\n" "$input" \
+  | GROFF_FONT_CACHE="$cachedir" "$groff" -Z -Tps)
+test "$output" = "$expected" || wail
+
+echo "checking that cache files were written" >&2
+test -n "$(ls "$cachedir")" || wail
+
+echo "checking that output is unchanged when cache is read" >&2
+output=$(printf "%s\n" "$input" \
+  | GROFF_FONT_CACHE="$cachedir" "$groff" -Z -Tps)
+test "$output" = "$expected" || wail
+
+echo "checking that a corrupt cache file is ignored" >&2
+for f in "$cachedir"/*
+do
+  echo garbage > "$f"
+done
+output=$(printf "%s\n" "$input" \
+  | GROFF_FONT_CACHE="$cachedir" "$groff" -Z -Tps)
+test "$output" = "$expected" || wail
+
+cleanup
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
@@ -0,0 +1,83 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo ...FAILED >&2
+  fail=yes
+}
+
+# Words hyphenated again are found in the hyphenation language's cache,
+# which must be forgotten when the language's exceptions change.
+
+input='.ec @
+.ll 9n
+hyphenation
+.br
+hyphenation
+.br
+.tm first=@n[.hyhits] @n[.hymisses]
+.hw hy-phenation
+hyphenation
+.br
+.tm second=@n[.hyhits] @n[.hymisses]
+.rhw
+hyphenation
+.br
+.tm third=@n[.hyhits] @n[.hymisses]
+.hla
+.tm fourth=@n[.hyhits] @n[.hymisses]'
+
+error=$(printf "%s\n" "$input" | "$groff" -W break -T ascii 2>&1 \
+  > /dev/null)
+echo "$error"
+
+output=$(printf "%s\n" "$input" | "$groff" -W break -T ascii \
+  2> /dev/null | sed '/^$/d')
+echo "$output"
+
+echo "checking that a repeated word is found in the cache" >&2
+echo "$error" | grep -Fqx 'first=1 1' || wail
+
+echo "checking that 'hw' request invalidates the cache" >&2
+echo "$error" | grep -Fqx 'second=1 2' || wail
+
+echo "checking that 'rhw' request invalidates the cache" >&2
+echo "$error" | grep -Fqx 'third=1 3' || wail
+
+echo "checking that cache registers are zero with no language" >&2
+echo "$error" | grep -Fqx 'fourth=0 0' || wail
+
+echo "checking hyphenation using patterns" >&2
+test "$(echo "$output" | sed -n '1p;3p')" \
+  = "$(printf 'hyphen-\nhyphen-')" || wail
+
+echo "checking hyphenation using exception word" >&2
+echo "$output" | sed -n '5p' | grep -Fqx 'hy-' || wail
+
+echo "checking hyphenation after removal of exception word" >&2
+echo "$output" | sed -n '7p' | grep -Fqx 'hyphen-' || wail
+
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
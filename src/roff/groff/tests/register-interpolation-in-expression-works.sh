@@ -0,0 +1,113 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo ...FAILED >&2
+  fail=YES
+}
+
+# An interpolated register must behave in a numeric expression exactly
+# as the digits it formats would.
+
+input='.
+.nr a 5
+.nr n -7
+.nr k 1 1
+.nr b 1+\n[a]0
+.tm b=\n[b]
+.nr c 1+\n[a]p
+.tm c=\n[c]
+.nr d 3-\n[n]
+.tm d=\n[d]
+.nr e 3*-\n[n]
+.tm e=\n[e]
+.nr f 2*(\n[n]+1)
+.tm f=\n[f]
+.nr g 10+\n+[k]
+.tm g=\n[g] k=\n[k]
+.nr h 1+\n[a].5i
+.tm h=\n[h]
+.nr i 1+\n[a]\n[a]
+.tm i=\n[i]
+.af a 001
+.nr j 1+\n[a]0
+.tm j=\n[j]
+.'
+
+output=$(printf "%s\n" "$input" | "$groff" -z -T ps 2>&1)
+echo "$output"
+
+echo "checking concatenation of digits to interpolated register" >&2
+echo "$output" | grep -Fqx 'b=51' || wail
+
+echo "checking scaling unit after interpolated register" >&2
+echo "$output" | grep -Fqx 'c=5001' || wail
+
+echo "checking subtraction of negative register value" >&2
+echo "$output" | grep -Fqx 'd=10' || wail
+
+echo "checking negation of negative register value" >&2
+echo "$output" | grep -Fqx 'e=21' || wail
+
+echo "checking negative register value in parentheses" >&2
+echo "$output" | grep -Fqx 'f=-12' || wail
+
+echo "checking auto-incremented register in expression" >&2
+echo "$output" | grep -Fqx 'g=12 k=2' || wail
+
+echo "checking decimal fraction after interpolated register" >&2
+echo "$output" | grep -Fqx 'h=396001' || wail
+
+echo "checking adjacent interpolated registers" >&2
+echo "$output" | grep -Fqx 'i=56' || wail
+
+echo "checking register with non-default format" >&2
+echo "$output" | grep -Fqx 'j=51' || wail
+
+# Locate directory containing our test artifacts.
+artifact_dir=
+base=src/roff/groff/tests
+dir=artifacts
+
+for buildroot in . .. ../..
+do
+    d=$buildroot/$base/$dir
+    if [ -d "$d" ]
+    then
+        artifact_dir=$d
+        break
+    fi
+done
+
+# If we can't find it, we can't test.
+test -z "$artifact_dir" && exit 77 # skip
+
+output=$("$groff" -z -T ps "$artifact_dir"/register-arithmetic 2>&1)
+echo "$output"
+
+echo "checking register arithmetic benchmark checksum" >&2
+echo "$output" | grep -Fqx 'sum=175263 x=500 y=79' || wail
+
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
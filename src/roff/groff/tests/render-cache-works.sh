@@ -0,0 +1,118 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+dir="render-cache-works.$$.d"
+
+cleanup () {
+  rm -rf "$dir"
+}
+
+# A process handling a fatal signal should:
+#   1.  Mask all fatal signals of interest.  (GBR often excludes ABRT.)
+#   2.  Perform cleanup operations.
+#   3.  Unmask the signal (removing the handler).
+#   4.  Signal its own process group with the signal caught so that the
+#       the children exit and shell accurately reports how the process
+#       died.
+fatals="HUP INT QUIT TERM"
+for s in $fatals
+do
+  trap "trap '' $fatals; cleanup; trap - $fatals; kill -$s -$$" $s
+done
+
+mkdir "$dir" "$dir"/cache "$dir"/d1 "$dir"/d2 || exit 99
+
+GROFF_RENDER_CACHE=$dir/cache
+export GROFF_RENDER_CACHE
+
+printf '.ds x two\n' > "$dir"/d2/pkg.tmac
+printf 'hello \\*x\n' > "$dir"/doc.roff
+
+render () {
+  "$groff" -T ascii -M "$dir"/d1 -M "$dir"/d2 -m pkg "$@" \
+    | sed '/^$/d'
+}
+
+echo "checking that a run is cached" >&2
+output=$(render "$dir"/doc.roff)
+echo "$output"
+echo "$output" | grep -qx 'hello two' || wail
+test $(ls "$dir"/cache | wc -l) -eq 1 || wail
+
+echo "checking that a cached run is replayed" >&2
+output=$(render "$dir"/doc.roff)
+echo "$output"
+echo "$output" | grep -qx 'hello two' || wail
+
+echo "checking that a changed input file is noticed" >&2
+printf 'goodbye \\*x\n' > "$dir"/doc.roff
+output=$(render "$dir"/doc.roff)
+echo "$output"
+echo "$output" | grep -qx 'goodbye two' || wail
+
+echo "checking that a newly shadowing macro file is noticed" >&2
+printf '.ds x one\n' > "$dir"/d1/pkg.tmac
+output=$(render "$dir"/doc.roff)
+echo "$output"
+echo "$output" | grep -qx 'goodbye one' || wail
+
+echo "checking that a changed macro file is noticed" >&2
+printf '.ds x uno\n.ds y unused\n' > "$dir"/d1/pkg.tmac
+output=$(render "$dir"/doc.roff)
+echo "$output"
+echo "$output" | grep -qx 'goodbye uno' || wail
+
+echo "checking that a changed interpolated environment variable" \
+  "is noticed" >&2
+printf 'word \\V[RENDER_CACHE_WORD]\n' > "$dir"/env.roff
+output=$(RENDER_CACHE_WORD=alpha render "$dir"/env.roff)
+echo "$output"
+echo "$output" | grep -qx 'word alpha' || wail
+output=$(RENDER_CACHE_WORD=beta render "$dir"/env.roff)
+echo "$output"
+echo "$output" | grep -qx 'word beta' || wail
+output=$(render "$dir"/env.roff)
+echo "$output"
+echo "$output" | grep -qx 'word' || wail
+output=$(RENDER_CACHE_WORD=alpha render "$dir"/env.roff)
+echo "$output"
+echo "$output" | grep -qx 'word alpha' || wail
+
+echo "checking that a run with diagnostics is not cached" >&2
+printf '.tm diagnostic\n' > "$dir"/diag.roff
+count=$(ls "$dir"/cache | wc -l)
+output=$(render "$dir"/diag.roff 2>&1)
+echo "$output"
+echo "$output" | grep -qx 'diagnostic' || wail
+test $(ls "$dir"/cache | wc -l) -eq $count || wail
+
+cleanup
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
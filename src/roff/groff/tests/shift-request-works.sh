@@ -0,0 +1,74 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo ...FAILED >&2
+  fail=yes
+}
+
+# A macro interpolated as a string sees its caller's arguments; shifting
+# them there must not affect the caller, nor vice versa.
+
+input='.
+.de inner
+.  shift
+.  tm inner: \\n[.$] [\\$1] [\\$*]
+..
+.de outer
+.  tm outer1: \\n[.$] [\\$1] [\\$@]
+\\*[inner]\\
+.  shift 2
+.  tm outer2: \\n[.$] [\\$1] [\\$^]
+\\*[inner]\\
+.  shift 5
+.  tm outer3: \\n[.$] [\\$1]
+.  inner x "y z" w
+..
+.outer a "b c" d e
+'
+
+output=$(printf "%s\n" "$input" | "$groff" -z 2>&1)
+echo "$output"
+
+echo "checking arguments before shifting" >&2
+echo "$output" | grep -Fqx 'outer1: 4 [a] ["a" "b c" "d" "e"]' || wail
+
+echo "checking shift in macro interpolated as string" >&2
+echo "$output" | grep -Fqx 'inner: 3 [b c] [b c d e]' || wail
+
+echo "checking that caller's arguments are unaffected" >&2
+echo "$output" | grep -Fqx 'outer2: 2 [d] [d e]' || wail
+
+echo "checking shift of caller's shifted arguments" >&2
+echo "$output" | grep -Fqx 'inner: 1 [e] [e]' || wail
+
+echo "checking shift past the last argument" >&2
+echo "$output" | grep -Fqx 'outer3: 0 []' || wail
+
+echo "checking arguments of a macro called after shifting" >&2
+echo "$output" | grep -Fqx 'inner: 2 [y z] [y z w]' || wail
+
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
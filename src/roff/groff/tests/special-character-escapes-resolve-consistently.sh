@@ -0,0 +1,83 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+# Keep preconv from being run.
+#
+# The "unset" in Solaris /usr/xpg4/bin/sh can actually fail.
+if ! unset GROFF_ENCODING
+then
+  echo "unable to clear environment; skipping" >&2
+  exit 77 # skip
+fi
+
+input='.nf
+\[u00E9]
+\[u0065_0301]
+\[u00e9]
+\[u0000E9]
+\[uD800]
+\(em
+.char \[u00E9] X
+.char \(em Y
+\[u00E9]
+\['\''e]
+\(em
+\[em]'
+
+output=$(printf '%s\n' "$input" | "$groff" -T utf8 -Z -w char 2>&1)
+echo "$output"
+
+echo "checking that \\[u00E9] resolves to the glyph name 'e" >&2
+echo "$output" | grep -m 1 '^C' | grep -qx "C'e" || wail
+
+echo "checking that \\[u0065_0301] resolves to the glyph name 'e" >&2
+test "$(echo "$output" | grep -c "^C'e\$")" -eq 2 || wail
+
+echo "checking that \\[u00e9] is not a Unicode special character" >&2
+echo "$output" | grep -q "special character 'u00e9' not defined" \
+  || wail
+
+echo "checking that \\[u0000E9] is not a Unicode special character" >&2
+echo "$output" | grep -q "special character 'u0000E9' not defined" \
+  || wail
+
+echo "checking that \\[uD800] is not a Unicode special character" >&2
+echo "$output" | grep -q "special character 'uD800' not defined" \
+  || wail
+
+echo "checking that redefinition of 'e affects \\[u00E9] and \\['e]" \
+  >&2
+test "$(echo "$output" | grep -c '^tX$')" -eq 2 || wail
+
+echo "checking that redefinition of em affects \\(em and \\[em]" >&2
+test "$(echo "$output" | grep -c '^tY$')" -eq 2 || wail
+
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 textwidth=72:
@@ -0,0 +1,111 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+troff="${abs_top_builddir:-.}/troff"
+builddir="${abs_top_builddir:-.}"
+srcdir="${abs_top_srcdir:-..}"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+dir="troff-batch-mode-works.$$.d"
+
+cleanup () {
+  rm -rf "$dir"
+}
+
+# A process handling a fatal signal should:
+#   1.  Mask all fatal signals of interest.  (GBR often excludes ABRT.)
+#   2.  Perform cleanup operations.
+#   3.  Unmask the signal (removing the handler).
+#   4.  Signal its own process group with the signal caught so that the
+#       the children exit and shell accurately reports how the process
+#       died.
+fatals="HUP INT QUIT TERM"
+for s in $fatals
+do
+  trap "trap '' $fatals; cleanup; trap - $fatals; kill -$s -$$" $s
+done
+
+mkdir "$dir" || exit 99
+
+# Each document must see the macro package's state as it was after
+# initialization, not as an earlier document left it.
+cat > "$dir"/pkg.tmac <<'END'
+.nr count 0
+.de bump
+.  nr count +1
+.  tm \\$1: \\n[count]
+..
+END
+
+printf '.bump first\n.bump first\nfirst\n' > "$dir"/first.roff
+printf '.bump second\nsecond\n' > "$dir"/second.roff
+printf '.bump third\nthird\n' > "$dir"/third.roff
+
+cat > "$dir"/manifest <<END
+# A comment.
+$dir/first.roff $dir/first.out
+
+$dir/second.roff	$dir/second.out
+$dir/third.roff $dir/third.out
+END
+
+output=$("$troff" -F "$builddir/font" -F "$srcdir/font" -M "$dir" \
+  -m pkg -T ascii -j 2 -x "$dir"/manifest 2>&1)
+status=$?
+echo "$output"
+
+echo "checking exit status of successful batch" >&2
+test $status -eq 0 || wail
+
+echo "checking that each document starts from initialized state" >&2
+echo "$output" | grep -Fqx 'first: 2' || wail
+echo "$output" | grep -Fqx 'second: 1' || wail
+echo "$output" | grep -Fqx 'third: 1' || wail
+
+echo "checking that each document's output is written to its own file" \
+  >&2
+for doc in first second third
+do
+  grep -q "^t$doc\$" "$dir"/$doc.out || wail
+  grep -q '^x stop$' "$dir"/$doc.out || wail
+done
+grep -q '^tsecond$' "$dir"/first.out && wail
+
+echo "checking batch output matches that of individual formatting" >&2
+"$troff" -F "$builddir/font" -F "$srcdir/font" -M "$dir" -m pkg \
+  -T ascii "$dir"/third.roff > "$dir"/third.ref 2>/dev/null
+cmp "$dir"/third.ref "$dir"/third.out || wail
+
+echo "checking exit status of batch with a failing document" >&2
+echo "$dir/missing.roff $dir/missing.out" >> "$dir"/manifest
+"$troff" -F "$builddir/font" -F "$srcdir/font" -M "$dir" -m pkg \
+  -T ascii -x "$dir"/manifest 2>/dev/null
+test $? -eq 1 || wail
+
+cleanup
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
@@ -0,0 +1,144 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+troff="${abs_top_builddir:-.}/troff"
+builddir="${abs_top_builddir:-.}"
+srcdir="${abs_top_srcdir:-..}"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+dir="troff-checkpoint-session-works.$$.d"
+
+cleanup () {
+  rm -rf "$dir"
+}
+
+# A process handling a fatal signal should:
+#   1.  Mask all fatal signals of interest.  (GBR often excludes ABRT.)
+#   2.  Perform cleanup operations.
+#   3.  Unmask the signal (removing the handler).
+#   4.  Signal its own process group with the signal caught so that the
+#       the children exit and shell accurately reports how the process
+#       died.
+fatals="HUP INT QUIT TERM"
+for s in $fatals
+do
+  trap "trap '' $fatals; cleanup; trap - $fatals; kill -$s -$$" $s
+done
+
+mkdir "$dir" || exit 99
+mkfifo "$dir"/manifest "$dir"/ready || exit 77
+
+# Write a document of many short pages, each announcing itself as it
+# begins, whose last words are "$1" and which sources "$dir"/part.roff
+# near its start.
+make_document () {
+  {
+    printf '.pl 12v\n.de hd\n.tm page \\\\n%%\n.sp\n..\n.wh 0 hd\n'
+    printf '.de fo\n.bp\n..\n.wh -2v fo\n.so %s/part.roff\n' "$dir"
+    i=0
+    while [ $i -lt 100 ]
+    do
+      echo "Line $i of the document."
+      i=$((i + 1))
+    done
+    echo "$1"
+  } > "$dir"/doc.roff
+}
+
+make_document "The end."
+echo "A sourced line." > "$dir"/part.roff
+
+format () {
+  "$troff" -F "$builddir/font" -F "$srcdir/font" -T ascii "$dir"/doc.roff \
+    > "$dir"/expected 2>/dev/null
+}
+
+"$troff" -F "$builddir/font" -F "$srcdir/font" -T ascii \
+  -X "$dir"/manifest > "$dir"/ready 2> "$dir"/log &
+exec 4< "$dir"/ready
+exec 3> "$dir"/manifest
+
+# Ask the session to format the document into "$1"; wait until it has.
+session () {
+  echo "$dir/doc.roff $dir/$1" >&3
+  read ready <&4
+  test "$ready" = "$dir/$1"
+}
+
+echo "checking first formatting of document" >&2
+session out1 || wail
+format
+cmp "$dir"/expected "$dir"/out1 || wail
+grep -qx 'page 1' "$dir"/log || wail
+nlines=$(wc -l < "$dir"/log)
+
+echo "checking formatting after an edit at the end" >&2
+make_document "Revised."
+session out2 || wail
+format
+cmp "$dir"/expected "$dir"/out2 || wail
+grep -q Revised "$dir"/out2 || wail
+
+echo "checking that formatting resumed after the first page" >&2
+sed "1,${nlines}d" "$dir"/log | grep -qx 'page 1' && wail
+
+echo "checking formatting after an edit to a sourced file" >&2
+echo "Amended." > "$dir"/part.roff
+session out3 || wail
+format
+cmp "$dir"/expected "$dir"/out3 || wail
+grep -q Amended "$dir"/out3 || wail
+
+echo "checking formatting after an edit to a file read by psbb" >&2
+printf '%%!PS-Adobe-3.0 EPSF-3.0\n%%%%BoundingBox: 0 0 %s 10\n' 25 \
+  > "$dir"/box.eps
+printf '.psbb %s/box.eps\nBox width \\n[urx].\n' "$dir" \
+  > "$dir"/part.roff
+session out4 || wail
+printf '%%!PS-Adobe-3.0 EPSF-3.0\n%%%%BoundingBox: 0 0 %s 10\n' 75 \
+  > "$dir"/box.eps
+session out5 || wail
+format
+cmp "$dir"/expected "$dir"/out5 || wail
+grep -qx 't75\.' "$dir"/out5 || wail
+
+exec 3>&-
+wait $!
+status=$?
+
+echo "checking exit status of session" >&2
+test $status -eq 0 || wail
+
+exec 4<&-
+
+echo "checking that batch mode and a checkpoint session conflict" >&2
+"$troff" -x "$dir"/manifest -X "$dir"/manifest < /dev/null > /dev/null
+test $? -eq 2 || wail
+
+cleanup
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 textwidth=72:
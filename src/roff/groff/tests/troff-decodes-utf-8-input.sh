@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+   echo "...FAILED"
+   fail=yes
+}
+
+# Keep preconv from being run.
+#
+# The "unset" in Solaris /usr/xpg4/bin/sh can actually fail.
+if ! unset GROFF_ENCODING
+then
+    echo "unable to clear environment; skipping" >&2
+    exit 77 # skip
+fi
+
+# Native UTF-8 input must format the same as the escape sequences
+# preconv(1) would have produced.
+escaped=$(printf 'Caf\\[u00E9] \\[u0413] \\[u2014]\n' \
+    | "$groff" -Z -T utf8)
+native=$(printf 'Caf\303\251 \320\223 \342\200\224\n' \
+    | "$groff" -K utf-8 -Z -T utf8)
+echo "$native"
+
+echo "checking that UTF-8 input matches \\[uXXXX] escape sequences" >&2
+test "$native" = "$escaped" || wail
+
+echo "checking that 2-byte sequence maps to composite glyph name" >&2
+echo "$native" | grep -qx "C'e" || wail
+
+echo "checking that 3-byte sequence maps to groff glyph name" >&2
+echo "$native" | grep -qx 'Cem' || wail
+
+echo "checking that a leading byte order mark is discarded" >&2
+output=$(printf '\357\273\277Caf\303\251\n' \
+    | "$groff" -K utf-8 -Z -T utf8)
+test "$output" = "$(printf 'Caf\303\251\n' \
+    | "$groff" -K utf-8 -Z -T utf8)" || wail
+
+echo "checking that no-break space is interpreted as \\~" >&2
+output=$(printf '.if "\302\240"\\~" .tm ok\n' \
+    | "$groff" -K utf-8 -Z -T utf8 2>&1 >/dev/null)
+test "$output" = ok || wail
+
+echo "checking that terminal messages get escape sequences" >&2
+output=$(printf '.tm Caf\303\251\n' \
+    | "$groff" -K utf-8 -Z -T utf8 2>&1 >/dev/null)
+test "$output" = 'Caf\[u00E9]' || wail
+
+echo "checking that terminal messages keep characters from strings" >&2
+output=$(printf '.ds s \320\223x\n.tm s=\\*s\n' \
+    | "$groff" -K utf-8 -Z -T utf8 2>&1 >/dev/null)
+test "$output" = 's=\[u0413]x' || wail
+
+echo "checking that written streams keep characters from strings" >&2
+input='.ds s \320\223x\n.open f /dev/stderr\n.write f s=\\*s\n.close f\n'
+output=$(printf "$input" | "$groff" -U -K utf-8 -Z -T utf8 2>&1 >/dev/null)
+test "$output" = 's=\[u0413]x' || wail
+
+echo "checking that -K utf-8 overrides GROFF_ENCODING" >&2
+output=$(GROFF_ENCODING=latin1 "$groff" -K utf-8 -V -T utf8)
+echo "$output"
+echo "$output" | grep -q preconv && wail
+
+echo "checking that an invalid sequence is replaced with U+FFFD" >&2
+output=$(printf 'a\377b\n' | "$groff" -K utf-8 -w input -Z -T utf8 \
+    2>/dev/null)
+echo "$output" | grep -qx 'CuFFFD' || wail
+
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=4 tabstop=4 textwidth=72:
@@ -0,0 +1,91 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+groff="${abs_top_builddir:-.}/test-groff"
+
+fail=
+
+wail () {
+  echo "...FAILED" >&2
+  fail=yes
+}
+
+profile="troff-profile-works.$$.json"
+
+cleanup () {
+  rm -f "$profile"
+}
+
+# A process handling a fatal signal should:
+#   1.  Mask all fatal signals of interest.  (GBR often excludes ABRT.)
+#   2.  Perform cleanup operations.
+#   3.  Unmask the signal (removing the handler).
+#   4.  Signal its own process group with the signal caught so that the
+#       the children exit and shell accurately reports how the process
+#       died.
+fatals="HUP INT QUIT TERM"
+for s in $fatals
+do
+  trap "trap '' $fatals; cleanup; trap - $fatals; kill -$s -$$" $s
+done
+
+input='.
+.de inner
+.  nr x +1
+..
+.de outer
+.  inner
+.  inner
+.  return
+.  inner
+..
+.outer
+.outer
+.em outer
+'
+
+printf "%s\n" "$input" | GROFF_TROFF_PROFILE="$profile" "$groff" -z
+cat "$profile"
+
+# Drop the timings, which vary.
+report=$(sed -e 's/"[a-z ]*time": [0-9.]*, //g' "$profile")
+
+# The end-of-input macro makes a third call of `outer`.
+echo "checking macro call counts" >&2
+echo "$report" | grep -q '{"name": "outer", "type": "macro", "calls": 3,' \
+  || wail
+echo "$report" | grep -q '{"name": "inner", "type": "macro", "calls": 6,' \
+  || wail
+
+echo "checking call graph edges" >&2
+echo "$report" \
+  | grep -q '{"name": "inner", "type": "macro", "calls": 6, "bytes"' \
+  || wail
+echo "$report" \
+  | grep -q '{"name": "return", "type": "request", "calls": 3, "bytes"' \
+  || wail
+echo "$report" \
+  | grep -q '{"name": "nr", "type": "request", "calls": 6, "bytes"' \
+  || wail
+
+cleanup
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=2 tabstop=2 textwidth=72:
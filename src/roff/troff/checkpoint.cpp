@@ -0,0 +1,663 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// Reformat a document after an edit without rereading what precedes
+// it.
+//
+// A checkpoint is a copy of the formatter, forked at a page boundary
+// and left waiting.  The formatter's state at that point depends only
+// on what it has read so far; so if a later revision of the document
+// begins with the same bytes, the copy can go on to format it, instead
+// of a fresh formatter having to work its way there from the start.
+// Forking captures all of the state: environments, registers, strings,
+// macros, diversions, traps, and the input stack alike.
+//
+// While it formats a document, the formatter records, for each file
+// its input stack reads, how far it got and a hash of what it read.
+// A checkpoint is usable if each file still begins with what it had
+// read by then; to resume, it reopens those it was still reading at the
+// same positions.  A checkpoint also keeps the output written so far,
+// in the spool file its formatter was writing; the resuming process
+// copies it to a spool file of its own.
+//
+// The session process holds the initialized formatter and forks a root
+// checkpoint from it, from which each document's first formatting
+// starts.  It sends commands to a checkpoint by writing them to a pipe
+// that all checkpoints share and signaling that checkpoint, the only
+// one then awake, to read them; replies and reports come back through
+// another pipe.  A checkpoint answers
+//
+//   ? <input>		y or n: is it usable to format <input>?
+//   ! <input> <output>	n if it isn't, or r if it is; then forks a
+//			process to format <input> into <output>, and
+//			writes d 0 (or d 1 if that failed) when it's done.
+//
+// and a formatting process reports each checkpoint it takes as
+// c <process ID>.
+//
+// Each checkpoint of a document after the first was taken in a process
+// resumed from the one before it, so it has read all that its
+// predecessor read and more.  If a checkpoint is unusable, so are all
+// that follow it, and the session finds the latest usable one by
+// bisection.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h> // FILE, fclose(), fflush(), fopen(), fread(),
+		   // fseek(), fwrite(), getc(), rewind(), sprintf()
+#include <stdlib.h> // abort(), EXIT_SUCCESS, mkstemp(), strtol()
+#include <string.h> // strchr(), strcmp(), strerror(), strlen()
+#include <time.h> // clock(), clock_t, CLOCKS_PER_SEC
+
+#include "posix.h" // close(), dup2(), fork(), getpid(), lseek(),
+		   // pipe(), pread(), read(), unlink(), write()
+#include "nonposix.h"
+
+#if defined(__MSDOS__) || defined(_WIN32)
+# define MAY_FORK_CHECKPOINTS 0
+#else
+# define MAY_FORK_CHECKPOINTS 1
+# include <fcntl.h> // fcntl(), FD_CLOEXEC, F_SETFD
+# include <signal.h> // kill(), sigaction(), sigprocmask(), sigsuspend()
+# include <sys/wait.h> // waitpid(), WEXITSTATUS(), WIFEXITED()
+#endif
+
+// libgroff
+#include "errarg.h"
+#include "error.h"
+#include "lib.h" // INT_DIGITS, strsave(), xtmptemplate()
+#include "stringclass.h"
+
+// troff
+#include "checkpoint.h"
+
+static bool is_recording = false;
+static bool has_checkpoint = false;
+static clock_t last_checkpoint_time;
+static bool is_unrepeatable = false;
+static const char *document_name = 0 /* nullptr */;
+static input_record *records = 0 /* nullptr */;
+
+input_record *note_input_file(FILE **fpp, const char *path)
+{
+  if (!is_recording)
+    return 0 /* nullptr */;
+  if (0 /* nullptr */ == path) {
+    note_unrepeatable_input();
+    return 0 /* nullptr */;
+  }
+  input_record *r = new input_record;
+  r->path = strsave(path);
+  r->fpp = fpp;
+  r->offset = 0;
+  r->length = 0;
+  r->saw_eof = false;
+  r->hash = INPUT_HASH_BASIS;
+  r->reopened = 0 /* nullptr */;
+  r->next = records;
+  records = r;
+  return r;
+}
+
+void note_input_file_contents(const char *path)
+{
+  if (!is_recording)
+    return;
+  FILE *fp = (path != 0 /* nullptr */) ? fopen(path, FOPEN_RB)
+				       : 0 /* nullptr */;
+  if (0 /* nullptr */ == fp) {
+    note_unrepeatable_input();
+    return;
+  }
+  input_record *r = note_input_file(0 /* nullptr */, path);
+  int c;
+  do {
+    c = getc(fp);
+    r->note(c);
+  } while (c != EOF);
+  fclose(fp);
+}
+
+void note_input_closed(input_record *r)
+{
+  r->fpp = 0 /* nullptr */;
+}
+
+void note_unrepeatable_input()
+{
+  is_unrepeatable = true;
+}
+
+#if MAY_FORK_CHECKPOINTS
+
+// How often, in seconds, a waiting checkpoint checks that its session
+// is still there
+static const unsigned CHECKPOINT_POLL_INTERVAL = 10;
+
+// How many checkpoints to take at most for each second of processor
+// time spent formatting
+static const long CHECKPOINTS_PER_SECOND = 20;
+
+static pid_t session_pid;
+// In the session process, the write end of the command pipe and the
+// read end of the report pipe; elsewhere, the other ends.
+static int command_fd = -1;
+static int report_fd = -1;
+
+static volatile sig_atomic_t is_resume_requested = 0;
+
+static void handle_resume_signal(int)
+{
+  is_resume_requested = 1;
+}
+
+static void handle_alarm_signal(int)
+{
+}
+
+static void write_all(int fd, const char *s)
+{
+  size_t n = strlen(s);
+  while (n > 0) {
+    ssize_t r = write(fd, s, n);
+    if (r < 0) {
+      if (EINTR == errno)
+	continue;
+      fatal("cannot write to checkpoint pipe: %1", strerror(errno));
+    }
+    s += r;
+    n -= r;
+  }
+}
+
+// Read a line from `fd` into `buf`, without its newline, one byte at a
+// time so as to leave the rest for other readers of the pipe.  Return
+// false at the end of input.
+
+static bool read_line(int fd, char *buf, size_t size)
+{
+  size_t i = 0;
+  for (;;) {
+    char c;
+    ssize_t r = read(fd, &c, 1);
+    if (r < 0) {
+      if (EINTR == errno)
+	continue;
+      fatal("cannot read from checkpoint pipe: %1", strerror(errno));
+    }
+    if (0 == r)
+      return false;
+    if ('\n' == c)
+      break;
+    if (i < size - 1)
+      buf[i++] = c;
+  }
+  buf[i] = '\0';
+  return true;
+}
+
+static void close_reopened()
+{
+  for (input_record *r = records; r != 0 /* nullptr */; r = r->next)
+    if (r->reopened != 0 /* nullptr */) {
+      fclose(r->reopened);
+      r->reopened = 0 /* nullptr */;
+    }
+}
+
+// Return whether each file the document read still begins with what it
+// read.  If so and `want_reopen` is set, leave those still being read
+// reopened where reading got to.
+
+static bool is_input_unchanged(bool want_reopen)
+{
+  bool is_unchanged = true;
+  for (input_record *r = records;
+       is_unchanged && (r != 0 /* nullptr */);
+       r = r->next) {
+    FILE *fp = fopen(r->path, "r");
+    if (0 /* nullptr */ == fp) {
+      is_unchanged = false;
+      break;
+    }
+    unsigned long long h = INPUT_HASH_BASIS;
+    long n;
+    int c;
+    for (n = 0; (n < r->length) && ((c = getc(fp)) != EOF); n++)
+      h = hash_input_byte(h, c);
+    if ((n < r->length) || (h != r->hash)
+	|| (r->saw_eof && (getc(fp) != EOF)))
+      is_unchanged = false;
+    else if (want_reopen && (r->fpp != 0 /* nullptr */)) {
+      if (fseek(fp, r->offset, SEEK_SET) == 0) {
+	r->reopened = fp;
+	continue;
+      }
+      is_unchanged = false;
+    }
+    fclose(fp);
+  }
+  if (!is_unchanged)
+    close_reopened();
+  return is_unchanged;
+}
+
+// Return a temporary file already unlinked, so that it disappears
+// with the last process to close it.
+
+static FILE *open_spool_file()
+{
+  char *templ = xtmptemplate(0 /* nullptr */, 0 /* nullptr */);
+  errno = 0;
+  int fd = mkstemp(templ);
+  if (fd < 0)
+    fatal("cannot create temporary file: %1", strerror(errno));
+  FILE *fp = fdopen(fd, "w+");
+  if (0 /* nullptr */ == fp)
+    fatal("cannot open temporary file: %1", strerror(errno));
+  unlink(templ);
+  delete[] templ;
+  return fp;
+}
+
+// Copy the first `length` bytes of the standard output stream, which a
+// checkpoint shares with the process that took it, to `fp`.
+
+static bool copy_output_prefix(off_t length, FILE *fp)
+{
+  char buf[BUFSIZ];
+  off_t pos = 0;
+  while (pos < length) {
+    size_t n = sizeof buf;
+    if (length - pos < off_t(n))
+      n = size_t(length - pos);
+    ssize_t r = pread(STDOUT_FILENO, buf, n, pos);
+    if (r < 0 && EINTR == errno)
+      continue;
+    if (r <= 0) {
+      error("cannot read output of checkpoint: %1",
+	    (r < 0) ? strerror(errno) : "unexpected end of file");
+      return false;
+    }
+    if (fwrite(buf, 1, r, fp) != size_t(r)) {
+      error("cannot write output spool file: %1", strerror(errno));
+      return false;
+    }
+    pos += r;
+  }
+  if (fflush(fp) != 0) {
+    error("cannot write output spool file: %1", strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+static bool write_output_file(FILE *spool, const char *filename)
+{
+  rewind(spool);
+  errno = 0;
+  FILE *fp = fopen(filename, "w");
+  if (0 /* nullptr */ == fp) {
+    error("cannot open output file '%1': %2", filename,
+	  strerror(errno));
+    return false;
+  }
+  char buf[BUFSIZ];
+  size_t n;
+  bool is_ok = true;
+  while ((n = fread(buf, 1, sizeof buf, spool)) > 0)
+    if (fwrite(buf, 1, n, fp) != n) {
+      is_ok = false;
+      break;
+    }
+  if (ferror(spool) || (fclose(fp) != 0))
+    is_ok = false;
+  if (!is_ok)
+    error("cannot write output file '%1': %2", filename,
+	  strerror(errno));
+  return is_ok;
+}
+
+// Wait for commands as a checkpoint of output `output_length` bytes
+// long.  Return the name of the input file in the process forked to
+// format it; that process runs with signal mask `run_mask`.
+
+static const char *serve_checkpoint(off_t output_length,
+				    const sigset_t *run_mask)
+{
+  struct sigaction sa;
+  sa.sa_handler = handle_resume_signal;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = 0;
+  sigaction(SIGUSR1, &sa, 0 /* nullptr */);
+  sa.sa_handler = handle_alarm_signal;
+  sigaction(SIGALRM, &sa, 0 /* nullptr */);
+  sigset_t wait_mask = *run_mask;
+  sigdelset(&wait_mask, SIGUSR1);
+  sigdelset(&wait_mask, SIGALRM);
+  for (;;) {
+    is_resume_requested = 0;
+    while (!is_resume_requested) {
+      alarm(CHECKPOINT_POLL_INTERVAL);
+      sigsuspend(&wait_mask);
+      if (!is_resume_requested && (kill(session_pid, 0) < 0)
+	  && (ESRCH == errno))
+	_exit(EXIT_SUCCESS);
+    }
+    alarm(0);
+    char command[BUFSIZ];
+    if (!read_line(command_fd, command, sizeof command))
+      _exit(EXIT_SUCCESS);
+    char *input = command + 2;
+    char *output = strchr(input, ' ');
+    if (output != 0 /* nullptr */)
+      *output++ = '\0';
+    bool is_usable = (0 /* nullptr */ == document_name)
+		     || ((strcmp(input, document_name) == 0)
+			 && is_input_unchanged('!' == command[0]));
+    if ('?' == command[0]) {
+      write_all(report_fd, is_usable ? "y\n" : "n\n");
+      continue;
+    }
+    if (!is_usable || (0 /* nullptr */ == output)) {
+      write_all(report_fd, "n\n");
+      continue;
+    }
+    write_all(report_fd, "r\n");
+    FILE *spool = open_spool_file();
+    bool is_ok = copy_output_prefix(output_length, spool);
+    fflush(stderr);
+    pid_t pid = is_ok ? fork() : -1;
+    if (0 == pid) {
+      signal(SIGUSR1, SIG_DFL);
+      signal(SIGALRM, SIG_DFL);
+      sigprocmask(SIG_SETMASK, run_mask, 0 /* nullptr */);
+      if (dup2(fileno(spool), STDOUT_FILENO) < 0)
+	fatal("cannot redirect output to spool file: %1",
+	      strerror(errno));
+      fclose(spool);
+      for (input_record *r = records; r != 0 /* nullptr */;
+	   r = r->next)
+	if (r->fpp != 0 /* nullptr */) {
+	  fclose(*r->fpp);
+	  *r->fpp = r->reopened;
+	  r->reopened = 0 /* nullptr */;
+	}
+      if (0 /* nullptr */ == document_name)
+	document_name = strsave(input);
+      is_recording = true;
+      // Processor time counts from zero in a new process.
+      last_checkpoint_time = clock();
+      return document_name;
+    }
+    if (pid < 0) {
+      if (is_ok)
+	error("cannot fork to resume from checkpoint: %1",
+	      strerror(errno));
+      is_ok = false;
+    }
+    else {
+      int status;
+      while (waitpid(pid, &status, 0) < 0)
+	if (errno != EINTR)
+	  fatal("cannot wait for formatting process: %1",
+		strerror(errno));
+      is_ok = WIFEXITED(status) && (EXIT_SUCCESS == WEXITSTATUS(status));
+    }
+    close_reopened();
+    if (is_ok)
+      is_ok = write_output_file(spool, output);
+    fclose(spool);
+    write_all(report_fd, is_ok ? "d 0\n" : "d 1\n");
+  }
+}
+
+void take_checkpoint()
+{
+  if (!is_recording || is_unrepeatable)
+    return;
+  // Copying the pages that the formatter and its checkpoints share
+  // costs the formatter about a millisecond for each checkpoint, too
+  // much to pay at every page of a long document.  Resuming from a
+  // checkpoint a few pages back costs less.
+  clock_t now = clock();
+  if (has_checkpoint && (now - last_checkpoint_time
+			 < CLOCKS_PER_SEC / CHECKPOINTS_PER_SECOND))
+    return;
+  has_checkpoint = true;
+  last_checkpoint_time = now;
+  // The checkpoint must not inherit buffered output.
+  fflush(stdout);
+  fflush(stderr);
+  off_t output_length = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+  if (output_length < 0) {
+    note_unrepeatable_input();
+    return;
+  }
+  sigset_t mask, old_mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGUSR1);
+  sigaddset(&mask, SIGALRM);
+  sigprocmask(SIG_BLOCK, &mask, &old_mask);
+  pid_t pid = fork();
+  if (0 == pid) {
+    (void) serve_checkpoint(output_length, &old_mask);
+    return;
+  }
+  sigprocmask(SIG_SETMASK, &old_mask, 0 /* nullptr */);
+  if (pid < 0) {
+    error("cannot fork checkpoint: %1", strerror(errno));
+    note_unrepeatable_input();
+    return;
+  }
+  char report[sizeof "c " + INT_DIGITS + 1];
+  sprintf(report, "c %ld\n", long(pid));
+  write_all(report_fd, report);
+}
+
+// The session's record of the checkpoints of each document
+
+struct session_document {
+  char *input;
+  pid_t *checkpoints;		// oldest first
+  int ncheckpoints;
+  int size;
+  session_document *next;
+};
+
+static session_document *documents = 0 /* nullptr */;
+static pid_t root_checkpoint = -1;
+
+static session_document *get_document(const char *input)
+{
+  session_document *d;
+  for (d = documents; d != 0 /* nullptr */; d = d->next)
+    if (strcmp(d->input, input) == 0)
+      return d;
+  d = new session_document;
+  d->input = strsave(input);
+  d->checkpoints = 0 /* nullptr */;
+  d->ncheckpoints = 0;
+  d->size = 0;
+  d->next = documents;
+  documents = d;
+  return d;
+}
+
+static void add_checkpoint(session_document *d, pid_t pid)
+{
+  if (d->ncheckpoints >= d->size) {
+    pid_t *old_checkpoints = d->checkpoints;
+    d->size = (0 == d->size) ? 16 : d->size * 2;
+    d->checkpoints = new pid_t[d->size];
+    for (int i = 0; i < d->ncheckpoints; i++)
+      d->checkpoints[i] = old_checkpoints[i];
+    delete[] old_checkpoints;
+  }
+  d->checkpoints[d->ncheckpoints++] = pid;
+}
+
+// Stop all but the first `n` checkpoints of `d`.
+
+static void drop_checkpoints(session_document *d, int n)
+{
+  while (d->ncheckpoints > n)
+    (void) kill(d->checkpoints[--(d->ncheckpoints)], SIGTERM);
+}
+
+static void read_report(char *buf, size_t size)
+{
+  if (!read_line(report_fd, buf, size))
+    fatal("checkpoint processes exited unexpectedly");
+}
+
+// Send `command` to the checkpoint `pid` and return the first byte of
+// its reply, or 'n' if the checkpoint is gone.
+
+static char send_command(pid_t pid, const char *command)
+{
+  if (kill(pid, SIGUSR1) < 0)
+    return 'n';
+  write_all(command_fd, command);
+  char reply[16];
+  read_report(reply, sizeof reply);
+  return reply[0];
+}
+
+void start_checkpoint_session(void (*format)(const char *))
+{
+  int command_pipe[2];
+  int report_pipe[2];
+  if ((pipe(command_pipe) < 0) || (pipe(report_pipe) < 0))
+    fatal("cannot create checkpoint pipe: %1", strerror(errno));
+  for (int i = 0; i < 2; i++) {
+    (void) fcntl(command_pipe[i], F_SETFD, FD_CLOEXEC);
+    (void) fcntl(report_pipe[i], F_SETFD, FD_CLOEXEC);
+  }
+  session_pid = getpid();
+  fflush(stdout);
+  fflush(stderr);
+  sigset_t mask, old_mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGUSR1);
+  sigaddset(&mask, SIGALRM);
+  sigprocmask(SIG_BLOCK, &mask, &old_mask);
+  root_checkpoint = fork();
+  if (0 == root_checkpoint) {
+    close(command_pipe[1]);
+    close(report_pipe[0]);
+    command_fd = command_pipe[0];
+    report_fd = report_pipe[1];
+    format(serve_checkpoint(0, &old_mask));
+    abort();
+  }
+  sigprocmask(SIG_SETMASK, &old_mask, 0 /* nullptr */);
+  if (root_checkpoint < 0)
+    fatal("cannot fork checkpoint: %1", strerror(errno));
+  close(command_pipe[0]);
+  close(report_pipe[1]);
+  command_fd = command_pipe[1];
+  report_fd = report_pipe[0];
+}
+
+bool format_from_checkpoint(const char *input, const char *output)
+{
+  session_document *d = get_document(input);
+  string query("? ");
+  query += input;
+  query += "\n";
+  query += '\0';
+  int lo = 0;
+  int hi = d->ncheckpoints;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if ('y' == send_command(d->checkpoints[mid], query.contents()))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  drop_checkpoints(d, lo);
+  string command("! ");
+  command += input;
+  command += " ";
+  command += output;
+  command += "\n";
+  command += '\0';
+  for (;;) {
+    if (0 == d->ncheckpoints) {
+      if (send_command(root_checkpoint, command.contents()) != 'r')
+	fatal("root checkpoint exited unexpectedly");
+      break;
+    }
+    // The input can have changed since we asked.
+    if ('r' == send_command(d->checkpoints[d->ncheckpoints - 1],
+			    command.contents()))
+      break;
+    drop_checkpoints(d, d->ncheckpoints - 1);
+  }
+  for (;;) {
+    char report[sizeof "c " + INT_DIGITS + 1];
+    read_report(report, sizeof report);
+    if ('c' == report[0])
+      add_checkpoint(d, pid_t(strtol(report + 2, 0 /* nullptr */,
+				      10)));
+    else if ('d' == report[0])
+      return ('0' == report[2]);
+  }
+}
+
+void end_checkpoint_session()
+{
+  for (session_document *d = documents; d != 0 /* nullptr */;
+       d = d->next)
+    drop_checkpoints(d, 0);
+  (void) kill(root_checkpoint, SIGTERM);
+  (void) waitpid(root_checkpoint, 0 /* nullptr */, 0);
+  close(command_fd);
+  close(report_fd);
+}
+
+#else /* not MAY_FORK_CHECKPOINTS */
+
+void take_checkpoint()
+{
+}
+
+void start_checkpoint_session(void (*)(const char *))
+{
+  fatal("checkpoint sessions are not supported on this system");
+}
+
+bool format_from_checkpoint(const char *, const char *)
+{
+  return false;
+}
+
+void end_checkpoint_session()
+{
+}
+
+#endif /* not MAY_FORK_CHECKPOINTS */
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
@@ -0,0 +1,96 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// Checkpointed formatting sessions; see the -X option in troff(1).
+//
+// groff doesn't yet use include guards, so until it does, any source
+// file needing symbols from this one must #include <stdio.h> first.
+
+const unsigned long long INPUT_HASH_BASIS = 0xcbf29ce484222325ULL;
+
+// 64-bit FNV-1a
+inline unsigned long long hash_input_byte(unsigned long long h, int c)
+{
+  return (h ^ (unsigned char) c) * 0x100000001b3ULL;
+}
+
+// What a document has read from one of its input files, so that a
+// checkpoint can tell whether the file still begins the same way.
+
+struct input_record {
+  char *path;
+  FILE **fpp;			// the reading file_iterator's stream,
+				// while it is open
+  long offset;			// bytes read, less those pushed back
+  long length;			// bytes read at most
+  bool saw_eof;
+  unsigned long long hash;	// of the first `length` bytes
+  FILE *reopened;		// `path` reopened at `offset`, to resume
+  input_record *next;
+  void note(int c) {
+    if (EOF == c)
+      saw_eof = true;
+    else if (++offset > length) {
+      length = offset;
+      hash = hash_input_byte(hash, c);
+    }
+  }
+  void unget() { offset--; }
+};
+
+// Return a record for a file_iterator to keep as it reads from `*fpp`,
+// opened from `path`, or a null pointer if no document is being
+// recorded.  `path` is null if the input can't be read again, as from
+// a pipe or the standard input stream.
+input_record *note_input_file(FILE ** /* fpp */,
+			      const char * /* path */);
+
+// Record the whole of the file at `path`, which the document read
+// other than through a file_iterator, so that a checkpoint is used only
+// while the file stays the same.  A null `path`, for a file that
+// couldn't be found, makes the input unrepeatable.
+void note_input_file_contents(const char * /* path */);
+
+// Note that the stream of `r` is closed.
+void note_input_closed(input_record * /* r */);
+
+// Note that the document has read input, or had effects outside its
+// output, that a checkpoint can't account for; it takes none after.
+void note_unrepeatable_input();
+
+// If a document is being recorded, save a checkpoint of the formatter.
+void take_checkpoint();
+
+// Fork the checkpoint from which each document of a session starts.
+// The process that formats a document from it calls `format` on the
+// document's input file name; `format` must not return.
+void start_checkpoint_session(void (*)(const char *) /* format */);
+
+// Format `input` into the file `output`, resuming from the latest
+// checkpoint taken after reading the same input as `input` now begins
+// with.  Return false if formatting failed.
+bool format_from_checkpoint(const char * /* input */,
+			    const char * /* output */);
+
+// Stop the processes of the session's checkpoints.
+void end_checkpoint_session();
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
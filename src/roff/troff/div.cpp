@@ -53,6 +53,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "request.h" // prerequisite of node.h; macro
 #include "node.h"
 #include "reg.h"
+#include "profile.h" // write_profile()
+#include "checkpoint.h" // take_checkpoint()
 
 bool is_exit_underway = false;
 bool is_eoi_macro_finished = false;
@@ -650,6 +652,7 @@ void end_diversions()
 // input.cpp:exit_troff() cleans up most formatter state.
 void write_any_trailer_and_exit(int exit_code)
 {
+  write_profile();
   // If output was never initialized, there is no trailer to write.
   if (the_output != 0 /* nullptr */) {
     the_output->trailer(topdiv->get_page_length());
@@ -679,6 +682,10 @@ bool top_level_diversion::begin_page(vunits n)
     write_any_trailer_and_exit(EXIT_SUCCESS);
   if (0 /* nullptr */ == the_output)
     init_output();
+  // Between pages, save the formatter's state for the next revision of
+  // the document, if we're in a checkpoint session.
+  if ((page_count > 0) && !is_exit_underway)
+    take_checkpoint();
   ++page_count;
   if (overriding_next_page_number) {
     page_number = next_page_number;
@@ -1097,21 +1104,37 @@ const char *page_length_reg::get_string()
 class vertical_position_reg : public reg {
 public:
   const char *get_string();
+  bool get_decimal_value(units *);
 };
 
-const char *vertical_position_reg::get_string()
+bool vertical_position_reg::get_decimal_value(units *d)
 {
   if ((curdiv == topdiv) && (topdiv->before_first_page_status > 0))
-    return "-1";
+    *d = -1;
   else
-    return i_to_a(curdiv->get_vertical_position().to_units());
+    *d = curdiv->get_vertical_position().to_units();
+  return true;
+}
+
+const char *vertical_position_reg::get_string()
+{
+  units d;
+  (void) get_decimal_value(&d);
+  return i_to_a(d);
 }
 
 class high_water_mark_reg : public reg {
 public:
   const char *get_string();
+  bool get_decimal_value(units *);
 };
 
+bool high_water_mark_reg::get_decimal_value(units *d)
+{
+  *d = curdiv->get_high_water_mark().to_units();
+  return true;
+}
+
 const char *high_water_mark_reg::get_string()
 {
   return i_to_a(curdiv->get_high_water_mark().to_units());
@@ -1120,8 +1143,15 @@ const char *high_water_mark_reg::get_string()
 class distance_to_next_trap_reg : public reg {
 public:
   const char *get_string();
+  bool get_decimal_value(units *);
 };
 
+bool distance_to_next_trap_reg::get_decimal_value(units *d)
+{
+  *d = curdiv->distance_to_next_trap().to_units();
+  return true;
+}
+
 const char *distance_to_next_trap_reg::get_string()
 {
   return i_to_a(curdiv->distance_to_next_trap().to_units());
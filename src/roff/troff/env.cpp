@@ -42,6 +42,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "error.h" // prerequisite of troff.h
 #include "lib.h" // UINT_DIGITS, i_to_a(), if_to_a(),
 		 // is_invalid_input_char()
+#include "ptable.h"
 #include "searchpath.h" // prerequisite of troff.h
 
 // troff
@@ -60,6 +61,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "request.h" // prerequisite of node.h; macro
 #include "node.h"
 #include "reg.h"
+#include "checkpoint.h" // note_input_file_contents()
 
 symbol default_family("T");
 
@@ -3377,6 +3379,7 @@ class int_env_reg : public reg {
   int_env_reg(INT_FUNCP);
   const char *get_string();
   bool get_value(units *val);
+  bool get_decimal_value(units *val);
 };
 
 class unsigned_env_reg : public reg {
@@ -3393,6 +3396,7 @@ class vunits_env_reg : public reg {
   vunits_env_reg(VUNITS_FUNCP f);
   const char *get_string();
   bool get_value(units *val);
+  bool get_decimal_value(units *val);
 };
 
 class hunits_env_reg : public reg {
@@ -3401,6 +3405,7 @@ class hunits_env_reg : public reg {
   hunits_env_reg(HUNITS_FUNCP f);
   const char *get_string();
   bool get_value(units *val);
+  bool get_decimal_value(units *val);
 };
 
 class string_env_reg : public reg {
@@ -3425,6 +3430,11 @@ const char *int_env_reg::get_string()
   return i_to_a((curenv->*func)());
 }
 
+bool int_env_reg::get_decimal_value(units *val)
+{
+  return get_value(val);
+}
+
 unsigned_env_reg::unsigned_env_reg(UNSIGNED_FUNCP f) : func(f)
 {
 }
@@ -3455,6 +3465,11 @@ const char *vunits_env_reg::get_string()
   return i_to_a((curenv->*func)().to_units());
 }
 
+bool vunits_env_reg::get_decimal_value(units *val)
+{
+  return get_value(val);
+}
+
 hunits_env_reg::hunits_env_reg(HUNITS_FUNCP f) : func(f)
 {
 }
@@ -3470,6 +3485,11 @@ const char *hunits_env_reg::get_string()
   return i_to_a((curenv->*func)().to_units());
 }
 
+bool hunits_env_reg::get_decimal_value(units *val)
+{
+  return get_value(val);
+}
+
 string_env_reg::string_env_reg(STRING_FUNCP f) : func(f)
 {
 }
@@ -3833,14 +3853,60 @@ public:
   void interpret_patterns_file(const char *, bool, dictionary *);
 };
 
+// The hyphenation points found in recently hyphenated words.  A key is
+// a byte encoding the hyphenation mode flags that affect the result,
+// followed by the word's hyphenation codes; its value lists, as a
+// null-terminated string, the 1-based positions of the letters after
+// which the word may be broken.
+
+declare_ptable(char)
+implement_ptable(char)
+
 struct hyphenation_language {
   symbol name;
   dictionary exceptions;
   hyphen_trie patterns;
-  hyphenation_language(symbol nm) : name(nm), exceptions(501) {}
-  ~hyphenation_language() { }
+  PTABLE(char) *cache;
+  int cache_entries;
+  unsigned int cache_hits;
+  unsigned int cache_misses;
+  hyphenation_language(symbol nm);
+  ~hyphenation_language();
+  void clear_cache();
 };
 
+// Natural-language text uses the same few thousand words over and over;
+// when the cache fills, we simply start afresh.
+static const int HYPHENATION_CACHE_MAX = 8192;
+
+hyphenation_language::hyphenation_language(symbol nm)
+: name(nm), exceptions(501), cache(0 /* nullptr */), cache_entries(0),
+  cache_hits(0), cache_misses(0)
+{
+}
+
+hyphenation_language::~hyphenation_language()
+{
+  clear_cache();
+}
+
+// Discard cached hyphenation points; call this whenever the language's
+// exceptions or patterns change.
+
+void hyphenation_language::clear_cache()
+{
+  if (0 /* nullptr */ == cache)
+    return;
+  PTABLE_ITERATOR(char) iter(cache);
+  const char *key;
+  char *points;
+  while (iter.next(&key, &points))
+    delete[] points;
+  delete cache;
+  cache = 0 /* nullptr */;
+  cache_entries = 0;
+}
+
 dictionary language_dictionary(5);
 hyphenation_language *current_language = 0 /* nullptr */;
 
@@ -4068,6 +4134,7 @@ static void add_hyphenation_exception_words_request() // .hw
 	delete[] tem;
     }
   }
+  current_language->clear_cache();
   skip_line();
 }
 
@@ -4090,8 +4157,10 @@ static void remove_hyphenation_exception_words_request() // .rhw
       unsigned char *word
 	= static_cast<unsigned char *>(
 	  current_language->exceptions.lookup(rbuf));
-      if (word != 0 /* nullptr */)
+      if (word != 0 /* nullptr */) {
 	current_language->exceptions.remove(rbuf);
+	current_language->clear_cache();
+      }
     }
     if (!has_arg()) {
       skip_line();
@@ -4115,6 +4184,7 @@ static void remove_hyphenation_exception_words_request() // .rhw
 	assert(word != 0 /* nullptr */);
 	delete[] word;
 	word = 0 /* nullptr */;
+	current_language->clear_cache();
       }
     }
   }
@@ -4446,6 +4516,7 @@ void hyphen_trie::interpret_patterns_file(const char *name,
   errno = 0;
   char *path = 0;
   FILE *fp = mac_path->open_file(name, &path);
+  note_input_file_contents(path);
   if (0 /* nullptr */ == fp) {
     error("cannot open hyphenation pattern file '%1': %2", name,
 	  strerror(errno));
@@ -4587,6 +4658,26 @@ const char *hyphenation_language_reg::get_string()
 	  ? current_language->name.contents() : "";
 }
 
+class hyphenation_cache_reg : public reg {
+  bool want_hits;
+public:
+  hyphenation_cache_reg(bool);
+  const char *get_string();
+};
+
+hyphenation_cache_reg::hyphenation_cache_reg(bool b)
+: want_hits(b)
+{
+}
+
+const char *hyphenation_cache_reg::get_string()
+{
+  if (0 /* nullptr */ == current_language)
+    return "0";
+  return ui_to_a(want_hits ? current_language->cache_hits
+		 : current_language->cache_misses);
+}
+
 class hyphenation_default_mode_reg : public reg {
 public:
   const char *get_string();
@@ -4677,6 +4768,10 @@ void init_env_requests()
   init_string_env_reg(".fn", get_font_name_string);
   init_int_env_reg(".height", get_char_height);
   register_dictionary.define(".hla", new hyphenation_language_reg);
+  register_dictionary.define(".hyhits",
+			     new hyphenation_cache_reg(true));
+  register_dictionary.define(".hymisses",
+			     new hyphenation_cache_reg(false));
   init_int_env_reg(".hlc", get_hyphen_line_count);
   init_int_env_reg(".hlm", get_hyphen_line_max);
   init_unsigned_env_reg(".hy", get_hyphenation_mode);
@@ -4751,6 +4846,79 @@ void init_env_requests()
 
 // Appendix H of _The TeXbook_ is useful background for the following.
 
+// Store in `points`, as a null-terminated string, the 1-based positions
+// of the letters after which the word of `len` hyphenation codes at
+// `hbuf + 1` may be broken.  `hbuf` must have room for a dot ('.') at
+// each end of the word and a null terminator.
+
+static void find_hyphenation_points(char *hbuf, int len,
+				    unsigned int flags, char *points)
+{
+  char *bufp = hbuf + 1;
+  int n = 0;
+  // Check hyphenation exceptions defined with `hw` request.
+  bufp[len] = '\0';
+  unsigned char *pos = static_cast<unsigned char *>(
+		       current_language->exceptions.lookup(bufp));
+  if (pos != 0 /* nullptr */) {
+    for (int j = 0; pos[j] != 0U; j++)
+      points[n++] = char(pos[j]);
+  }
+  else {
+    // Check `\hyphenation' entries from pattern files; such entries are
+    // marked with a trailing space.
+    bufp[len] = ' ';
+    bufp[len + 1] = '\0';
+    pos = static_cast<unsigned char *>(
+	  current_language->exceptions.lookup(bufp));
+    if (pos != 0 /* nullptr */) {
+      int j = 0;
+      if (1U == pos[j]) {
+	if (flags & HYPHEN_FIRST_CHAR)
+	  points[n++] = char(1);
+	j++;
+      }
+      if (2U == pos[j]) {
+	if (!(flags & HYPHEN_NOT_FIRST_CHARS))
+	  points[n++] = char(2);
+	j++;
+      }
+      if (!(flags & HYPHEN_LAST_CHAR))
+	--len;
+      if (flags & HYPHEN_NOT_LAST_CHARS)
+	--len;
+      for (int i = 3; i < len; i++)
+	if (pos[j] == i) {
+	  points[n++] = char(i);
+	  j++;
+	}
+    }
+    else {
+      hbuf[0] = hbuf[len + 1] = '.';
+      int num[WORD_MAX + 2 + 1];
+      (void) memset(num, 0, sizeof num);
+      current_language->patterns.hyphenate(hbuf, len + 2, num);
+      // The position of a hyphenation point gets marked with an odd
+      // number.  Example:
+      //
+      //   hbuf:  . h e l p f u l .
+      //   num:  0 0 0 2 4 3 0 0 0 0
+      if (!(flags & HYPHEN_FIRST_CHAR))
+	num[2] = 0;
+      if (flags & HYPHEN_NOT_FIRST_CHARS)
+	num[3] = 0;
+      if (flags & HYPHEN_LAST_CHAR)
+	++len;
+      if (flags & HYPHEN_NOT_LAST_CHARS)
+	--len;
+      for (int i = 2; i < len; i++)
+	if (num[i] & 1)
+	  points[n++] = char(i - 1);
+    }
+  }
+  points[n] = '\0';
+}
+
 static void hyphenate(hyphen_list *h, unsigned int flags)
 {
   if (0 /* nullptr */ == current_language)
@@ -4761,12 +4929,13 @@ static void hyphenate(hyphen_list *h, unsigned int flags)
     int len = 0;
     // Locate hyphenable points within a (subset of) an input word.
     //
-    // We first look up the word in the environment's hyphenation
-    // exceptions dictionary; its keys are C strings, so the buffer
-    // `hbuf` that holds our word needs to be null terminated and we
-    // allocate a byte for that.  If the lookup fails, we apply the
-    // hyphenation patterns, which require that the word be bracketed at
-    // each end with a dot ('.'), so we allocate two further bytes.
+    // We first look up the word in the hyphenation language's cache of
+    // results, and failing that, in its hyphenation exceptions
+    // dictionary; its keys are C strings, so the buffer `hbuf` that
+    // holds our word needs to be null terminated and we allocate a byte
+    // for that.  If the lookup fails, we apply the hyphenation
+    // patterns, which require that the word be bracketed at each end
+    // with a dot ('.'), so we allocate two further bytes.
     //
     // `hbuf` can be thought of as a mapping of the letters of the input
     // word to the hyphenation codes that correspond to each letter.
@@ -4787,80 +4956,43 @@ static void hyphenate(hyphen_list *h, unsigned int flags)
     }
     hyphen_list *nexth = tem;
     if (len >= 2) {
-      // Check hyphenation exceptions defined with `hw` request.
-      assert((bufp + len) < (hbuf + sizeof hbuf));
-      bufp[len] = '\0';
-      unsigned char *pos = static_cast<unsigned char *>(
-			   current_language->exceptions.lookup(bufp));
-      if (pos != 0 /* nullptr */) {
-	int j = 0;
-	int i = 1;
-	for (tem = h; tem != 0 /* nullptr */; tem = tem->next, i++)
-	  if (pos[j] == i) {
-	    tem->is_hyphen = true;
-	    j++;
-	  }
-      }
+      assert((hbuf + len + 1) < (hbuf + sizeof hbuf));
+      hyphenation_language *lang = current_language;
+      char key[1 + WORD_MAX + 1];
+      key[0] = char(1 + (flags & (HYPHEN_NOT_LAST_CHARS
+				  | HYPHEN_NOT_FIRST_CHARS
+				  | HYPHEN_LAST_CHAR
+				  | HYPHEN_FIRST_CHAR)));
+      memcpy(key + 1, bufp, len);
+      key[len + 1] = '\0';
+      const char *points = 0 /* nullptr */;
+      if (lang->cache != 0 /* nullptr */)
+	points = lang->cache->lookup(key);
+      if (points != 0 /* nullptr */)
+	lang->cache_hits++;
       else {
-	// Check `\hyphenation' entries from pattern files; such entries
-	// are marked with a trailing space.
-	assert((hbuf + len + 1) < (hbuf + sizeof hbuf));
-	bufp[len] = ' ';
-	bufp[len + 1] = '\0';
-	pos = static_cast<unsigned char *>(
-	      current_language->exceptions.lookup(bufp));
-	if (pos != 0 /* nullptr */) {
-	  int j = 0;
-	  int i = 1;
-	  tem = h;
-	  if (pos[j] == i) {
-	    if (flags & HYPHEN_FIRST_CHAR)
-	      tem->is_hyphen = true;
-	    j++;
-	  }
-	  tem = tem->next;
-	  i++;
-	  if (pos[j] == i) {
-	    if (!(flags & HYPHEN_NOT_FIRST_CHARS))
-	      tem->is_hyphen = true;
-	    j++;
-	  }
-	  tem = tem->next;
-	  i++;
-	  if (!(flags & HYPHEN_LAST_CHAR))
-	    --len;
-	  if (flags & HYPHEN_NOT_LAST_CHARS)
-	    --len;
-	  for (; i < len && tem; tem = tem->next, i++)
-	    if (pos[j] == i) {
-	      tem->is_hyphen = true;
-	      j++;
-	    }
-	}
-	else {
-	  hbuf[0] = hbuf[len + 1] = '.';
-	  int num[WORD_MAX + 2 + 1];
-	  (void) memset(num, 0, sizeof num);
-	  current_language->patterns.hyphenate(hbuf, len + 2, num);
-	  // The position of a hyphenation point gets marked with an odd
-	  // number.  Example:
-	  //
-	  //   hbuf:  . h e l p f u l .
-	  //   num:  0 0 0 2 4 3 0 0 0 0
-	  if (!(flags & HYPHEN_FIRST_CHAR))
-	    num[2] = 0;
-	  if (flags & HYPHEN_NOT_FIRST_CHARS)
-	    num[3] = 0;
-	  if (flags & HYPHEN_LAST_CHAR)
-	    ++len;
-	  if (flags & HYPHEN_NOT_LAST_CHARS)
-	    --len;
-	  int i;
-	  for (i = 2, tem = h; i < len && tem; tem = tem->next, i++)
-	    if (num[i] & 1)
-	      tem->is_hyphen = true;
+	lang->cache_misses++;
+	char pointbuf[WORD_MAX + 1];
+	find_hyphenation_points(hbuf, len, flags, pointbuf);
+	if ((0 /* nullptr */ == lang->cache)
+	    || (lang->cache_entries >= HYPHENATION_CACHE_MAX)) {
+	  lang->clear_cache();
+	  lang->cache = new PTABLE(char);
 	}
+	char *p = new char[strlen(pointbuf) + 1];
+	strcpy(p, pointbuf);
+	(void) lang->cache->define(key, p);
+	lang->cache_entries++;
+	points = p;
       }
+      int j = 0;
+      int i = 1;
+      for (tem = h; (tem != 0 /* nullptr */) && (points[j] != '\0');
+	   tem = tem->next, i++)
+	if (static_cast<unsigned char>(points[j]) == i) {
+	  tem->is_hyphen = true;
+	  j++;
+	}
     }
     h = nexth;
   }
@@ -4872,9 +5004,11 @@ static void update_hyphenation_patterns_from_file(bool appending)
   if (filename != 0 /* nullptr */) {
     if (0 /* nullptr */ == current_language)
       error("no current hyphenation language");
-    else
+    else {
       current_language->patterns.interpret_patterns_file(filename,
 	  appending, &current_language->exceptions);
+      current_language->clear_cache();
+    }
   }
 }
 
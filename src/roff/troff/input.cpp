@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <assert.h>
 #include <errno.h> // ENOENT, errno
+#include <limits.h> // INT_MAX, INT_MIN
 #include <locale.h> // setlocale()
 #include <stdcountof.h>
 #include <stdio.h> // prerequisite of searchpath.h
@@ -42,10 +43,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <stack>
 
 // operating system services
-// needed for getpid() and isatty()
+// needed for fork(), getpid(), and isatty()
 #include "posix.h"
 #include "nonposix.h"
 
+// Batch mode forks a process for each document.
+#if defined(__MSDOS__) || defined(_WIN32)
+# define MAY_FORK_BATCH_JOBS 0
+#else
+# define MAY_FORK_BATCH_JOBS 1
+# include <sys/wait.h> // wait(), WEXITSTATUS(), WIFEXITED()
+#endif
+
 // build configuration
 #include "defs.h"
 
@@ -58,6 +67,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "cmap.h" // cmlower(), cmupper()
 #include "cset.h" // cset, csalpha(), csdigit(), csgraph(), cslower(),
 		  // csprint(), cspunct(), csupper()
+#include "allocation.h" // allocation_scope
 #include "device.h"
 #include "font.h" // prerequisite of charinfo.h
 #include "json-encode.h" // json_encode_char()
@@ -82,6 +92,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "request.h" // prerequisite of node.h; macro
 #include "node.h"
 #include "reg.h"
+#include "profile.h" // profile_enter(), profile_leave(), want_profile
+#include "checkpoint.h" // note_input_file(), take_checkpoint()
 
 #define MACRO_PREFIX "tmac."
 #define MACRO_POSTFIX ".tmac"
@@ -132,6 +144,7 @@ unsigned char hpf_code_table[256];
 static unsigned int desired_warnings = DEFAULT_WARNING_CATEGORY_SET;
 static bool want_errors_inhibited = false;
 static bool want_input_ignored = false;
+static bool want_utf8_input = false;	// `-K utf-8`
 
 static symbol end_of_input_macro_name;
 static symbol blank_line_macro_name;
@@ -140,6 +153,7 @@ bool want_att_compat = false;
 bool want_abstract_output = false;
 bool want_nodes_dumped = false;
 bool want_output_suppressed = false;
+bool want_binary_output = false;	// `-B`
 bool is_writing_html = false;
 static int suppression_level = 0;	// depth of nested \O escapes
 
@@ -195,6 +209,7 @@ static void interpolate_string(symbol);
 static void interpolate_string_with_args(symbol);
 static void interpolate_macro_or_invoke_request(symbol, bool = false);
 static void interpolate_number_format(symbol);
+static bool interpolate_register_value(symbol, int, units *);
 static void interpolate_environment_variable(symbol);
 
 static symbol composite_glyph_name(symbol);
@@ -389,7 +404,8 @@ private:
   virtual bool has_args() { return false; }
   virtual int nargs() { return 0; }
   virtual input_iterator *get_arg(int) { return 0 /* nullptr */; }
-  virtual arg_list *get_arg_list() { return 0 /* nullptr */; }
+  virtual arg_list *get_arg_list(int * /* first */)
+    { return 0 /* nullptr */; }
   virtual symbol get_macro_name() { return NULL_SYMBOL; }
   virtual bool space_follows_arg(int) { return false; }
   virtual bool get_break_flag() { return false; }
@@ -398,7 +414,8 @@ private:
 			    int * /* linep */) { return false; }
   virtual void backtrace() {}
   virtual bool set_location(const char *, int) { return false; }
-  virtual bool next_file(FILE *, const char *) { return false; }
+  virtual bool next_file(FILE *, const char *, const char * /* path */)
+    { return false; }
   virtual void shift(int) {}
   virtual int is_boundary() {return 0; } // three-valued Boolean :-|
   virtual bool is_file() { return false; }
@@ -442,6 +459,18 @@ public:
   int is_boundary() { return 2; }
 };
 
+// Write the escape sequence preconv(1) would produce for code point
+// `cp` to `buf`, which must have room for `CODE_POINT_ESCAPE_BUFSZ`
+// bytes.  All we need is `sizeof "\\[u10FFFF]"` but GCC's
+// "-Wformat-truncation" warning doesn't know that Unicode code points
+// are limited in range.
+static const size_t CODE_POINT_ESCAPE_BUFSZ = sizeof "\\[uFFFFFFFF]";
+
+static void format_code_point_escape(char *buf, int cp)
+{
+  (void) snprintf(buf, CODE_POINT_ESCAPE_BUFSZ, "\\[u%04X]", cp);
+}
+
 class file_iterator : public input_iterator {
   FILE *fp;
   int lineno;
@@ -449,11 +478,21 @@ class file_iterator : public input_iterator {
   bool was_popened;
   bool seen_newline;
   bool seen_escape;
+  bool is_utf8;			// decode input as UTF-8 (see `-K`)
+  bool is_at_start;		// no byte read yet; a BOM may follow
+  int pending_code_point;	// decoded but not yet delivered, or -1
+  input_record *record;		// see checkpoint.h
   enum { BUF_SIZE = 512 };
   unsigned char buf[BUF_SIZE];
   void close();
+  int get_byte();
+  void unget_byte(int);
+  int read_code_point(int);
+  int deliver_code_point(int, node **);
 public:
-  file_iterator(FILE *, const char *, bool = false);
+  file_iterator(FILE *, const char *, bool /* popened */ = false,
+		bool /* is_macro_file */ = false,
+		const char * /* path */ = 0 /* nullptr */);
   ~file_iterator();
   int fill(node **); // returns an unsigned char or `EOF`
   int peek();
@@ -461,15 +500,25 @@ public:
 		    int * /* linep */);
   void backtrace();
   bool set_location(const char *, int);
-  bool next_file(FILE *, const char *);
+  bool next_file(FILE *, const char *, const char * /* path */);
   bool is_file() { return true; }
 };
 
-file_iterator::file_iterator(FILE *f, const char *fn, bool popened)
+// `path` names the file opened, if `fn` doesn't.
+
+file_iterator::file_iterator(FILE *f, const char *fn, bool popened,
+			     bool is_macro_file, const char *path)
 : fp(f), lineno(1), was_popened(popened),
-  seen_newline(false), seen_escape(false)
+  seen_newline(false), seen_escape(false),
+  is_utf8(want_utf8_input && !is_macro_file), is_at_start(true),
+  pending_code_point(-1)
 {
   filename = strdup(const_cast<char *>(fn));
+  if ((fp == stdin) || was_popened)
+    path = 0 /* nullptr */;
+  else if (0 /* nullptr */ == path)
+    path = fn;
+  record = note_input_file(&fp, path);
   if ((font::use_charnames_in_special) && (fn != 0 /* nullptr */)) {
     if (!the_output)
       init_output();
@@ -484,6 +533,8 @@ file_iterator::~file_iterator()
 
 void file_iterator::close()
 {
+  if (record != 0 /* nullptr */)
+    note_input_closed(record);
   if (fp == stdin)
     clearerr(stdin);
   else if (was_popened)
@@ -492,19 +543,40 @@ void file_iterator::close()
     fclose(fp);
 }
 
-bool file_iterator::next_file(FILE *f, const char *s)
+bool file_iterator::next_file(FILE *f, const char *s,
+			      const char *path)
 {
   close();
   fp = f;
+  record = note_input_file(&fp, (fp == stdin) ? 0 /* nullptr */
+					      : path);
   set_location(s, 1);
   seen_newline = false;
   seen_escape = false;
   was_popened = false;
+  is_utf8 = want_utf8_input;
+  is_at_start = true;
+  pending_code_point = -1;
   ptr = 0 /* nullptr */;
   endptr = 0 /* nullptr */;
   return true;
 }
 
+inline int file_iterator::get_byte()
+{
+  int c = getc(fp);
+  if (record != 0 /* nullptr */)
+    record->note(c);
+  return c;
+}
+
+inline void file_iterator::unget_byte(int c)
+{
+  ungetc(c, fp);
+  if (record != 0 /* nullptr */)
+    record->unget();
+}
+
 // TODO: Define a function, say, process_input_character().
 //
 // Delegate the actual work on inbounding a UTF-8 sequence from the
@@ -523,20 +595,112 @@ bool file_iterator::next_file(FILE *f, const char *s)
 // If no exception occurs, apply Normalization Form D (if gnulib
 // can't/doesn't do that), and return an std::vector<> of `char32_t`.
 
-// Returns an unsigned char or `EOF`.
-int file_iterator::fill(node **)
+// Decode the remainder of a UTF-8 sequence whose first byte is `c`,
+// returning its code point.  Like preconv(1), substitute U+FFFD for an
+// invalid or incomplete sequence.
+int file_iterator::read_code_point(int c)
+{
+  int nbytes = 0;
+  int cp = 0;
+  if ((c >= 0xC2) && (c < 0xE0)) {
+    nbytes = 1;
+    cp = c & 0x1F;
+  }
+  else if ((c >= 0xE0) && (c < 0xF0)) {
+    nbytes = 2;
+    cp = c & 0x0F;
+  }
+  else if ((c >= 0xF0) && (c < 0xF5)) {
+    nbytes = 3;
+    cp = c & 0x07;
+  }
+  else {
+    warning(WARN_INPUT, "invalid UTF-8 sequence; substituting U+FFFD");
+    return 0xFFFD;
+  }
+  for (int i = 0; i < nbytes; i++) {
+    int d = get_byte();
+    if ((EOF == d) || ((d & 0xC0) != 0x80)) {
+      if (d != EOF)
+	unget_byte(d);
+      warning(WARN_INPUT, "incomplete UTF-8 sequence; substituting"
+	      " U+FFFD");
+      return 0xFFFD;
+    }
+    cp = (cp << 6) | (d & 0x3F);
+  }
+  if (((2 == nbytes) && (cp < 0x800))
+      || ((3 == nbytes) && (cp < 0x10000))
+      || (cp > 0x10FFFF)
+      || ((cp >= 0xD800) && (cp <= 0xDFFF))) {
+    warning(WARN_INPUT, "invalid UTF-8 sequence; substituting U+FFFD");
+    return 0xFFFD;
+  }
+  return cp;
+}
+
+static node *make_code_point_node(int);
+
+// Hand a decoded non-ASCII code point to the input stack.  No-break
+// space and soft hyphen are input characters only, as with preconv(1);
+// anything else becomes a special character token without a round trip
+// through `\[uXXXX]` escape sequence parsing.  A caller that discards
+// nodes gets that escape sequence as text instead.
+int file_iterator::deliver_code_point(int cp, node **np)
+{
+  ptr = buf;
+  endptr = buf;
+  if (0xA0 == cp)
+    buf[0] = INPUT_NO_BREAK_SPACE;
+  else if (0xAD == cp)
+    buf[0] = INPUT_SOFT_HYPHEN;
+  else if (np != 0 /* nullptr */) {
+    *np = make_code_point_node(cp);
+    return 0;
+  }
+  else {
+    char *s = reinterpret_cast<char *>(buf);
+    format_code_point_escape(s, cp);
+    endptr = buf + strlen(s);
+    return *ptr++;
+  }
+  endptr = buf + 1;
+  return *ptr++;
+}
+
+// Returns an unsigned char, `EOF`, or 0 if a node is stored in `*np`.
+int file_iterator::fill(node **np)
 {
   if (seen_newline)
     lineno++;
   seen_newline = false;
+  if (pending_code_point >= 0) {
+    int cp = pending_code_point;
+    pending_code_point = -1;
+    return deliver_code_point(cp, np);
+  }
   unsigned char *p = buf;
   ptr = p;
   unsigned char *e = p + BUF_SIZE;
   while (p < e) {
     // TODO: process_input_character()
-    int c = getc(fp);
+    int c = get_byte();
     if (EOF == c)
       break;
+    if (is_utf8 && (c >= 0x80)) {
+      int cp = read_code_point(c);
+      if (is_at_start && (0xFEFF == cp)) {
+	is_at_start = false;
+	continue;
+      }
+      is_at_start = false;
+      if (p > buf) {
+	pending_code_point = cp;
+	break;
+      }
+      return deliver_code_point(cp, np);
+    }
+    is_at_start = false;
     if (is_invalid_input_char(c))
       warning(WARN_INPUT, "invalid input character code %1", c);
     else {
@@ -561,15 +725,31 @@ int file_iterator::fill(node **)
 
 int file_iterator::peek()
 {
+  if (pending_code_point >= 0)
+    return 0;
   // TODO: process_input_character()
-  int c = getc(fp);
+  int c = get_byte();
+  if (is_utf8 && (c >= 0x80)) {
+    pending_code_point = read_code_point(c);
+    if (is_at_start && (0xFEFF == pending_code_point)) {
+      pending_code_point = -1;
+      is_at_start = false;
+      return peek();
+    }
+    is_at_start = false;
+    if (0xA0 == pending_code_point)
+      return INPUT_NO_BREAK_SPACE;
+    if (0xAD == pending_code_point)
+      return INPUT_SOFT_HYPHEN;
+    return 0;
+  }
   while (is_invalid_input_char(c)) {
     warning(WARN_INPUT, "invalid input character code %1", c);
     // TODO: process_input_character()
-    c = getc(fp);
+    c = get_byte();
   }
   if (c != EOF)
-    ungetc(c, fp);
+    unget_byte(c);
   return c;
 }
 
@@ -615,7 +795,7 @@ public:
   static int peek();
   static void push(input_iterator *);
   static input_iterator *get_arg(int);
-  static arg_list *get_arg_list();
+  static arg_list *get_arg_list(int * /* first */);
   static symbol get_macro_name();
   static bool space_follows_arg(int);
   static int get_break_flag();
@@ -625,7 +805,7 @@ public:
 			   int * /* linep */);
   static bool set_location(const char *, int);
   static void backtrace();
-  static void next_file(FILE *, const char *);
+  static void next_file(FILE *, const char *, const char * /* path */);
   static void end_file();
   static void shift(int n);
   static void add_boundary();
@@ -683,6 +863,7 @@ inline int input_stack::get_div_level()
 inline int input_stack::get(node **np)
 {
   int res = (top->ptr < top->endptr) ? *top->ptr++ : finish_get(np);
+  input_byte_count++;
   if (res == '\n') {
     have_formattable_input_on_interrupted_line = have_formattable_input;
     have_formattable_input = false;
@@ -829,12 +1010,12 @@ input_iterator *input_stack::get_arg(int i)
   return 0 /* nullptr */;
 }
 
-arg_list *input_stack::get_arg_list()
+arg_list *input_stack::get_arg_list(int *first)
 {
   input_iterator *p;
   for (p = top; p != 0 /* nullptr */; p = p->next)
     if (p->has_args())
-      return p->get_arg_list();
+      return p->get_arg_list(first);
   return 0 /* nullptr */;
 }
 
@@ -901,15 +1082,16 @@ bool input_stack::set_location(const char *filename, int lineno)
   return false;
 }
 
-void input_stack::next_file(FILE *fp, const char *s)
+void input_stack::next_file(FILE *fp, const char *s, const char *path)
 {
   input_iterator **pp;
   for (pp = &top; *pp != &nil_iterator; pp = &(*pp)->next)
-    if ((*pp)->next_file(fp, s))
+    if ((*pp)->next_file(fp, s, path))
       return;
   if (++level > limit && limit > 0)
     fatal("input stack limit of %1 levels exceeded", limit);
-  *pp = new file_iterator(fp, s);
+  *pp = new file_iterator(fp, s, false /* popened */,
+			  false /* is_macro_file */, path);
   (*pp)->next = &nil_iterator;
 }
 
@@ -993,12 +1175,16 @@ void next_file()
   if (0 /* nullptr */ == filename)
     input_stack::end_file();
   else {
+    char *path;
     errno = 0;
-    FILE *fp = include_search_path.open_file_cautiously(filename);
+    FILE *fp = include_search_path.open_file_cautiously(filename,
+							 &path);
     if (0 /* nullptr */ == fp)
       error("cannot open '%1': %2", filename, strerror(errno));
-    else
-      input_stack::next_file(fp, filename);
+    else {
+      input_stack::next_file(fp, filename, path);
+      free(path);
+    }
   }
   // TODO: Add `filename` to file name set.
   tok.next();
@@ -1046,18 +1232,34 @@ static char read_character_in_escape_sequence_parameter(
   return c;
 }
 
-static symbol read_two_character_escape_sequence_parameter()
+// One- and two-character names, as in `\(xx` and `\*x`, recur on
+// nearly every input line; intern each only once, keeping it in a table
+// indexed by its characters.
+static symbol short_name(char c1, char c2 = '\0')
 {
-  char buf[3];
-  buf[0] = read_character_in_escape_sequence_parameter();
-  if (buf[0] != '\0') {
-    buf[1] = read_character_in_escape_sequence_parameter();
-    if (buf[1] == '\0')
-      buf[0] = '\0';
-    else
-      buf[2] = '\0';
+  static symbol *table = 0 /* nullptr */;
+  if (0 /* nullptr */ == table)
+    table = new symbol[256 * 256];
+  symbol &nm = table[((unsigned char) c1 << 8) | (unsigned char) c2];
+  if (nm.is_null()) {
+    char buf[3];
+    buf[0] = c1;
+    buf[1] = c2;
+    buf[2] = '\0';
+    nm = symbol(buf);
   }
-  return symbol(buf);
+  return nm;
+}
+
+static symbol read_two_character_escape_sequence_parameter()
+{
+  char c1 = read_character_in_escape_sequence_parameter();
+  if ('\0' == c1)
+    return EMPTY_SYMBOL;
+  char c2 = read_character_in_escape_sequence_parameter();
+  if ('\0' == c2)
+    return EMPTY_SYMBOL;
+  return short_name(c1, c2);
 }
 
 static symbol read_long_escape_sequence_parameters(
@@ -1131,10 +1333,7 @@ static symbol read_escape_sequence_parameter(
     return read_two_character_escape_sequence_parameter();
   if (('[' == c) && !want_att_compat)
     return read_long_escape_sequence_parameters(arity);
-  char buf[2];
-  buf[0] = c;
-  buf[1] = '\0';
-  return symbol(buf);
+  return short_name(c);
 }
 
 static symbol read_crement_and_escape_sequence_parameter(int *incp)
@@ -2069,7 +2268,8 @@ token_node *node::get_token_node()
 class token_node : public node {
 public:
   token tk;
-  token_node(const token &t);
+  int code_point;		// if read as UTF-8 input, else -1
+  token_node(const token &t, int /* cp */ = -1);
   void asciify(macro *);
   node *copy();
   token_node *get_token_node();
@@ -2079,19 +2279,25 @@ public:
   bool is_tag();
 };
 
-token_node::token_node(const token &t) : tk(t)
+token_node::token_node(const token &t, int cp) : tk(t), code_point(cp)
 {
 }
 
-void token_node::asciify(macro *)
+void token_node::asciify(macro *m)
 {
-  assert(0 == "attempting to 'asciify' a `token_node`");
+  assert(code_point >= 0
+	 || 0 == "attempting to 'asciify' a `token_node`");
+  if (code_point >= 0) {
+    char buf[CODE_POINT_ESCAPE_BUFSZ];
+    format_code_point_escape(buf, code_point);
+    m->append_str(buf);
+  }
   delete this;
 }
 
 node *token_node::copy()
 {
-  return new token_node(tk);
+  return new token_node(tk, code_point);
 }
 
 token_node *token_node::get_token_node()
@@ -2221,12 +2427,113 @@ void token::make_newline()
   type = TOKEN_NEWLINE;
 }
 
+void token::make_special_character(symbol s)
+{
+  type = TOKEN_SPECIAL_CHAR;
+  nm = s;
+}
+
+// Return the special character name selected by a Unicode code
+// sequence `gn` (as validated by `valid_unicode_code_sequence()`),
+// preferring a groff glyph name if one exists.
+static symbol unicode_special_character_name(const char *gn)
+{
+  const char *gn_decomposed = decompose_unicode(gn);
+  if (gn_decomposed != 0 /* nullptr */)
+    gn = &gn_decomposed[1];
+  const char *groff_gn = unicode_to_glyph_name(gn);
+  if (groff_gn != 0 /* nullptr */)
+    return symbol(groff_gn);
+  // ISO C++ does not permit VLAs on the stack.
+  // C++03: new char[strlen(gn) + 1 + 1]();
+  char *buf = new char[strlen(gn) + 1 + 1];
+  (void) memset(buf, 0, (strlen(gn) + 1 + 1) * sizeof(char));
+  strcpy(buf, "u");
+  strcat(buf, gn);
+  symbol nm(buf);
+  delete[] buf;
+  return nm;
+}
+
+// Map a code point read from UTF-8 input to its special character name.
+// Each name is resolved once and kept in a table indexed by code point,
+// allocated a page of 256 entries at a time as characters are seen.
+static symbol code_point_character_name(int cp)
+{
+  static const int page_size = 256;
+  static symbol *page_table[(0x10FFFF / page_size) + 1];
+  assert((cp >= 0) && (cp <= 0x10FFFF));
+  symbol *&page = page_table[cp / page_size];
+  if (0 /* nullptr */ == page)
+    page = new symbol[page_size];
+  symbol &nm = page[cp % page_size];
+  if (nm.is_null()) {
+    char hexbuf[sizeof "uFFFFFFFF"]; // See format_code_point_escape().
+    (void) snprintf(hexbuf, sizeof hexbuf, "u%04X", cp);
+    const char *gn = valid_unicode_code_sequence(hexbuf,
+						 0 /* nullptr */);
+    nm = (gn != 0 /* nullptr */) ? unicode_special_character_name(gn)
+	 : symbol(hexbuf);
+  }
+  return nm;
+}
+
+// If `nm` names a single code point in the form that
+// `code_point_character_name()` builds and preconv writes, "uXXXX" with
+// four to six uppercase hexadecimal digits and no superfluous leading
+// zero, return it; otherwise return -1.
+static int canonical_code_point(const char *nm)
+{
+  if (nm[0] != 'u')
+    return -1;
+  int cp = 0;
+  int ndigits;
+  for (ndigits = 0; nm[ndigits + 1] != '\0'; ndigits++) {
+    char c = nm[ndigits + 1];
+    if ((c >= '0') && (c <= '9'))
+      cp = (cp << 4) | (c - '0');
+    else if ((c >= 'A') && (c <= 'F'))
+      cp = (cp << 4) | (c - 'A' + 10);
+    else
+      return -1;
+    if (ndigits >= 6)
+      return -1;
+  }
+  if ((ndigits < 4) || ((ndigits > 4) && ('0' == nm[1]))
+      || (cp > 0x10FFFF))
+    return -1;
+  return cp;
+}
+
+static node *make_code_point_node(int cp)
+{
+  token t;
+  t.make_special_character(code_point_character_name(cp));
+  return new token_node(t, cp);
+}
+
+// Numeric expressions begin a term by calling `next_operand()`; an
+// interpolated register whose format is the default then reaches them
+// as an integer instead of as digits that they would have to parse.
+static bool want_register_value_token = false;
+
+void token::next_operand()
+{
+  want_register_value_token = true;
+  next();
+  want_register_value_token = false;
+}
+
 void token::next()
 {
   if (nd != 0 /* nullptr */) {
     delete nd;
     nd = 0 /* nullptr */;
   }
+  // Escape sequences like `\h` read numeric expressions, calling us
+  // recursively; only the outermost token can be a register value.
+  bool want_register_value = want_register_value_token;
+  want_register_value_token = false;
   units x;
   for (;;) {
     node *n = 0 /* nullptr */;
@@ -2669,8 +2976,16 @@ void token::next()
 	{
 	  int inc;
 	  symbol s = read_crement_and_escape_sequence_parameter(&inc);
-	  if (!(s.is_null() || s.is_empty()))
-	    interpolate_register(s, inc);
+	  if (!(s.is_null() || s.is_empty())) {
+	    if (want_register_value) {
+	      if (interpolate_register_value(s, inc, &val)) {
+		type = TOKEN_REGISTER_VALUE;
+		return;
+	      }
+	    }
+	    else
+	      interpolate_register(s, inc);
+	  }
 	  break;
 	}
       case 'N':
@@ -2844,27 +3159,18 @@ void token::next()
 	  else {
 	    const char *sc = s.contents();
 	    const char *gn = 0 /* nullptr */;
+	    // Most are single code points, which we've likely resolved
+	    // before.
+	    int cp = canonical_code_point(sc);
+	    if (cp >= 0) {
+	      nm = code_point_character_name(cp);
+	      type = TOKEN_SPECIAL_CHAR;
+	      return;
+	    }
 	    if ((strlen(sc) > 2) && (sc[0] == 'u'))
 	      gn = valid_unicode_code_sequence(sc, 0 /* nullptr */);
-	    if (gn != 0 /* nullptr */) {
-	      const char *gn_decomposed = decompose_unicode(gn);
-	      if (gn_decomposed != 0 /* nullptr */)
-		gn = &gn_decomposed[1];
-	      const char *groff_gn = unicode_to_glyph_name(gn);
-	      if (groff_gn != 0 /* nullptr */)
-		nm = symbol(groff_gn);
-	      else {
-		// ISO C++ does not permit VLAs on the stack.
-		// C++03: new char[strlen(gn) + 1 + 1]();
-		char *buf = new char[strlen(gn) + 1 + 1];
-		(void) memset(buf, 0,
-			      (strlen(gn) + 1 + 1) * sizeof(char));
-		strcpy(buf, "u");
-		strcat(buf, gn);
-		nm = symbol(buf);
-		delete[] buf;
-	      }
-	    }
+	    if (gn != 0 /* nullptr */)
+	      nm = unicode_special_character_name(gn);
 	    else
 	      nm = symbol(sc);
 	  }
@@ -3206,6 +3512,8 @@ const char *token::description()
   // TOKEN_NODE is handled above
   case TOKEN_PAGE_EJECTOR:
     return "a \"page ejector\" token";
+  case TOKEN_REGISTER_VALUE:
+    return "a \"register value\" token";
   case TOKEN_REQUEST:
     return "a \"request\" token";
   default:
@@ -3682,8 +3990,18 @@ void process_input_stack()
 	      if (cc != EOF) {
 		if (cc != '\0')
 		  curdiv->transparent_output(transparent_translate(cc));
-		else
-		  curdiv->transparent_output(n);
+		else {
+		  token_node *tn = n->get_token_node();
+		  if ((tn != 0 /* nullptr */) && (tn->code_point >= 0)) {
+		    char buf[CODE_POINT_ESCAPE_BUFSZ];
+		    format_code_point_escape(buf, tn->code_point);
+		    for (const char *p = buf; *p != '\0'; p++)
+		      curdiv->transparent_output(*p);
+		    delete n;
+		  }
+		  else
+		    curdiv->transparent_output(n);
+		}
 	      }
 	    } while (cc != '\n' && cc != EOF);
 	    if (EOF == cc)
@@ -3900,22 +4218,27 @@ request::request(REQUEST_FUNCP pp) : p(pp)
 {
 }
 
-void request::invoke(symbol, bool)
+void request::invoke(symbol nm, bool)
 {
-  (*p)();
+  if (want_profile) {
+    unsigned long call = profile_enter(nm, true /* is request */);
+    (*p)();
+    profile_leave(call);
+  }
+  else
+    (*p)();
 }
 
 struct char_block {
   enum { SIZE = 128 };
   unsigned char s[SIZE];
-  char_block *next;
-  char_block();
 };
 
-char_block::char_block()
-: next(0 /* nullptr */)
-{
-}
+// Macro and string contents are stored in fixed-size blocks reached
+// through an index array, so that any offset can be accessed in
+// constant time.  Blocks never move once allocated; string_iterator
+// relies on this while a macro is extended during its own
+// interpolation.
 
 // TODO: grochar
 class char_list {
@@ -3923,31 +4246,31 @@ public:
   char_list();
   ~char_list();
   void append(unsigned char);
+  void append(const unsigned char *, int);
   void set(unsigned char, int);
   unsigned char get(int);
   int get_length();
+  void truncate(int);
 private:
-  unsigned char *ptr;
   int length;
-  char_block *head;
-  char_block *tail;
+  int nblocks;			// allocated
+  int blocks_size;		// capacity of `blocks`
+  char_block **blocks;
+  void add_block();
   friend class macro_header;
   friend class string_iterator;
 };
 
 char_list::char_list()
-: ptr(0 /* nullptr */), length(0), head(0 /* nullptr */),
-  tail(0 /* nullptr */)
+: length(0), nblocks(0), blocks_size(0), blocks(0 /* nullptr */)
 {
 }
 
 char_list::~char_list()
 {
-  while (head != 0) {
-    char_block *tem = head;
-    head = head->next;
-    delete tem;
-  }
+  for (int i = 0; i < nblocks; i++)
+    delete blocks[i];
+  delete[] blocks;
 }
 
 int char_list::get_length()
@@ -3955,59 +4278,61 @@ int char_list::get_length()
   return length;
 }
 
-void char_list::append(unsigned char c)
+void char_list::add_block()
 {
-  if (tail == 0) {
-    head = tail = new char_block;
-    ptr = tail->s;
-  }
-  else {
-    if (ptr >= tail->s + char_block::SIZE) {
-      tail->next = new char_block;
-      tail = tail->next;
-      ptr = tail->s;
-    }
+  allocation_scope scope(ALLOCATION_MACRO);
+  if (nblocks >= blocks_size) {
+    char_block **old_blocks = blocks;
+    blocks_size = (0 == blocks_size) ? 4 : blocks_size * 2;
+    blocks = new char_block *[blocks_size];
+    for (int i = 0; i < nblocks; i++)
+      blocks[i] = old_blocks[i];
+    delete[] old_blocks;
   }
-  *ptr++ = c;
+  blocks[nblocks++] = new char_block;
+}
+
+void char_list::append(unsigned char c)
+{
+  if (length >= nblocks * char_block::SIZE)
+    add_block();
+  blocks[length / char_block::SIZE]->s[length % char_block::SIZE] = c;
   length++;
 }
 
+void char_list::append(const unsigned char *s, int n)
+{
+  while (n > 0) {
+    if (length >= nblocks * char_block::SIZE)
+      add_block();
+    int offset = length % char_block::SIZE;
+    int chunk = char_block::SIZE - offset;
+    if (chunk > n)
+      chunk = n;
+    memcpy(blocks[length / char_block::SIZE]->s + offset, s, chunk);
+    s += chunk;
+    n -= chunk;
+    length += chunk;
+  }
+}
+
 void char_list::set(unsigned char c, int offset)
 {
   assert(length > offset);
-  // optimization for access at the end
-  int boundary = length - (length % char_block::SIZE);
-  if (offset >= boundary) {
-    *(tail->s + offset - boundary) = c;
-    return;
-  }
-  char_block *tem = head;
-  int l = 0;
-  for (;;) {
-    l += char_block::SIZE;
-    if (l > offset) {
-      *(tem->s + offset % char_block::SIZE) = c;
-      return;
-    }
-    tem = tem->next;
-  }
+  blocks[offset / char_block::SIZE]->s[offset % char_block::SIZE] = c;
 }
 
 unsigned char char_list::get(int offset)
 {
   assert(length > offset);
-  // optimization for access at the end
-  int boundary = length - (length % char_block::SIZE);
-  if (offset >= boundary)
-    return *(tail->s + offset - boundary);
-  char_block *tem = head;
-  int l = 0;
-  for (;;) {
-    l += char_block::SIZE;
-    if (l > offset)
-      return *(tem->s + offset % char_block::SIZE);
-    tem = tem->next;
-  }
+  return blocks[offset / char_block::SIZE]->s[offset % char_block::SIZE];
+}
+
+// Discard everything from `n` on; the blocks are kept for reuse.
+void char_list::truncate(int n)
+{
+  assert(n <= length);
+  length = n;
 }
 
 class node_list {
@@ -4018,6 +4343,7 @@ public:
   ~node_list();
   void append(node *);
   int get_length();
+  void truncate(int);
 
   friend class macro_header;
   friend class string_iterator;
@@ -4043,6 +4369,22 @@ int node_list::get_length()
   return total;
 }
 
+// Keep the first `n` nodes and delete the rest.
+void node_list::truncate(int n)
+{
+  if (0 == n) {
+    delete_node_list(head);
+    head = tail = 0 /* nullptr */;
+    return;
+  }
+  node *last = head;
+  while (--n > 0)
+    last = last->next;
+  delete_node_list(last->next);
+  last->next = 0 /* nullptr */;
+  tail = last;
+}
+
 node_list::node_list()
 {
   head = tail = 0 /* nullptr */;
@@ -4060,6 +4402,7 @@ public:
   node_list nl;
   macro_header() { count = 1; }
   macro_header *copy(int);
+  bool truncate(int);
   void json_dump_macro();
   void json_dump_diversion();
 };
@@ -4139,17 +4482,25 @@ macro &macro::operator=(const macro &m)
   return *this;
 }
 
-void macro::append(unsigned char c)
+// Make the header ready to take appended contents.  If `chop` left
+// bytes past our length, drop them, copying the header if necessary.
+
+void macro::prepare_to_append()
 {
-  assert(c != 0);
   if (p == 0 /* nullptr */)
     p = new macro_header;
-  if (p->cl.get_length() != length) {
+  if (p->cl.get_length() != length && !p->truncate(length)) {
     macro_header *tem = p->copy(length);
     if (--(p->count) <= 0)
       delete p;
     p = tem;
   }
+}
+
+void macro::append(unsigned char c)
+{
+  assert(c != 0);
+  prepare_to_append();
   p->cl.append(c);
   ++length;
   if (c != PUSH_GROFF_MODE && c != PUSH_COMP_MODE && c != POP_GROFFCOMP_MODE)
@@ -4176,27 +4527,24 @@ int macro::get_length()
 
 void macro::append_str(const char *s)
 {
-  int i = 0;
-
-  if (s != 0 /* nullptr */) {
-    while (s[i] != '\0') {
-      append(s[i]);
-      i++;
-    }
+  if (0 /* nullptr */ == s || '\0' == *s)
+    return;
+  prepare_to_append();
+  int n = 0;
+  for (; s[n] != '\0'; n++) {
+    unsigned char c = s[n];
+    if (c != PUSH_GROFF_MODE && c != PUSH_COMP_MODE
+	&& c != POP_GROFFCOMP_MODE)
+      is_empty_macro = false;
   }
+  p->cl.append(reinterpret_cast<const unsigned char *>(s), n);
+  length += n;
 }
 
 void macro::append(node *n)
 {
   assert(n != 0 /* nullptr */);
-  if (p == 0 /* nullptr */)
-    p = new macro_header;
-  if (p->cl.get_length() != length) {
-    macro_header *tem = p->copy(length);
-    if (--(p->count) <= 0)
-      delete p;
-    p = tem;
-  }
+  prepare_to_append();
   p->cl.append(0U); // TODO: grochar
   p->nl.append(n);
   ++length;
@@ -4240,10 +4588,14 @@ void macro::chop()
   }
   assert(length != 0);
   // TODO: If it's empty, do nothing, quietly?
+  // Drop the last content byte first, so that any node it marks goes
+  // with it, and then put the mode-restoring token back after it.
+  length -= 1;
   if (contains_mode_tokens)
-    set(POP_GROFFCOMP_MODE, length - 1);
-  else
-    length -= 1;
+    append(POP_GROFFCOMP_MODE);
+  // Release the chopped bytes now, while we are likely to be the only
+  // user of the header, so that a later append needn't copy it.
+  (void) p->truncate(length);
 }
 
 void macro::print_size()
@@ -4290,24 +4642,39 @@ void macro::json_dump()
 macro_header *macro_header::copy(int n)
 {
   macro_header *p = new macro_header;
-  char_block *bp = cl.head;
-  unsigned char *ptr = bp->s;
   node *nd = nl.head;
-  while (--n >= 0) {
-    if (ptr >= bp->s + char_block::SIZE) {
-      bp = bp->next;
-      ptr = bp->s;
-    }
-    unsigned char c = *ptr++;
-    p->cl.append(c);
-    if (0U == c) {
-      p->nl.append(nd->copy());
-      nd = nd->next;
-    }
+  for (int i = 0; n > 0; i++) {
+    const unsigned char *s = cl.blocks[i]->s;
+    int chunk = (n < char_block::SIZE) ? n : char_block::SIZE;
+    p->cl.append(s, chunk);
+    for (int j = 0; j < chunk; j++)
+      if (0U == s[j]) {
+	p->nl.append(nd->copy());
+	nd = nd->next;
+      }
+    n -= chunk;
   }
   return p;
 }
 
+// Shorten to the first n bytes in place, which is possible only if
+// nothing else shares this header.
+
+bool macro_header::truncate(int n)
+{
+  if (count != 1)
+    return false;
+  int len = cl.get_length();
+  int discarded_nodes = 0;
+  for (int i = n; i < len; i++)
+    if (0U == cl.get(i))
+      discarded_nodes++;
+  if (discarded_nodes > 0)
+    nl.truncate(nl.get_length() - discarded_nodes);
+  cl.truncate(n);
+  return true;
+}
+
 extern void dump_node_list(node *);
 
 void macro_header::json_dump_diversion()
@@ -4378,9 +4745,12 @@ class string_iterator : public input_iterator {
   const char *how_invoked;
   bool seen_newline;
   int lineno;
-  char_block *bp;
+  int block_index;		// into mac.p->cl.blocks
+  const unsigned char *pos;	// next byte of mac to read
   int count;			// of characters remaining
   node *nd;
+  // a code point node spelled out for a reader that discards nodes
+  unsigned char code_point_buf[CODE_POINT_ESCAPE_BUFSZ];
   bool att_compat;
   bool with_break;		// inherited from the caller
 protected:
@@ -4407,23 +4777,23 @@ string_iterator::string_iterator(const macro &m, const char *p,
 {
   count = mac.length;
   if (count != 0) {
-    bp = mac.p->cl.head;
+    block_index = 0;
     nd = mac.p->nl.head;
-    ptr = endptr = bp->s;
+    ptr = endptr = pos = mac.p->cl.blocks[0]->s;
   }
   else {
-    bp = 0 /* nullptr */;
+    block_index = 0;
     nd = 0 /* nullptr */;
-    ptr = endptr = 0 /* nullptr */;
+    ptr = endptr = pos = 0 /* nullptr */;
   }
   with_break = input_stack::get_break_flag();
 }
 
 string_iterator::string_iterator()
 {
-  bp = 0 /* nullptr */;
+  block_index = 0;
   nd = 0 /* nullptr */;
-  ptr = endptr = 0 /* nullptr */;
+  ptr = endptr = pos = 0 /* nullptr */;
   seen_newline = false;
   how_invoked = 0 /* nullptr */;
   lineno = 1;
@@ -4444,25 +4814,39 @@ int string_iterator::fill(node **np)
   seen_newline = false;
   if (count <= 0)
     return EOF;
-  const unsigned char *p = endptr;
-  if (p >= bp->s + char_block::SIZE) {
-    bp = bp->next;
-    p = bp->s;
+  const unsigned char *p = pos;
+  const unsigned char *s = mac.p->cl.blocks[block_index]->s;
+  if (p >= s + char_block::SIZE) {
+    s = mac.p->cl.blocks[++block_index]->s;
+    p = s;
   }
   if (*p == '\0') {
+    node *n = nd;
+    nd = nd->next;
+    endptr = ptr = pos = p + 1;
+    count--;
     if (np != 0 /* nullptr */) {
-      *np = nd->copy();
+      *np = n->copy();
       if (is_diversion())
 	(*np)->div_nest_level = input_stack::get_div_level();
       else
 	(*np)->div_nest_level = 0;
     }
-    nd = nd->next;
-    endptr = ptr = p + 1;
-    count--;
+    else {
+      // Like file_iterator::deliver_code_point(), spell out a
+      // character decoded from UTF-8 input rather than losing it.
+      token_node *tn = n->get_token_node();
+      if ((tn != 0 /* nullptr */) && (tn->code_point >= 0)) {
+	char *b = reinterpret_cast<char *>(code_point_buf);
+	format_code_point_escape(b, tn->code_point);
+	ptr = code_point_buf;
+	endptr = code_point_buf + strlen(b);
+	return *ptr++;
+      }
+    }
     return 0U;
   }
-  const unsigned char *e = bp->s + char_block::SIZE;
+  const unsigned char *e = s + char_block::SIZE;
   if (e - p > count)
     e = p + count;
   ptr = p;
@@ -4477,7 +4861,7 @@ int string_iterator::fill(node **np)
       break;
     p++;
   }
-  endptr = p;
+  endptr = pos = p;
   count -= p - ptr;
   return *ptr++;
 }
@@ -4486,10 +4870,9 @@ int string_iterator::peek()
 {
   if (count <= 0)
     return EOF;
-  const unsigned char *p = endptr;
-  if (p >= bp->s + char_block::SIZE) {
-    p = bp->next->s;
-  }
+  const unsigned char *p = pos;
+  if (p >= mac.p->cl.blocks[block_index]->s + char_block::SIZE)
+    p = mac.p->cl.blocks[block_index + 1]->s;
   return *p;
 }
 
@@ -4559,43 +4942,71 @@ input_iterator *make_temp_iterator(const char *s)
 }
 
 // this is used when macros with arguments are interpolated
+//
+// The arguments are kept in an array that a macro call shares with
+// any macro interpolated as a string from within it.  Each
+// macro_iterator looks at its own window of the array, so that looking
+// up an argument and shifting are constant-time operations.
 
-struct arg_list {
+struct macro_arg {
   macro mac;
   bool space_follows;
-  arg_list *next;
-  arg_list(const macro &, bool);
-  arg_list(const arg_list *);
+};
+
+struct arg_list {
+  int count;			// of references
+  int nargs;
+  int size;			// capacity of `args`
+  macro_arg *args;
+  arg_list();
   ~arg_list();
+  void append(const macro &, bool);
+  arg_list *copy(int, int);
 };
 
-arg_list::arg_list(const macro &m, bool b)
-: mac(m), space_follows(b), next(0 /* nullptr */)
+arg_list::arg_list()
+: count(1), nargs(0), size(0), args(0 /* nullptr */)
 {
 }
 
-arg_list::arg_list(const arg_list *al)
-: next(0 /* nullptr */)
+arg_list::~arg_list()
 {
-  mac = al->mac;
-  space_follows = al->space_follows;
-  arg_list **a = &next;
-  arg_list *p = al->next;
-  while (p != 0 /* nullptr */) {
-    *a = new arg_list(p->mac, p->space_follows);
-    p = p->next;
-    a = &(*a)->next;
+  delete[] args;
+}
+
+void arg_list::append(const macro &m, bool b)
+{
+  allocation_scope scope(ALLOCATION_MACRO);
+  if (nargs >= size) {
+    macro_arg *old_args = args;
+    size = (0 == size) ? 8 : size * 2;
+    args = new macro_arg[size];
+    for (int i = 0; i < nargs; i++)
+      args[i] = old_args[i];
+    delete[] old_args;
   }
+  args[nargs].mac = m;
+  args[nargs].space_follows = b;
+  nargs++;
 }
 
-arg_list::~arg_list()
+// Copy `n` arguments starting at index `first`.  The contents of each
+// argument are shared, not duplicated.
+
+arg_list *arg_list::copy(int first, int n)
 {
+  arg_list *al = new arg_list;
+  for (int i = first; i < first + n; i++)
+    al->append(args[i].mac, args[i].space_follows);
+  return al;
 }
 
 class macro_iterator : public string_iterator {
   arg_list *args;
+  int first_arg;		// index into `args->args` of \$1
   int argc;
   bool with_break;		// whether called as .foo or 'foo
+  unsigned long profile_call;	// see profile.h
 public:
   macro_iterator(symbol, macro &,
 		 const char * /* how_called */ = "macro",
@@ -4604,7 +5015,7 @@ public:
   ~macro_iterator();
   bool has_args() { return true; }
   input_iterator *get_arg(int);
-  arg_list *get_arg_list();
+  arg_list *get_arg_list(int *);
   symbol get_macro_name();
   bool space_follows_arg(int);
   bool get_break_flag() { return with_break; }
@@ -4613,26 +5024,22 @@ public:
   void shift(int);
   bool is_macro() { return true; }
   bool is_diversion();
+  void start_profile_call(symbol);
 };
 
 input_iterator *macro_iterator::get_arg(int i)
 {
   if (i == 0)
     return make_temp_iterator(nm.contents());
-  if (i > 0 && i <= argc) {
-    arg_list *p = args;
-    for (int j = 1; j < i; j++) {
-      assert(p != 0);
-      p = p->next;
-    }
-    return new string_iterator(p->mac);
-  }
+  if (i > 0 && i <= argc)
+    return new string_iterator(args->args[first_arg + i - 1].mac);
   else
     return 0 /* nullptr */;
 }
 
-arg_list *macro_iterator::get_arg_list()
+arg_list *macro_iterator::get_arg_list(int *first)
 {
+  *first = first_arg;
   return args;
 }
 
@@ -4643,35 +5050,34 @@ symbol macro_iterator::get_macro_name()
 
 bool macro_iterator::space_follows_arg(int i)
 {
-  if ((i > 0) && (i <= argc)) {
-    arg_list *p = args;
-    for (int j = 1; j < i; j++) {
-      assert(p != 0 /* nullptr */);
-      p = p->next;
-    }
-    return p->space_follows;
-  }
+  if ((i > 0) && (i <= argc))
+    return args->args[first_arg + i - 1].space_follows;
   else
     return false;
 }
 
 void macro_iterator::add_arg(const macro &m, int s)
 {
-  arg_list **p;
-  for (p = &args; *p != 0 /* nullptr */; p = &((*p)->next))
-    ;
-  *p = new arg_list(m, s);
+  if (0 /* nullptr */ == args)
+    args = new arg_list;
+  else if (args->count > 1 || first_arg + argc != args->nargs) {
+    arg_list *tem = args->copy(first_arg, argc);
+    if (--(args->count) <= 0)
+      delete args;
+    args = tem;
+    first_arg = 0;
+  }
+  args->append(m, s);
   ++argc;
 }
 
 void macro_iterator::shift(int n)
 {
-  while (n > 0 && argc > 0) {
-    arg_list *tem = args;
-    args = args->next;
-    delete tem;
-    --argc;
-    --n;
+  if (n > argc)
+    n = argc;
+  if (n > 0) {
+    first_arg += n;
+    argc -= n;
   }
 }
 
@@ -4860,6 +5266,7 @@ void macro::invoke(symbol nm, bool do_not_want_next_token)
 {
   macro_iterator *mi = new macro_iterator(nm, *this);
   decode_macro_call_arguments(mi);
+  mi->start_profile_call(nm);
   input_stack::push(mi);
   // we must delay tok.next() in case the function has been called by
   // do_request to assure proper handling of want_att_compat
@@ -4880,31 +5287,40 @@ bool macro::is_empty()
 macro_iterator::macro_iterator(symbol s, macro &m,
 			       const char *how_called,
 			       bool want_arguments_initialized)
-: string_iterator(m, how_called, s), args(0 /* nullptr */), argc(0),
-  with_break(was_invoked_with_regular_control_character)
+: string_iterator(m, how_called, s), args(0 /* nullptr */),
+  first_arg(0), argc(0),
+  with_break(was_invoked_with_regular_control_character),
+  profile_call(0)
 {
   if (want_arguments_initialized) {
-    arg_list *al = input_stack::get_arg_list();
+    arg_list *al = input_stack::get_arg_list(&first_arg);
     if (al != 0 /* nullptr */) {
-      args = new arg_list(al);
+      args = al;
+      args->count++;
       argc = input_stack::nargs();
     }
   }
 }
 
 macro_iterator::macro_iterator()
-: args(0 /* nullptr */), argc(0),
-  with_break(was_invoked_with_regular_control_character)
+: args(0 /* nullptr */), first_arg(0), argc(0),
+  with_break(was_invoked_with_regular_control_character),
+  profile_call(0)
 {
 }
 
+void macro_iterator::start_profile_call(symbol s)
+{
+  if (want_profile)
+    profile_call = profile_enter(s, false /* is request */);
+}
+
 macro_iterator::~macro_iterator()
 {
-  while (args != 0 /* nullptr */) {
-    arg_list *tem = args;
-    args = args->next;
-    delete tem;
-  }
+  if (profile_call != 0)
+    profile_leave(profile_call);
+  if (args != 0 /* nullptr */ && --(args->count) <= 0)
+    delete args;
 }
 
 dictionary composite_dictionary(17);
@@ -5049,8 +5465,12 @@ void spring_trap(symbol nm)
   // because a request name might be replaced by a macro by the time the
   // trap springs.
   macro *m = p->to_macro();
-  if (m != 0 /* nullptr */)
-    input_stack::push(new macro_iterator(nm, *m, "trap-called macro"));
+  if (m != 0 /* nullptr */) {
+    macro_iterator *mi = new macro_iterator(nm, *m,
+					    "trap-called macro");
+    mi->start_profile_call(nm);
+    input_stack::push(mi);
+  }
   else
     error("trap failed to spring: '%1' is a request", nm.contents());
   input_stack::push(make_temp_iterator(buf));
@@ -5075,6 +5495,7 @@ bool unpostpone_traps()
 
 void read_from_terminal_request() // .rd
 {
+  note_unrepeatable_input();
   macro_iterator *mi = new macro_iterator;
   bool is_reading_from_terminal = bool(isatty(fileno(stdin)));
   bool had_prompt = false;
@@ -5279,6 +5700,7 @@ void define_character(char_mode mode, const char *font_name)
   m = ci->set_macro(m, mode);
   if (m != 0 /* nullptr */)
     delete m;
+  invalidate_glyph_fallbacks();
   tok.next();
 }
 
@@ -5363,6 +5785,7 @@ static void remove_character()
 	  macro *m = ci->set_macro(0 /* nullptr */);
 	  if (m != 0 /* nullptr */)
 	    delete m;
+	  invalidate_glyph_fallbacks();
 	}
       }
       else {
@@ -5391,6 +5814,7 @@ static void interpolate_string(symbol nm)
       // if a macro is called as a string, \$0 doesn't get changed
       macro_iterator *mi = new macro_iterator(input_stack::get_macro_name(),
 					      *m, "string", 1);
+      mi->start_profile_call(nm);
       input_stack::push(mi);
     }
   }
@@ -6111,6 +6535,7 @@ void unformat_macro()
 static void interpolate_environment_variable(symbol nm)
 {
   const char *s = getenv(nm.contents());
+  note_environment_lookup(nm.contents());
   if ((s != 0 /* nullptr */) && (*s != '\0'))
     input_stack::push(make_temp_iterator(s));
 }
@@ -6126,6 +6551,27 @@ void interpolate_register(symbol nm, int inc)
   input_stack::push(make_temp_iterator(r->get_string()));
 }
 
+// As interpolate_register(), but if the register's interpolation is
+// the decimal representation of an integer, store the integer in
+// `*valp` and return true instead of pushing its digits onto the input
+// stack.
+
+static bool interpolate_register_value(symbol nm, int inc, units *valp)
+{
+  reg *r = look_up_register(nm);
+  assert(r != 0 /* nullptr */);
+  if (inc < 0)
+    r->decrement();
+  else if (inc > 0)
+    r->increment();
+  // The most negative integer doesn't survive negation, which numeric
+  // expressions apply to the magnitude of a term; let them parse it.
+  if (r->get_decimal_value(valp) && (*valp != INT_MIN))
+    return true;
+  input_stack::push(make_temp_iterator(r->get_string()));
+  return false;
+}
+
 static void interpolate_number_format(symbol nm)
 {
   reg *r = static_cast<reg *>(register_dictionary.lookup(nm));
@@ -7573,10 +8019,15 @@ static void while_continue_request()
 void do_source(bool quietly)
 {
   char *filename = read_rest_of_line_as_argument();
+  char *path;
   errno = 0;
-  FILE *fp = include_search_path.open_file_cautiously(filename);
-  if (fp != 0 /* nullptr */)
-    input_stack::push(new file_iterator(fp, filename));
+  FILE *fp = include_search_path.open_file_cautiously(filename, &path);
+  if (fp != 0 /* nullptr */) {
+    input_stack::push(new file_iterator(fp, filename,
+					false /* popened */,
+					false /* is_macro_file */, path));
+    free(path);
+  }
   else
     // Suppress diagnostic only if we're operating quietly and it's an
     // expected problem.
@@ -7724,7 +8175,12 @@ filename(fname), llx(0), lly(0), urx(0), ury(0), lastc(EOF)
   // PS files might contain non-printable characters, such as ^Z
   // and CRs not followed by an LF, so open them in binary mode.
   //
-  fp = include_search_path.open_file_cautiously(filename, 0, FOPEN_RB);
+  char *path = 0 /* nullptr */;
+  fp = include_search_path.open_file_cautiously(filename, &path,
+						FOPEN_RB);
+  // The bounding box must be found again if the file changes.
+  note_input_file_contents(path);
+  free(path);
   if (fp != 0 /* nullptr */) {
     // After successfully opening the file, acquire the first
     // line, whence we may determine the file format...
@@ -8410,6 +8866,7 @@ static void open_file(bool appending)
     char *filename = read_rest_of_line_as_argument();
     if (filename != 0 /* nullptr */) {
       const char *mode = appending ? "appending" : "writing";
+      note_unrepeatable_input();
       errno = 0;
       FILE *fp = fopen(filename, appending ? "a" : "w");
       if (0 /* nullptr */ == fp) {
@@ -8973,6 +9430,7 @@ static void define_class_request() // .class
   // file:line location of its definition.
   macro *m = new macro;
   (void) ci->set_macro(m);
+  invalidate_glyph_fallbacks();
   charinfo *child1 = 0 /* nullptr */, *child2 = 0 /* nullptr */;
   bool just_chained_a_range_expression = false;
   while (!tok.is_terminator()) {
@@ -9430,6 +9888,12 @@ const char *readonly_register::get_string()
   return i_to_a(*p);
 }
 
+bool readonly_register::get_decimal_value(units *d)
+{
+  *d = *p;
+  return true;
+}
+
 readonly_boolean_register::readonly_boolean_register(bool *q): p(q)
 {
 }
@@ -9439,6 +9903,12 @@ const char *readonly_boolean_register::get_string()
   return i_to_a(*p);
 }
 
+bool readonly_boolean_register::get_decimal_value(units *d)
+{
+  *d = *p;
+  return true;
+}
+
 class readonly_mask_register : public reg {
   unsigned int *mask;
 public:
@@ -9562,6 +10032,7 @@ void pipe_output()
   else
     pipe_command = pc;
   delete[] pc;
+  note_unrepeatable_input();
   tok.next();
 }
 
@@ -9586,8 +10057,10 @@ void system_request()
   assert(command != 0 /* nullptr */);
   if (0 /* nullptr */ == command)
     error("cannot apply system request to empty command");
-  else
+  else {
+    note_unrepeatable_input();
     system_status = system(command);
+  }
   delete[] command;
   // XXX: Why not `skip_line()`?
   tok.next();
@@ -9613,6 +10086,7 @@ static void unsafe_transparent_throughput_file_request()
   char *filename = read_rest_of_line_as_argument();
   if (was_invoked_with_regular_control_character)
     curenv->do_break();
+  note_unrepeatable_input();
   if (filename != 0 /* nullptr */)
     curdiv->copy_file(filename);
   // TODO: Add `filename` to file name set.
@@ -9657,6 +10131,7 @@ static void transparent_throughput_file_request()
   char *filename = read_rest_of_line_as_argument();
   if (was_invoked_with_regular_control_character)
     curenv->do_break();
+  note_unrepeatable_input();
   if (filename != 0 /* nullptr */) {
     errno = 0;
     FILE *fp = include_search_path.open_file_cautiously(filename);
@@ -9808,7 +10283,8 @@ static void process_macro_package_argument(const char *mac)
 	  " '%1': %2", mac, strerror(errno));
   const char *s = symbol(path).contents();
   free(path);
-  input_stack::push(new file_iterator(fp, s));
+  input_stack::push(new file_iterator(fp, s, false /* popened */,
+				      true /* is_macro_file */));
   tok.next();
   process_input_stack();
 }
@@ -9820,7 +10296,9 @@ static void process_startup_file(const char *filename)
   mac_path = &config_macro_path;
   FILE *fp = mac_path->open_file(filename, &path);
   if (fp != 0 /* nullptr */) {
-    input_stack::push(new file_iterator(fp, symbol(path).contents()));
+    input_stack::push(new file_iterator(fp, symbol(path).contents(),
+					false /* popened */,
+					true /* is_macro_file */));
     free(path);
     tok.next();
     process_input_stack();
@@ -9837,7 +10315,9 @@ void do_macro_source(bool quietly)
   char *path;
   FILE *fp = mac_path->open_file(macro_filename, &path);
   if (fp != 0 /* nullptr */) {
-    input_stack::push(new file_iterator(fp, macro_filename));
+    input_stack::push(new file_iterator(fp, macro_filename,
+					false /* popened */,
+					true /* is_macro_file */, path));
     free(path);
   }
   else
@@ -9877,21 +10357,250 @@ void macro_source_quietly_request() // .msoquiet
 static void process_input_file(const char *name)
 {
   FILE *fp;
+  char *path = 0 /* nullptr */;
   if (strcmp(name, "-") == 0) {
     clearerr(stdin);
     fp = stdin;
   }
   else {
     errno = 0;
-    fp = include_search_path.open_file_cautiously(name);
+    fp = include_search_path.open_file_cautiously(name, &path);
     if (0 /* nullptr */ == fp)
       fatal("cannot open '%1': %2", name, strerror(errno));
   }
-  input_stack::push(new file_iterator(fp, name));
+  input_stack::push(new file_iterator(fp, name, false /* popened */,
+				      false /* is_macro_file */, path));
+  free(path);
   tok.next();
   process_input_stack();
 }
 
+// Batch mode: after reading the start-up files and macro packages,
+// format each document listed in a manifest file in a child process
+// of its own, so that the cost of initialization is paid only once.
+// Each child starts from a copy of the initialized formatter.
+
+struct batch_job {
+  const char *input;
+  const char *output;
+  int lineno;
+  pid_t pid;
+  batch_job *next;
+};
+
+static const char *batch_manifest = 0 /* nullptr */;
+static int batch_job_limit = 1;
+
+// Store in `*field` the next field of the manifest line `*pp`, and
+// advance it; return false if there is none.
+
+static bool get_manifest_field(char **pp, const char **field)
+{
+  char *p = *pp;
+  while (' ' == *p || '\t' == *p)
+    p++;
+  if ('\0' == *p)
+    return false;
+  *field = p;
+  while (*p != '\0' && *p != ' ' && *p != '\t')
+    p++;
+  if (*p != '\0')
+    *p++ = '\0';
+  *pp = p;
+  return true;
+}
+
+// Each line of a manifest names an input file and the file to which
+// to write its output, separated by spaces or tabs.  Blank lines and
+// those starting with `#` are ignored.
+//
+// Read the next entry from the manifest `fp`, named `filename`, whose
+// lines read so far are counted in `*linenop`; return false at the end
+// of the manifest.  The file names stored in `*inputp` and `*outputp`
+// are never freed.
+
+static bool read_manifest_entry(FILE *fp, const char *filename,
+				int *linenop, const char **inputp,
+				const char **outputp)
+{
+  string line;
+  int c;
+  do {
+    c = getc(fp);
+    if (c != EOF && c != '\n') {
+      line += char(c);
+      continue;
+    }
+    if (EOF == c && 0 == line.length())
+      break;
+    (*linenop)++;
+    char *p = line.extract();
+    char *q = p;
+    const char *input, *output, *extra;
+    if (!get_manifest_field(&q, &input) || '#' == *input)
+      free(p);
+    else if (!get_manifest_field(&q, &output)) {
+      error_with_file_and_line(filename, *linenop, "no output file name"
+			       " for input file '%1'", input);
+      free(p);
+    }
+    else {
+      if (get_manifest_field(&q, &extra))
+	error_with_file_and_line(filename, *linenop, "ignoring extra"
+				 " field '%1' in manifest", extra);
+      *inputp = input;
+      *outputp = output;
+      return true;
+    }
+    line.clear();
+  } while (c != EOF);
+  return false;
+}
+
+static batch_job *read_batch_manifest(const char *filename)
+{
+  errno = 0;
+  FILE *fp = fopen(filename, "r");
+  if (0 /* nullptr */ == fp)
+    fatal("cannot open batch manifest file '%1': %2", filename,
+	  strerror(errno));
+  batch_job *jobs = 0 /* nullptr */;
+  batch_job **tail = &jobs;
+  int lineno = 0;
+  const char *input, *output;
+  while (read_manifest_entry(fp, filename, &lineno, &input, &output)) {
+    batch_job *j = new batch_job;
+    j->input = input;
+    j->output = output;
+    j->lineno = lineno;
+    j->pid = -1;
+    j->next = 0 /* nullptr */;
+    *tail = j;
+    tail = &j->next;
+  }
+  fclose(fp);
+  return jobs;
+}
+
+#if MAY_FORK_BATCH_JOBS
+static void run_batch_job(batch_job *j)
+{
+  errno = 0;
+  if (0 /* nullptr */ == freopen(j->output, "w", stdout))
+    fatal("cannot open batch output file '%1': %2", j->output,
+	  strerror(errno));
+  process_input_file(j->input);
+  exit_troff();
+}
+
+// Wait for a batch job to finish; return false if it failed.
+
+static bool reap_batch_job(batch_job *jobs)
+{
+  int status;
+  pid_t pid = wait(&status);
+  if (pid < 0)
+    fatal("cannot wait for batch job: %1", strerror(errno));
+  batch_job *j;
+  for (j = jobs; j != 0 /* nullptr */; j = j->next)
+    if (j->pid == pid)
+      break;
+  if (0 /* nullptr */ == j)
+    return true;
+  if (WIFEXITED(status) && (EXIT_SUCCESS == WEXITSTATUS(status)))
+    return true;
+  error_with_file_and_line(batch_manifest, j->lineno, "formatting of"
+			   " '%1' into '%2' failed", j->input, j->output);
+  return false;
+}
+#endif /* MAY_FORK_BATCH_JOBS */
+
+static void run_batch()
+{
+#if MAY_FORK_BATCH_JOBS
+  batch_job *jobs = read_batch_manifest(batch_manifest);
+  // Documents can't share anything already written.
+  if (the_output != 0 /* nullptr */)
+    fatal("cannot run batch; start-up files or macro packages produced"
+	  " output");
+  bool has_failure = false;
+  int nrunning = 0;
+  for (batch_job *j = jobs; j != 0 /* nullptr */; j = j->next) {
+    if (nrunning >= batch_job_limit) {
+      if (!reap_batch_job(jobs))
+	has_failure = true;
+      nrunning--;
+    }
+    // Don't let children inherit buffered output.
+    fflush(stdout);
+    fflush(stderr);
+    j->pid = fork();
+    if (j->pid < 0)
+      fatal("cannot fork batch job: %1", strerror(errno));
+    if (0 == j->pid)
+      run_batch_job(j);
+    nrunning++;
+  }
+  for (; nrunning > 0; nrunning--)
+    if (!reap_batch_job(jobs))
+      has_failure = true;
+  exit(has_failure ? EXIT_FAILURE : EXIT_SUCCESS);
+#else
+  fatal("batch mode is not supported on this system");
+#endif
+}
+
+// Checkpoint sessions: like batch mode, but format the documents one at
+// a time, reading each line of the manifest only after formatting the
+// document of the one before, so that the manifest can be a pipe fed
+// as documents are edited.  A document formatted again resumes from a
+// checkpoint taken at a page boundary before its first change; see
+// checkpoint.cpp.
+
+static const char *session_manifest = 0 /* nullptr */;
+
+static void format_session_document(const char *input)
+{
+  process_input_file(input);
+  exit_troff();
+}
+
+static void run_session()
+{
+  FILE *fp;
+  const char *filename = session_manifest;
+  if (strcmp(filename, "-") == 0) {
+    fp = stdin;
+    filename = "<standard input>";
+  }
+  else {
+    errno = 0;
+    fp = fopen(filename, "r");
+    if (0 /* nullptr */ == fp)
+      fatal("cannot open session manifest file '%1': %2", filename,
+	    strerror(errno));
+  }
+  if (the_output != 0 /* nullptr */)
+    fatal("cannot start session; start-up files or macro packages"
+	  " produced output");
+  start_checkpoint_session(format_session_document);
+  bool has_failure = false;
+  int lineno = 0;
+  const char *input, *output;
+  while (read_manifest_entry(fp, filename, &lineno, &input, &output)) {
+    if (!format_from_checkpoint(input, output)) {
+      error_with_file_and_line(filename, lineno, "formatting of '%1'"
+			       " into '%2' failed", input, output);
+      has_failure = true;
+    }
+    // Tell whoever feeds the manifest that the output is ready.
+    printf("%s\n", output);
+    fflush(stdout);
+  }
+  end_checkpoint_session();
+  exit(has_failure ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
 // make sure the_input is empty before calling this
 
 static int evaluate_expression(const char *expr, units *res)
@@ -9983,15 +10692,18 @@ static void add_string(const char *s, string_list **p)
 void usage(FILE *stream, const char *prog)
 {
   fprintf(stream,
-"usage: %s [-abcCEiRSUz] [-d ctext] [-d string=text] [-f font-family]"
-" [-F font-directory] [-I inclusion-directory] [-m macro-package]"
+"usage: %s [-abBcCEiRSUz] [-d ctext] [-d string=text] [-f font-family]"
+" [-F font-directory] [-I inclusion-directory] [-K input-encoding]"
+" [-m macro-package]"
 " [-M macro-directory] [-n page-number] [-o page-list]"
 " [-r cnumeric-expression] [-r register=numeric-expression]"
 " [-T output-device] [-w warning-category] [-W warning-category]"
 " [file ...]\n"
+"usage: %s [option ...] [-j job-count] -x manifest-file\n"
+"usage: %s [option ...] -X manifest-file\n"
 "usage: %s {-v | --version}\n"
 "usage: %s --help\n",
-	  prog, prog, prog);
+	  prog, prog, prog, prog, prog);
   if (stdout == stream)
     fputs(
 "\n"
@@ -10023,6 +10735,9 @@ int main(int argc, char **argv)
   hresolution = vresolution = 1;
   if (getenv("GROFF_DUMP_NODES") != 0 /* nullptr */)
     want_nodes_dumped = true;
+  const char *profile_file = getenv("GROFF_TROFF_PROFILE");
+  if ((profile_file != 0 /* nullptr */) && (*profile_file != '\0'))
+    start_profile(profile_file);
   // restore $PATH if called from groff
   char* groff_path = getenv("GROFF_PATH__");
   if (groff_path != 0 /* nullptr */) {
@@ -10041,7 +10756,7 @@ int main(int argc, char **argv)
 #define DEBUG_OPTION ""
 #endif
   while ((c = getopt_long(argc, argv,
-			  ":abcCd:Ef:F:iI:m:M:n:o:qr:Rs:StT:Uvw:W:z"
+			  ":abBcCd:Ef:F:iI:j:K:m:M:n:o:qr:Rs:StT:Uvw:W:x:X:z"
 			  DEBUG_OPTION,
 			  long_options, 0 /* nullptr */))
 	 != EOF)
@@ -10057,6 +10772,19 @@ int main(int argc, char **argv)
       // and most other non-system input files.
       include_search_path.command_line_dir(optarg);
       break;
+    case 'K':
+      if ((strcasecmp(optarg, "utf-8") == 0)
+	  || (strcasecmp(optarg, "utf8") == 0))
+	want_utf8_input = true;
+      else if ((strcasecmp(optarg, "latin-1") == 0)
+	       || (strcasecmp(optarg, "latin1") == 0)
+	       || (strcasecmp(optarg, "iso-8859-1") == 0)
+	       || (strcasecmp(optarg, "iso8859-1") == 0))
+	want_utf8_input = false;
+      else
+	error("ignoring unsupported input encoding '%1'; use preconv(1)"
+	      " to convert it", optarg);
+      break;
     case 'T':
       device = optarg;
       have_explicit_device_argument = true;
@@ -10100,6 +10828,9 @@ int main(int argc, char **argv)
     case 'a':
       want_abstract_output = true;
       break;
+    case 'B':
+      want_binary_output = true;
+      break;
     case 'z':
       want_output_suppressed = true;
       break;
@@ -10132,6 +10863,23 @@ int main(int argc, char **argv)
       else
 	add_string(optarg, &register_assignments);
       break;
+    case 'j':
+      {
+	char *end;
+	long n = strtol(optarg, &end, 10);
+	if ((end == optarg) || (*end != '\0') || (n < 1) || (n > INT_MAX))
+	  error("malformed argument to command-line option '-j'; job"
+		" count '%1' is invalid", optarg);
+	else
+	  batch_job_limit = int(n);
+	break;
+      }
+    case 'x':
+      batch_manifest = optarg;
+      break;
+    case 'X':
+      session_manifest = optarg;
+      break;
     case 'f':
       default_family = symbol(optarg);
       have_explicit_default_family = true;
@@ -10178,6 +10926,12 @@ int main(int argc, char **argv)
     default:
       assert(0 == "unhandled case of command-line option");
     }
+  if ((batch_manifest != 0 /* nullptr */)
+      && (session_manifest != 0 /* nullptr */)) {
+    error("command-line options '-x' and '-X' are mutually exclusive");
+    usage(stderr, argv[0]);
+    exit(2);
+  }
   if (want_unsafe_requests)
     mac_path = &macro_path;
   set_string(".T", device);
@@ -10257,6 +11011,16 @@ int main(int argc, char **argv)
   }
   if (!want_startup_macro_files_skipped)
     process_startup_file(FINAL_STARTUP_FILE);
+  if (batch_manifest != 0 /* nullptr */) {
+    if (optind < argc)
+      error("ignoring input file operands in batch mode");
+    run_batch();
+  }
+  if (session_manifest != 0 /* nullptr */) {
+    if (optind < argc)
+      error("ignoring input file operands in checkpoint session");
+    run_session();
+  }
   for (i = optind; i < argc; i++)
     process_input_file(argv[i]);
   if (optind >= argc || want_stdin_read_last)
@@ -10988,18 +11752,35 @@ void debug_with_file_and_line(const char *filename,
 
 dictionary charinfo_dictionary(501);
 
+// A direct-mapped cache in front of `charinfo_dictionary`, indexed by
+// the address of the interned name.  Characters are never destroyed, so
+// an entry goes stale only by being displaced.
+static const int CHARINFO_CACHE_BITS = 10;
+static charinfo *charinfo_cache[1 << CHARINFO_CACHE_BITS];
+
+static inline charinfo *&charinfo_cache_slot(symbol nm)
+{
+  // Fibonacci hashing spreads the closely packed symbol addresses.
+  unsigned long long h = nm.hash() * 0x9E3779B97F4A7C15ULL;
+  return charinfo_cache[h >> (64 - CHARINFO_CACHE_BITS)];
+}
+
 charinfo *lookup_charinfo(symbol nm, bool suppress_creation)
 {
+  if (!nm.is_null()) {
+    charinfo *ci = charinfo_cache_slot(nm);
+    if ((ci != 0 /* nullptr */) && (*ci->get_symbol() == nm))
+      return ci;
+  }
   void *p = charinfo_dictionary.lookup(nm);
-  if (p != 0 /* nullptr */)
-    return static_cast<charinfo *>(p);
-  if (suppress_creation)
-    return static_cast<charinfo *>(0 /* nullptr */);
-  else {
-    charinfo *cp = new charinfo(nm);
-    (void) charinfo_dictionary.lookup(nm, cp);
-    return cp;
+  charinfo *ci = static_cast<charinfo *>(p);
+  if ((0 /* nullptr */ == ci) && !suppress_creation) {
+    ci = new charinfo(nm);
+    (void) charinfo_dictionary.lookup(nm, ci);
   }
+  if ((ci != 0 /* nullptr */) && !nm.is_null())
+    charinfo_cache_slot(nm) = ci;
+  return ci;
 }
 
 int charinfo::next_index = 0;
@@ -61,7 +61,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "device.h"
 #include "font.h" // prerequisite of charinfo.h
 #include "lib.h" // i_to_a(), ui_to_a()
+#include "ptable.h" // next_ptable_size()
+#include "allocation.h" // allocation_scope
 #include "geometry.h" // adjust_arc_center()
+#include "grout.h" // grout_encode_int()
 #include "json-encode.h" // json_encode_char()
 #include "stringclass.h"
 
@@ -153,12 +156,39 @@ struct conditional_bold {
   conditional_bold(int, hunits, conditional_bold * = 0 /* nullptr */);
 };
 
+// Where make_glyph_node() found a glyph missing from a font; see
+// font_info::get_glyph_fallback().
+
+struct glyph_fallback {
+  unsigned int generation;	// current if glyph_fallback_generation
+  int position;			// mounting position with the glyph, or -1
+  charinfo *composite;		// character to format instead, if any
+};
+
+// A tfont recently requested of a font_info, with the arguments of
+// get_tfont() and global modes that selected it.  `fm` and `name` are
+// those of the font then mounted at position `fontno`.
+
+struct tfont_cache_entry {
+  tfont *tf;
+  int fontno;
+  font_size size;
+  int height;
+  int slant;
+  int ligature_mode;
+  int kern_mode;
+  font *fm;
+  symbol name;
+};
+
+// Text often alternates among a few sizes, and glyphs from a few special
+// fonts, within a font.
+static const int TFONT_CACHE_SIZE = 4;
+
 class font_info {
-  tfont *last_tfont;
+  tfont_cache_entry tfont_cache[TFONT_CACHE_SIZE];
+  int next_tfont_cache_entry;	// to replace when none matches
   int number;
-  font_size last_size;
-  int last_height;
-  int last_slant;
   symbol internal_name;
   symbol external_name;
   font *fm;
@@ -167,14 +197,17 @@ class font_info {
   track_kerning_function track_kern;
   constant_space_type is_constant_spaced;
   units constant_space;
-  int last_ligature_mode;
-  int last_kern_mode;
   conditional_bold *cond_bold_list;
+  glyph_fallback *fallbacks;	// indexed by glyph index
+  int nfallbacks;
   void flush();
+  tfont_spec make_tfont_spec(font_size, int, int, int);
 public:
   special_font_list *sf;
   font_info(symbol, int, symbol, font *);
+  ~font_info();
   bool contains(charinfo *);
+  glyph_fallback *get_glyph_fallback(charinfo *);
   void set_bold(hunits);
   void unbold();
   void set_conditional_bold(int, hunits);
@@ -216,15 +249,21 @@ public:
   tfont_spec(symbol, int, font *, font_size, int, int);
   tfont_spec plain();
   bool operator==(const tfont_spec &);
-  friend tfont *font_info::get_tfont(font_size fs, int, int, int);
+  unsigned int hash();
+  friend class font_info;
 };
 
 class tfont : public tfont_spec {
-  static tfont *tfont_list;
+  // All tfonts, in chains hashed by tfont_spec::hash().
+  static tfont **table;
+  static unsigned int table_size;
+  static unsigned int table_used;
   tfont *next;
   tfont *plain_version;
+  void intern();
 public:
   tfont(tfont_spec &);
+  static tfont *find(tfont_spec &);
   int contains(charinfo *);
   hunits get_width(charinfo *c);
   bool is_emboldened(hunits *); // "by how many hunits?" in argument
@@ -264,12 +303,18 @@ static font_info **font_table = 0 /* nullptr */;
 static int font_table_size = 0; // TODO?: font_table.size()
 
 font_info::font_info(symbol nm, int n, symbol enm, font *f)
-: last_tfont(0 /* nullptr */), number(n), last_size(0),
+: next_tfont_cache_entry(0), number(n),
   internal_name(nm), external_name(enm), fm(f),
   has_emboldening(false), is_constant_spaced(CONSTANT_SPACE_NONE),
-  last_ligature_mode(1), last_kern_mode(1),
-  cond_bold_list(0 /* nullptr */), sf(0 /* nullptr */)
+  cond_bold_list(0 /* nullptr */), fallbacks(0 /* nullptr */),
+  nfallbacks(0), sf(0 /* nullptr */)
 {
+  flush();
+}
+
+font_info::~font_info()
+{
+  delete[] fallbacks;
 }
 
 inline bool font_info::contains(charinfo *ci)
@@ -277,6 +322,44 @@ inline bool font_info::contains(charinfo *ci)
   return (fm != 0 /* nullptr */) && fm->contains(ci->as_glyph());
 }
 
+// A search for a glyph missing from the current font can visit every
+// mounted font, and documents heavy in mathematical or non-Latin
+// characters repeat it for most glyphs they format; so each font
+// records, by glyph index, where the search ended.  Mounting a font,
+// changing a special font list, or defining or removing a character
+// makes all such records stale; see invalidate_glyph_fallbacks().
+//
+// While a character definition is interpreted, its macro is detached
+// from it, so searches made then are not recorded.
+
+static unsigned int glyph_fallback_generation = 1;
+static int character_definition_depth = 0;
+
+void invalidate_glyph_fallbacks()
+{
+  glyph_fallback_generation++;
+}
+
+glyph_fallback *font_info::get_glyph_fallback(charinfo *ci)
+{
+  int i = glyph_to_index(ci->as_glyph());
+  if (i >= nfallbacks) {
+    int n = (nfallbacks > 0) ? nfallbacks : 64;
+    while (n <= i)
+      n *= 2;
+    glyph_fallback *old_fallbacks = fallbacks;
+    fallbacks = new glyph_fallback[n];
+    if (old_fallbacks != 0 /* nullptr */)
+      memcpy(fallbacks, old_fallbacks,
+	     nfallbacks * sizeof(glyph_fallback));
+    for (int j = nfallbacks; j < n; j++)
+      fallbacks[j].generation = 0;
+    delete[] old_fallbacks;
+    nfallbacks = n;
+  }
+  return &fallbacks[i];
+}
+
 inline bool font_info::is_special()
 {
   return (fm != 0 /* nullptr */) && fm->is_special();
@@ -307,9 +390,9 @@ font *font_info::get_font() const
 
 tfont *make_tfont(tfont_spec &spec)
 {
-  for (tfont *p = tfont::tfont_list; p != 0 /* nullptr */; p = p->next)
-    if (*p == spec)
-      return p;
+  tfont *p = tfont::find(spec);
+  if (p != 0 /* nullptr */)
+    return p;
   return new tfont(spec);
 }
 
@@ -325,60 +408,76 @@ int env_get_zoom(environment *env)
 tfont *font_info::get_tfont(font_size fs, int height, int slant,
 			    int fontno)
 {
-  if (0 /* nullptr */ == last_tfont
-      || fs != last_size
-      || height != last_height
-      || slant != last_slant
-      || global_ligature_mode != last_ligature_mode
-      || global_kern_mode != last_kern_mode
-      || fontno != number) {
-	font_info *f = font_table[fontno];
-	tfont_spec spec(f->external_name, f->number, f->fm, fs, height,
-			slant);
-	for (conditional_bold *p = cond_bold_list;
-	     p != 0 /* nullptr */;
-	     p = p->next)
-	  if (p->fontno == fontno) {
-	    spec.has_emboldening = true;
-	    spec.bold_offset = p->offset;
-	    break;
-	  }
-	if (!spec.has_emboldening && has_emboldening) {
-	  spec.has_emboldening = true;
-	  spec.bold_offset = bold_offset;
-	}
-	spec.track_kern = track_kern.compute(fs.to_scaled_points());
-	spec.ligature_mode = global_ligature_mode;
-	spec.kern_mode = global_kern_mode;
-	switch (is_constant_spaced) {
-	case CONSTANT_SPACE_NONE:
-	  break;
-	case CONSTANT_SPACE_ABSOLUTE:
-	  spec.has_constant_spacing = true;
-	  spec.constant_space_width = constant_space;
-	  break;
-	case CONSTANT_SPACE_RELATIVE:
-	  spec.has_constant_spacing = true;
-	  spec.constant_space_width
-	    = scale(constant_space * fs.to_scaled_points(),
-		    units_per_inch,
-		    36 * 72 * sizescale);
-	  break;
-	default:
-	  assert(0 == "unhandled case of constant spacing mode");
-	}
-	if (fontno != number)
-	  return make_tfont(spec);
-	// save font for comparison purposes
-	last_tfont = make_tfont(spec);
-	// save font related values not contained in tfont
-	last_size = fs;
-	last_height = height;
-	last_slant = slant;
-	last_ligature_mode = global_ligature_mode;
-	last_kern_mode = global_kern_mode;
-      }
-  return last_tfont;
+  font_info *f = font_table[fontno];
+  for (int i = 0; i < TFONT_CACHE_SIZE; i++) {
+    tfont_cache_entry *e = &tfont_cache[i];
+    if (e->tf != 0 /* nullptr */
+	&& fontno == e->fontno
+	&& fs == e->size
+	&& height == e->height
+	&& slant == e->slant
+	&& global_ligature_mode == e->ligature_mode
+	&& global_kern_mode == e->kern_mode
+	&& f->fm == e->fm
+	&& f->external_name == e->name)
+      return e->tf;
+  }
+  tfont_spec spec = make_tfont_spec(fs, height, slant, fontno);
+  tfont_cache_entry *e = &tfont_cache[next_tfont_cache_entry];
+  next_tfont_cache_entry = (next_tfont_cache_entry + 1)
+			   % TFONT_CACHE_SIZE;
+  e->tf = make_tfont(spec);
+  // save font related values not contained in tfont
+  e->fontno = fontno;
+  e->size = fs;
+  e->height = height;
+  e->slant = slant;
+  e->ligature_mode = global_ligature_mode;
+  e->kern_mode = global_kern_mode;
+  e->fm = f->fm;
+  e->name = f->external_name;
+  return e->tf;
+}
+
+tfont_spec font_info::make_tfont_spec(font_size fs, int height,
+				      int slant, int fontno)
+{
+  font_info *f = font_table[fontno];
+  tfont_spec spec(f->external_name, f->number, f->fm, fs, height,
+		  slant);
+  for (conditional_bold *p = cond_bold_list;
+       p != 0 /* nullptr */;
+       p = p->next)
+    if (p->fontno == fontno) {
+      spec.has_emboldening = true;
+      spec.bold_offset = p->offset;
+      break;
+    }
+  if (!spec.has_emboldening && has_emboldening) {
+    spec.has_emboldening = true;
+    spec.bold_offset = bold_offset;
+  }
+  spec.track_kern = track_kern.compute(fs.to_scaled_points());
+  spec.ligature_mode = global_ligature_mode;
+  spec.kern_mode = global_kern_mode;
+  switch (is_constant_spaced) {
+  case CONSTANT_SPACE_NONE:
+    break;
+  case CONSTANT_SPACE_ABSOLUTE:
+    spec.has_constant_spacing = true;
+    spec.constant_space_width = constant_space;
+    break;
+  case CONSTANT_SPACE_RELATIVE:
+    spec.has_constant_spacing = true;
+    spec.constant_space_width
+      = scale(constant_space * fs.to_scaled_points(),
+	      units_per_inch,
+	      36 * 72 * sizescale);
+    break;
+  default:
+    assert(0 == "unhandled case of constant spacing mode");
+  }
+  return spec;
 }
 
 bool font_info::is_emboldened(hunits *res)
@@ -421,6 +520,7 @@ void font_info::set_conditional_bold(int fontno, hunits offset)
       return;
     }
   cond_bold_list = new conditional_bold(fontno, offset, cond_bold_list);
+  flush();
 }
 
 conditional_bold::conditional_bold(int f, hunits h, conditional_bold *x)
@@ -462,7 +562,8 @@ void font_info::set_track_kern(track_kerning_function &tk)
 
 void font_info::flush()
 {
-  last_tfont = 0;
+  for (int i = 0; i < TFONT_CACHE_SIZE; i++)
+    tfont_cache[i].tf = 0 /* nullptr */;
 }
 
 bool font_info::is_named(symbol s)
@@ -557,6 +658,21 @@ bool tfont_spec::operator==(const tfont_spec &spec)
     return false;
 }
 
+// Combine members that operator==() always compares.
+
+unsigned int tfont_spec::hash()
+{
+  unsigned int h = static_cast<unsigned int>(name.hash());
+  h = h * 31 + input_position;
+  h = h * 31 + size.to_scaled_points();
+  h = h * 31 + height;
+  h = h * 31 + slant;
+  h = h * 31 + track_kern.to_units();
+  h = h * 31 + ligature_mode;
+  h = h * 31 + kern_mode;
+  return h;
+}
+
 tfont_spec tfont_spec::plain()
 {
   return tfont_spec(name, input_position, fm, size, height, slant);
@@ -749,20 +865,53 @@ inline bool tfont::is_kerned(charinfo *c1, charinfo *c2, hunits *res)
   }
 }
 
-tfont *tfont::tfont_list = 0 /* nullptr */;
+tfont **tfont::table = 0 /* nullptr */;
+unsigned int tfont::table_size = 0;
+unsigned int tfont::table_used = 0;
+
+tfont *tfont::find(tfont_spec &spec)
+{
+  if (0 /* nullptr */ == table)
+    return 0 /* nullptr */;
+  for (tfont *p = table[spec.hash() % table_size];
+       p != 0 /* nullptr */;
+       p = p->next)
+    if (*p == spec)
+      return p;
+  return 0 /* nullptr */;
+}
+
+void tfont::intern()
+{
+  if (table_used >= table_size) {
+    tfont **old_table = table;
+    unsigned int old_size = table_size;
+    table_size = next_ptable_size(table_size);
+    table = new tfont *[table_size];
+    for (unsigned int i = 0; i < table_size; i++)
+      table[i] = 0 /* nullptr */;
+    for (unsigned int i = 0; i < old_size; i++)
+      while (old_table[i] != 0 /* nullptr */) {
+	tfont *p = old_table[i];
+	old_table[i] = p->next;
+	unsigned int n = p->hash() % table_size;
+	p->next = table[n];
+	table[n] = p;
+      }
+    delete[] old_table;
+  }
+  unsigned int n = hash() % table_size;
+  next = table[n];
+  table[n] = this;
+  table_used++;
+}
 
 tfont::tfont(tfont_spec &spec) : tfont_spec(spec)
 {
-  next = tfont_list;
-  tfont_list = this;
+  intern();
   tfont_spec plain_spec = plain();
-  tfont *p;
-  for (p = tfont_list; p != 0 /* nullptr */; p = p->next)
-    if (*p == plain_spec) {
-      plain_version = p;
-      break;
-    }
-  if (0 /* nullptr */ == p)
+  plain_version = find(plain_spec);
+  if (0 /* nullptr */ == plain_version)
     plain_version = new tfont(plain_spec);
 }
 
@@ -931,14 +1080,30 @@ inline void troff_output_file::put(const char *s)
   put_string(s, fp);
 }
 
+static void put_binary_int(int i, FILE *fp)
+{
+  if (fp != 0 /* nullptr */) {
+    unsigned char buf[GROUT_INT_MAX_LEN];
+    int len = grout_encode_int(i, buf);
+    for (int j = 0; j < len; j++)
+      putc(buf[j], fp);
+  }
+}
+
 inline void troff_output_file::put(int i)
 {
-  put_string(i_to_a(i), fp);
+  if (want_binary_output)
+    put_binary_int(i, fp);
+  else
+    put_string(i_to_a(i), fp);
 }
 
 inline void troff_output_file::put(unsigned int i)
 {
-  put_string(ui_to_a(i), fp);
+  if (want_binary_output)
+    put_binary_int(int(i), fp);
+  else
+    put_string(ui_to_a(i), fp);
 }
 
 void troff_output_file::start_device_extension(tfont *tf, color *gcol,
@@ -1697,6 +1862,8 @@ troff_output_file::troff_output_file()
   has_page_begun(false), cur_div_level(0)
 {
   font_mounting_position = new symbol[mounting_position_count];
+  if (want_binary_output)
+    put(GROUT_BINARY_MAGIC);
   put("x T ");
   put(device);
   put('\n');
@@ -2139,6 +2306,7 @@ public:
 
 void *ligature_node::operator new(size_t n)
 {
+  allocation_scope scope(ALLOCATION_NODE);
   return new char[n];
 }
 
@@ -2214,6 +2382,16 @@ hyphen_list *glyph_node::get_hyphen_list(hyphen_list *tail, int *count)
   return new hyphen_list(ci->get_hyphenation_code(), tail);
 }
 
+void *node::operator new(size_t n)
+{
+  return allocate_in_category(n, ALLOCATION_NODE);
+}
+
+void node::operator delete(void *p)
+{
+  deallocate(p);
+}
+
 tfont *node::get_tfont()
 {
   return 0 /* nullptr */;
@@ -5574,7 +5752,9 @@ static node *make_composite_node(charinfo *s, environment *env)
   }
   assert((fontno < font_table_size)
 	 && (font_table[fontno] != 0 /* nullptr*/));
+  character_definition_depth++;
   node *n = charinfo_to_node_list(s, env);
+  character_definition_depth--;
   font_size fs = env->get_font_size();
   int char_height = env->get_char_height();
   int char_slant = env->get_char_slant();
@@ -5585,6 +5765,54 @@ static node *make_composite_node(charinfo *s, environment *env)
   return new composite_node(n, s, tf, 0, 0, 0);
 }
 
+// Find where to get the glyph for `s`, which the font at mounting
+// position `fontno` lacks, and record it in `gf`.
+
+static void find_glyph_fallback(int fontno, charinfo *s,
+				glyph_fallback *gf)
+{
+  gf->generation = glyph_fallback_generation;
+  gf->position = -1;
+  gf->composite = 0 /* nullptr */;
+  int fn;
+  special_font_list *sf = font_table[fontno]->sf;
+  for (; sf != 0 /* nullptr */; sf = sf->next) {
+    fn = sf->n;
+    if (font_table[fn] && font_table[fn]->contains(s)) {
+      gf->position = fn;
+      return;
+    }
+  }
+  symbol f = font_table[fontno]->get_name();
+  string gl(f.contents());
+  gl += ' ';
+  gl += s->nm.contents();
+  gl += '\0';
+  charinfo *ci = lookup_charinfo(symbol(gl.contents()));
+  if (ci && ci->get_macro()) {
+    gf->composite = ci;
+    return;
+  }
+  for (sf = global_special_fonts; sf != 0 /* nullptr */; sf = sf->next) {
+    fn = sf->n;
+    if (font_table[fn] && font_table[fn]->contains(s)) {
+      gf->position = fn;
+      return;
+    }
+  }
+  if (s->get_macro() && s->is_special()) {
+    gf->composite = s;
+    return;
+  }
+  for (fn = 0; fn < font_table_size; fn++)
+    if (font_table[fn]
+	&& font_table[fn]->is_special()
+	&& font_table[fn]->contains(s)) {
+      gf->position = fn;
+      return;
+    }
+}
+
 static node *make_glyph_node(charinfo *s, environment *env,
 			     bool want_warnings = true)
 {
@@ -5607,44 +5835,19 @@ static node *make_glyph_node(charinfo *s, environment *env,
 		" font", s->get_number());
       return 0 /* nullptr */;
     }
-    special_font_list *sf = font_table[fontno]->sf;
-    while ((sf != 0 /* nullptr */) && !found) {
-      fn = sf->n;
-      if (font_table[fn])
-	found = font_table[fn]->contains(s);
-      sf = sf->next;
-    }
-    if (!found) {
-      symbol f = font_table[fontno]->get_name();
-      string gl(f.contents());
-      gl += ' ';
-      gl += s->nm.contents();
-      gl += '\0';
-      charinfo *ci = lookup_charinfo(symbol(gl.contents()));
-      if (ci && ci->get_macro())
-	return make_composite_node(ci, env);
-    }
-    if (!found) {
-      sf = global_special_fonts;
-      while ((sf != 0 /* nullptr */) && !found) {
-	fn = sf->n;
-	if (font_table[fn])
-	  found = font_table[fn]->contains(s);
-	sf = sf->next;
-      }
-    }
-    if (!found)
-      if (mac && s->is_special())
-	return make_composite_node(s, env);
-    if (!found) {
-      for (fn = 0; fn < font_table_size; fn++)
-	if (font_table[fn]
-	    && font_table[fn]->is_special()
-	    && font_table[fn]->contains(s)) {
-	  found = true;
-	  break;
-	}
+    glyph_fallback unrecorded;
+    glyph_fallback *gf = &unrecorded;
+    if (character_definition_depth > 0)
+      find_glyph_fallback(fontno, s, gf);
+    else {
+      gf = font_table[fontno]->get_glyph_fallback(s);
+      if (gf->generation != glyph_fallback_generation)
+	find_glyph_fallback(fontno, s, gf);
     }
+    if (gf->composite != 0 /* nullptr */)
+      return make_composite_node(gf->composite, env);
+    fn = gf->position;
+    found = (fn >= 0);
     if (!found) {
       if (want_warnings && s->first_time_not_found()) {
 	unsigned char input_code = s->get_ascii_code();
@@ -6722,6 +6925,7 @@ static bool assign_font_and_file_name_to_mounting_position(
     delete font_table[n];
   font_table[n] = new font_info(name, n, filename, fm);
   font_family::invalidate_selected_font_mounting_position(n);
+  invalidate_glyph_fallbacks();
   return true;
 }
 
@@ -6796,6 +7000,7 @@ bool mount_style(int n, symbol name)
   font_table[n] = new font_info(get_font_translation(name), n,
 				NULL_SYMBOL, 0);
   font_family::invalidate_selected_font_mounting_position(n);
+  invalidate_glyph_fallbacks();
   return true;
 }
 
@@ -7159,6 +7364,7 @@ static void remove_font_specific_character_request() // .rfschar
 	    macro *m = ci->set_macro(0 /* nullptr */);
 	    if (m != 0 /* nullptr */)
 	      delete m;
+	    invalidate_glyph_fallbacks();
 	  }
 	}
       }
@@ -7175,6 +7381,7 @@ static void remove_font_specific_character_request() // .rfschar
 // interpolation.
 static void read_special_font_identifiers(special_font_list **sp)
 {
+  invalidate_glyph_fallbacks();
   special_font_list *s = *sp;
   *sp = 0 /* nullptr */;
   while (s != 0 /* nullptr */) {
@@ -59,6 +59,8 @@ struct node {
   node(node *);
   node(node *, statem *, int);
   node(node *, statem *, int, bool);
+  void *operator new(size_t);
+  void operator delete(void *);
   virtual node *add_char(charinfo *, environment *, hunits *, int *,
 		 node ** /* glyph_comp_np */ = 0 /* nullptr */);
 
@@ -688,6 +690,7 @@ public:
 
 node *make_node(charinfo *, environment *);
 bool character_exists(charinfo *, environment *);
+void invalidate_glyph_fallbacks();
 
 int same_node_list(node *, node *);
 node *reverse_node_list(node *);
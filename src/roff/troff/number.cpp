@@ -295,34 +295,34 @@ static bool is_valid_expression(units *u,
     case int('%'): // TODO: grochar
     case int(':'): // TODO: grochar
     case int('&'): // TODO: grochar
-      tok.next();
+      tok.next_operand();
       break;
     case int('>'): // TODO: grochar
-      tok.next();
+      tok.next_operand();
       if (tok.ch() == int('=')) { // TODO: grochar
-	tok.next();
+	tok.next_operand();
 	op = OP_GEQ;
       }
       else if (tok.ch() == int('?')) { // TODO: grochar
-	tok.next();
+	tok.next_operand();
 	op = OP_MAX;
       }
       break;
     case int('<'): // TODO: grochar
-      tok.next();
+      tok.next_operand();
       if (tok.ch() == int('=')) { // TODO: grochar
-	tok.next();
+	tok.next_operand();
 	op = OP_LEQ;
       }
       else if (tok.ch() == int('?')) { // TODO: grochar
-	tok.next();
+	tok.next_operand();
 	op = OP_MIN;
       }
       break;
     case int('='): // TODO: grochar
-      tok.next();
+      tok.next_operand();
       if (tok.ch() == int('=')) // TODO: grochar
-	tok.next();
+	tok.next_operand();
       break;
     default:
       return result;
@@ -400,21 +400,45 @@ static bool is_valid_expression(units *u,
   return result;
 }
 
+// Append the decimal digits starting at the current token to `*u`,
+// saturating if the result overflows.
+
+static void accumulate_digits(units *u)
+{
+  bool is_overflowing = false;
+  units saved_u = 0; // for use when reading an overlong number
+  int c = tok.ch(); // safely compares to char literals; TODO: grochar
+  do {
+    if (!is_overflowing) {
+      saved_u = *u;
+      if (ckd_mul(u, *u, 10))
+	is_overflowing = true;
+      if (ckd_add(u, *u, c - '0'))
+	is_overflowing = true;
+      if (is_overflowing)
+	*u = saved_u;
+    }
+    // No `else` on overflow; consume and discard further digits.
+    tok.next();
+    c = tok.ch();
+  } while (csdigit(c));
+  if (is_overflowing)
+    warning(WARN_RANGE, "integer value saturated");
+}
+
 static bool is_valid_term(units *u,
 			  unsigned char scaling_unit, // TODO: grochar
 			  bool is_parenthesized,
 			  bool is_mandatory)
 {
   bool is_negative = false;
-  bool is_overflowing = false;
-  units saved_u = 0; // for use when reading an overlong number
   for (;;)
     if (is_parenthesized && tok.is_space())
-      tok.next();
+      tok.next_operand();
     else if (tok.ch() == int('+')) // TODO: grochar
-      tok.next();
+      tok.next_operand();
     else if (tok.ch() == int('-')) { // TODO: grochar
-      tok.next();
+      tok.next_operand();
       is_negative = !is_negative;
     }
     else if (tok.is_tab()) {
@@ -429,7 +453,7 @@ static bool is_valid_term(units *u,
   case int('|'): // TODO: grochar
     // | is not restricted to the outermost level
     // tbl uses this
-    tok.next();
+    tok.next_operand();
     if (!is_valid_term(u, scaling_unit, is_parenthesized, is_mandatory))
       return false;
     int tmp, position;
@@ -445,7 +469,7 @@ static bool is_valid_term(units *u,
       *u = -*u;
     return true;
   case int('('): // TODO: grochar
-    tok.next();
+    tok.next_operand();
     c = tok.ch();
     if (int(')') == c) { // TODO: grochar
       if (is_mandatory)
@@ -469,7 +493,7 @@ static bool is_valid_term(units *u,
     }
     else if (';' == c) {
       scaling_unit = 0;
-      tok.next();
+      tok.next_operand();
     }
     if (!is_valid_expression(u, scaling_unit,
 			     true /* is_parenthesized */, is_mandatory))
@@ -502,22 +526,7 @@ static bool is_valid_term(units *u,
   case int('8'): // TODO: grochar
   case int('9'): // TODO: grochar
     *u = 0;
-    do {
-      if (!is_overflowing) {
-	  saved_u = *u;
-	  if (ckd_mul(u, *u, 10))
-	    is_overflowing = true;
-	  if (ckd_add(u, *u, c - '0'))
-	    is_overflowing = true;
-	  if (is_overflowing)
-	    *u = saved_u;
-      }
-      // No `else` on overflow; consume and discard further digits.
-      tok.next();
-      c = tok.ch();
-    } while (csdigit(c));
-    if (is_overflowing)
-      warning(WARN_RANGE, "integer value saturated");
+    accumulate_digits(u);
     break;
   case int('/'): // TODO: grochar
   case int('*'): // TODO: grochar
@@ -532,6 +541,19 @@ static bool is_valid_term(units *u,
     *u = 0;
     return !is_mandatory;
   default:
+    if (tok.is_register_value()) {
+      // The register's value stands in for the digits it would have
+      // interpolated, so that further digits append to it.
+      *u = tok.register_value();
+      if (*u < 0) {
+	*u = -*u;
+	is_negative = !is_negative;
+      }
+      tok.next();
+      if (csdigit(tok.ch()))
+	accumulate_digits(u);
+      break;
+    }
     error("ignoring invalid numeric expression containing %1",
 	  tok.description());
     return false;
@@ -0,0 +1,300 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// Record, for each macro and request called, how often it was called,
+// the processor time and input bytes consumed inclusive and exclusive
+// of the macros and requests it called in turn, and the same figures
+// for each caller-callee pair; then write them out as JSON.
+//
+// A request runs to completion within request::invoke(), but a macro
+// call lasts until its macro_iterator leaves the input stack.  So calls
+// need not end in the reverse order they began: a trap-called macro
+// sprung by a request outlives it, and `return` ends a macro while the
+// request is still running.  We therefore charge exclusive figures to
+// whichever call began most recently among those still open, whenever
+// a call begins or ends, and compute inclusive ones from each call's
+// own beginning and end.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h> // FILE, fclose(), fopen(), fprintf(), fputs()
+#include <stdlib.h> // free(), qsort()
+#include <string.h> // strerror()
+#include <time.h> // clock(), clock_t, CLOCKS_PER_SEC
+
+// libgroff
+#include "errarg.h"
+#include "error.h"
+#include "stringclass.h"
+#include "symbol.h"
+
+// troff
+#include "dictionary.h"
+#include "profile.h"
+
+bool want_profile = false;
+unsigned long input_byte_count = 0;
+
+static string profile_file_name;
+
+struct profile_entry;
+
+struct profile_edge {
+  profile_entry *callee;
+  unsigned long calls;
+  clock_t time;
+  unsigned long bytes;
+  profile_edge *next;
+};
+
+struct profile_entry {
+  symbol nm;
+  bool is_request;
+  unsigned long calls;
+  int active;			// calls in progress, for recursion
+  clock_t inclusive_time;
+  clock_t exclusive_time;
+  unsigned long inclusive_bytes;
+  unsigned long exclusive_bytes;
+  profile_edge *callees;
+  profile_entry *next;		// in order of first call
+  profile_entry(symbol, bool);
+  profile_edge *get_edge(profile_entry *);
+};
+
+profile_entry::profile_entry(symbol s, bool b)
+: nm(s), is_request(b), calls(0), active(0), inclusive_time(0),
+  exclusive_time(0), inclusive_bytes(0), exclusive_bytes(0),
+  callees(0 /* nullptr */), next(0 /* nullptr */)
+{
+}
+
+// Callers typically call few distinct macros and requests, so a list
+// serves.
+
+profile_edge *profile_entry::get_edge(profile_entry *e)
+{
+  profile_edge *p;
+  for (p = callees; p != 0 /* nullptr */; p = p->next)
+    if (p->callee == e)
+      return p;
+  p = new profile_edge;
+  p->callee = e;
+  p->calls = 0;
+  p->time = 0;
+  p->bytes = 0;
+  p->next = callees;
+  callees = p;
+  return p;
+}
+
+struct profile_frame {
+  unsigned long serial;
+  profile_entry *entry;
+  profile_entry *caller;	// null if called from top level
+  clock_t start_time;
+  unsigned long start_bytes;
+};
+
+static dictionary macro_entries(101);
+static dictionary request_entries(101);
+static profile_entry *entry_list = 0 /* nullptr */;
+static profile_entry **entry_list_tail = &entry_list;
+static int entry_count = 0;
+
+static profile_frame *frames = 0 /* nullptr */;
+static int frames_size = 0;
+static int nframes = 0;
+static unsigned long next_serial = 1;
+static clock_t last_time = 0;
+static unsigned long last_bytes = 0;
+
+void start_profile(const char *filename)
+{
+  profile_file_name = filename;
+  want_profile = true;
+}
+
+static profile_entry *lookup_entry(symbol nm, bool is_request)
+{
+  dictionary &d = is_request ? request_entries : macro_entries;
+  profile_entry *e = static_cast<profile_entry *>(d.lookup(nm));
+  if (0 /* nullptr */ == e) {
+    e = new profile_entry(nm, is_request);
+    (void) d.lookup(nm, e);
+    *entry_list_tail = e;
+    entry_list_tail = &e->next;
+    entry_count++;
+  }
+  return e;
+}
+
+// Charge what was consumed since the last call began or ended to the
+// innermost open call.
+
+static void charge(clock_t now)
+{
+  if (nframes > 0) {
+    profile_entry *e = frames[nframes - 1].entry;
+    e->exclusive_time += now - last_time;
+    e->exclusive_bytes += input_byte_count - last_bytes;
+  }
+  last_time = now;
+  last_bytes = input_byte_count;
+}
+
+unsigned long profile_enter(symbol nm, bool is_request)
+{
+  profile_entry *e = lookup_entry(nm, is_request);
+  clock_t now = clock();
+  charge(now);
+  if (nframes >= frames_size) {
+    profile_frame *old_frames = frames;
+    frames_size = (0 == frames_size) ? 16 : frames_size * 2;
+    frames = new profile_frame[frames_size];
+    for (int i = 0; i < nframes; i++)
+      frames[i] = old_frames[i];
+    delete[] old_frames;
+  }
+  profile_frame *f = &frames[nframes];
+  f->serial = next_serial++;
+  f->entry = e;
+  f->caller = (nframes > 0) ? frames[nframes - 1].entry
+			    : 0 /* nullptr */;
+  f->start_time = now;
+  f->start_bytes = input_byte_count;
+  nframes++;
+  e->calls++;
+  e->active++;
+  return f->serial;
+}
+
+void profile_leave(unsigned long serial)
+{
+  int i;
+  for (i = nframes - 1; i >= 0; i--)
+    if (frames[i].serial == serial)
+      break;
+  if (i < 0)
+    return;
+  clock_t now = clock();
+  charge(now);
+  profile_frame *f = &frames[i];
+  profile_entry *e = f->entry;
+  clock_t elapsed = now - f->start_time;
+  unsigned long bytes = input_byte_count - f->start_bytes;
+  // Count only the outermost of recursive calls in inclusive figures.
+  if (--(e->active) == 0) {
+    e->inclusive_time += elapsed;
+    e->inclusive_bytes += bytes;
+  }
+  if (f->caller != 0 /* nullptr */) {
+    profile_edge *edge = f->caller->get_edge(e);
+    edge->calls++;
+    edge->time += elapsed;
+    edge->bytes += bytes;
+  }
+  for (nframes--; i < nframes; i++)
+    frames[i] = frames[i + 1];
+}
+
+static double seconds(clock_t t)
+{
+  return double(t) / CLOCKS_PER_SEC;
+}
+
+static void write_name(FILE *fp, profile_entry *e)
+{
+  const char *jsonnm = e->nm.json_extract();
+  fprintf(fp, "\"name\": %s, \"type\": \"%s\"", jsonnm,
+	  e->is_request ? "request" : "macro");
+  free(const_cast<char *>(jsonnm));
+}
+
+// Sort the busiest macros and requests first.
+
+static int compare_entries(const void *p, const void *q)
+{
+  const profile_entry *e1 = *static_cast<profile_entry *const *>(p);
+  const profile_entry *e2 = *static_cast<profile_entry *const *>(q);
+  if (e1->exclusive_time != e2->exclusive_time)
+    return (e1->exclusive_time > e2->exclusive_time) ? -1 : 1;
+  if (e1->calls != e2->calls)
+    return (e1->calls > e2->calls) ? -1 : 1;
+  return 0;
+}
+
+void write_profile()
+{
+  if (!want_profile)
+    return;
+  // Calls still in progress, like that of an end-of-input macro, end
+  // now.
+  while (nframes > 0)
+    profile_leave(frames[nframes - 1].serial);
+  want_profile = false;
+  string fn(profile_file_name);
+  fn += '\0';
+  errno = 0;
+  FILE *fp = fopen(fn.contents(), "w");
+  if (0 /* nullptr */ == fp) {
+    error("cannot open profile file '%1': %2", fn.contents(),
+	  strerror(errno));
+    return;
+  }
+  profile_entry **sorted = new profile_entry *[entry_count];
+  int n = 0;
+  for (profile_entry *e = entry_list; e != 0 /* nullptr */; e = e->next)
+    sorted[n++] = e;
+  qsort(sorted, n, sizeof sorted[0], compare_entries);
+  fprintf(fp, "{\"processor time\": %.6f, \"input bytes\": %lu,"
+	  " \"calls\": [", seconds(clock()), input_byte_count);
+  for (int i = 0; i < n; i++) {
+    profile_entry *e = sorted[i];
+    fputs((i > 0) ? ",\n  {" : "\n  {", fp);
+    write_name(fp, e);
+    fprintf(fp, ", \"calls\": %lu,"
+	    " \"inclusive time\": %.6f, \"exclusive time\": %.6f,"
+	    " \"inclusive bytes\": %lu, \"exclusive bytes\": %lu,"
+	    " \"callees\": [",
+	    e->calls, seconds(e->inclusive_time),
+	    seconds(e->exclusive_time), e->inclusive_bytes,
+	    e->exclusive_bytes);
+    for (profile_edge *p = e->callees; p != 0 /* nullptr */;
+	 p = p->next) {
+      fputs((p != e->callees) ? ",\n    {" : "\n    {", fp);
+      write_name(fp, p->callee);
+      fprintf(fp, ", \"calls\": %lu, \"time\": %.6f, \"bytes\": %lu}",
+	      p->calls, seconds(p->time), p->bytes);
+    }
+    fputs("]}", fp);
+  }
+  fputs("\n]}\n", fp);
+  delete[] sorted;
+  if (fclose(fp) != 0)
+    error("cannot close profile file '%1': %2", fn.contents(),
+	  strerror(errno));
+}
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
@@ -0,0 +1,47 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// Profiling of macro and request calls; see GROFF_TROFF_PROFILE in
+// troff(1).
+//
+// groff doesn't yet use include guards, so until it does, any source
+// file needing symbols from this one must #include "symbol.h" first.
+
+extern bool want_profile;
+
+// Count of input bytes read by the formatter, maintained by
+// input_stack::get().
+extern unsigned long input_byte_count;
+
+void start_profile(const char * /* filename */);
+
+// Begin a call of the macro or request `nm`; return a handle for
+// profile_leave().
+unsigned long profile_enter(symbol /* nm */, bool /* is_request */);
+
+// End the call identified by the handle.  Calls begun after it stay
+// open, because a request can return while a macro it interpolated is
+// still being read.  A handle whose call already ended is ignored.
+void profile_leave(unsigned long);
+
+void write_profile();
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
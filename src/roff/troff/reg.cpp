@@ -48,6 +48,11 @@ bool reg::get_value(units * /*d*/)
   return false;
 }
 
+bool reg::get_decimal_value(units * /*d*/)
+{
+  return false;
+}
+
 void reg::increment()
 {
   error("cannot increment read-only register");
@@ -256,6 +261,13 @@ const char *general_reg::get_string()
   return number_value_to_ascii(n, format, width);
 }
 
+bool general_reg::get_decimal_value(units *d)
+{
+  if ((format != '1') || (width > 0))
+    return false;
+  return get_value(d);
+}
+
 void general_reg::increment()
 {
   int n;
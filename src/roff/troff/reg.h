@@ -21,6 +21,9 @@ class reg : public object {
 public:
   virtual const char *get_string() = 0;
   virtual bool get_value(units *);
+  // If interpolating the register yields the plain decimal
+  // representation of an integer, store it and return true.
+  virtual bool get_decimal_value(units *);
   virtual void increment();
   virtual void decrement();
   virtual void set_increment(units);
@@ -39,6 +42,7 @@ class readonly_register : public reg {
 public:
   readonly_register(int *);
   const char *get_string();
+  bool get_decimal_value(units *);
 };
 
 class readonly_boolean_register : public reg {
@@ -46,6 +50,7 @@ class readonly_boolean_register : public reg {
 public:
   readonly_boolean_register(bool *);
   const char *get_string();
+  bool get_decimal_value(units *);
 };
 
 class general_reg : public reg {
@@ -55,6 +60,7 @@ class general_reg : public reg {
 public:
   general_reg();
   const char *get_string();
+  bool get_decimal_value(units *);
   void increment();
   void decrement();
   void alter_format(char f, int w = 0);
@@ -49,6 +49,7 @@ class macro : public request_or_macro {
   bool is_empty_macro;
   bool is_a_diversion;
   bool is_a_string;		// if it contains no newline
+  void prepare_to_append();
 public:
   macro_header *p;
   macro();
@@ -62,6 +62,7 @@ class token {
     TOKEN_NEWLINE,		// ^J
     TOKEN_NODE,
     TOKEN_PAGE_EJECTOR,
+    TOKEN_REGISTER_VALUE,	// \n at the start of an expression term
     TOKEN_REQUEST,
     TOKEN_RIGHT_BRACE,		// \}
     TOKEN_SPACE,		// ' ' -- ordinary space
@@ -80,6 +81,7 @@ public:
   token(const token &);
   void operator=(const token &);
   void next();
+  void next_operand();		// as next(), but may yield a register value
   void process();
   void skip_spaces();
   void diagnose_non_character();
@@ -110,15 +112,18 @@ public:
   bool is_hyphen_indicator();
   bool is_zero_width_break();
   bool is_terminator();
+  bool is_register_value();
   bool operator==(const token &); // for delimiters & conditional exprs
   bool operator!=(const token &); // ditto
   unsigned char ch();
   int character_index();
+  units register_value();
   charinfo *get_charinfo(bool /* is_mandatory */ = false,
 			 bool /* suppress_creation */ = false);
   bool add_to_zero_width_node_list(node **);
   void make_space();
   void make_newline();
+  void make_special_character(symbol);
   void describe_node(char * /* buf */, size_t /* bufsz */);
   const char *description();
 
@@ -238,6 +243,12 @@ inline int token::character_index()
   return val;
 }
 
+inline units token::register_value()
+{
+  assert(TOKEN_REGISTER_VALUE == type);
+  return val;
+}
+
 inline bool token::is_node()
 {
   return (TOKEN_NODE == type);
@@ -309,6 +320,11 @@ inline bool token::is_terminator()
 	  || (TOKEN_RIGHT_BRACE == type));
 }
 
+inline bool token::is_register_value()
+{
+  return (TOKEN_REGISTER_VALUE == type);
+}
+
 // Local Variables:
 // fill-column: 72
 // mode: C++
@@ -24,6 +24,7 @@ extern units scale(units n, units x, units y); // scale n by x/y
 extern bool want_att_compat;
 extern bool want_abstract_output;
 extern bool want_output_suppressed;
+extern bool want_binary_output;
 extern bool want_color_output;
 extern bool is_writing_html;
 extern bool in_nroff_mode;
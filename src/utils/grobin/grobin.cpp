@@ -0,0 +1,425 @@
+/* Copyright 2026 Free Software Foundation, Inc.
+
+This file is part of groff, the GNU roff typesetting system.
+
+groff is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+groff is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// Convert device-independent troff output between its text form and
+// the binary form written by 'troff -B' (see grout.h).
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <ctype.h> // isdigit()
+#include <errno.h>
+#include <limits.h> // CHAR_MAX, INT_MAX
+#include <stdio.h> // EOF, FILE, fclose(), fopen(), getc(), putchar()
+#include <stdlib.h> // exit(), EXIT_FAILURE, EXIT_SUCCESS
+#include <string.h> // strcmp(), strerror(), strlen()
+
+#include <getopt.h> // getopt_long()
+
+#include "lib.h"
+
+#include "errarg.h"
+#include "error.h"
+#include "grout.h"
+#include "nonposix.h"
+
+extern "C" const char *Version_string;
+
+enum conversion { DETECT, TO_BINARY, TO_TEXT };
+
+static FILE *fp;
+static const char *current_name;
+static bool want_binary;
+
+// We look ahead by at most the length of the binary magic line.
+static int pushback[64];
+static int npushback = 0;
+
+static int get()
+{
+  if (npushback > 0)
+    return pushback[--npushback];
+  return getc(fp);
+}
+
+static void unget(int c)
+{
+  assert(npushback < int(sizeof pushback / sizeof pushback[0]));
+  if (c != EOF)
+    pushback[npushback++] = c;
+}
+
+static void put(int c)
+{
+  putchar(c);
+}
+
+static void put_int(int n)
+{
+  if (want_binary) {
+    unsigned char buf[GROUT_INT_MAX_LEN];
+    int len = grout_encode_int(n, buf);
+    for (int i = 0; i < len; i++)
+      put(buf[i]);
+  }
+  else
+    fputs(i_to_a(n), stdout);
+}
+
+static void copy_space()
+{
+  int c;
+  while ((c = get()) == ' ' || c == '\t')
+    put(c);
+  unget(c);
+}
+
+static void copy_line()
+{
+  int c;
+  while ((c = get()) != EOF) {
+    put(c);
+    if ('\n' == c)
+      break;
+  }
+}
+
+// Copy a single-character argument.
+static void copy_char_arg()
+{
+  copy_space();
+  int c = get();
+  if ('\n' == c)
+    unget(c);
+  else if (c != EOF)
+    put(c);
+}
+
+// Copy an argument ending at a space, tab, or newline; return its
+// first character.
+static int copy_string_arg()
+{
+  copy_space();
+  int first = get();
+  int c = first;
+  while (c != EOF && c != ' ' && c != '\t' && c != '\n') {
+    put(c);
+    c = get();
+  }
+  unget(c);
+  return first;
+}
+
+// Convert one integer argument; return false if there isn't one.
+static bool convert_int_arg()
+{
+  copy_space();
+  int c = get();
+  if (grout_is_int_prefix(c)) {
+    unsigned char buf[GROUT_INT_MAX_LEN];
+    for (int i = 0; i < c; i++) {
+      int b = get();
+      if (EOF == b) {
+	error("%1: truncated binary integer argument", current_name);
+	return false;
+      }
+      buf[i] = (unsigned char) b;
+    }
+    put_int(grout_decode_int(buf, c));
+    return true;
+  }
+  bool is_negative = false;
+  if ('-' == c) {
+    is_negative = true;
+    c = get();
+  }
+  if (!isdigit(c)) {
+    unget(c);
+    if (is_negative)
+      put('-');
+    error("%1: integer argument expected", current_name);
+    return false;
+  }
+  int n = 0;
+  bool is_too_large = false;
+  for (; isdigit(c); c = get()) {
+    if (n > (INT_MAX - (c - '0')) / 10)
+      is_too_large = true;
+    else
+      n = n * 10 + (c - '0');
+  }
+  unget(c);
+  if (is_too_large) {
+    error("%1: integer argument too large", current_name);
+    n = 0;
+  }
+  put_int(is_negative ? -n : n);
+  return true;
+}
+
+// Convert integer arguments up to the end of the line.
+static void convert_int_args()
+{
+  for (;;) {
+    copy_space();
+    int c = get();
+    unget(c);
+    if (EOF == c || '\n' == c || '#' == c)
+      break;
+    if (!convert_int_arg()) {
+      copy_line();
+      break;
+    }
+  }
+}
+
+static void convert()
+{
+  int c;
+  while ((c = get()) != EOF) {
+    if (c != ' ' && c != '\t' && c != '\n' && c != '#')
+      put(c);
+    switch (c) {
+    case ' ':
+    case '\t':
+    case '\n':
+      put(c);
+      break;
+    case '#':
+      unget(c);
+      copy_line();
+      break;
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      copy_char_arg();
+      copy_char_arg();
+      break;
+    case 'c':
+      copy_char_arg();
+      break;
+    case 'C':
+    case 't':
+      (void) copy_string_arg();
+      break;
+    case 'u':
+      if (convert_int_arg())
+	(void) copy_string_arg();
+      break;
+    case 'f':
+    case 'h':
+    case 'H':
+    case 'N':
+    case 'p':
+    case 's':
+    case 'v':
+    case 'V':
+      (void) convert_int_arg();
+      break;
+    case 'n':
+      if (convert_int_arg())
+	(void) convert_int_arg();
+      break;
+    case 'w':
+    case '{':
+    case '}':
+      break;
+    case 'm':
+      copy_char_arg();
+      convert_int_args();
+      break;
+    case 'D':
+      copy_space();
+      c = get();
+      if (c != EOF && c != '\n')
+	put(c);
+      else
+	unget(c);
+      if ('F' == c)
+	copy_char_arg();
+      convert_int_args();
+      break;
+    case 'x':
+      switch (copy_string_arg()) {
+      case 'r':
+	convert_int_args();
+	break;
+      case 'f':
+      case 'H':
+      case 'S':
+	(void) convert_int_arg();
+	copy_line();
+	break;
+      case 'X':
+	copy_line();
+	while ((c = get()) == '+') {
+	  put(c);
+	  copy_line();
+	}
+	unget(c);
+	break;
+      default:
+	copy_line();
+	break;
+      }
+      break;
+    default:
+      // 'F' and anything unrecognized
+      copy_line();
+      break;
+    }
+  }
+}
+
+// Consume the binary magic line if present; return whether it was.
+static bool read_magic()
+{
+  const char *magic = GROUT_BINARY_MAGIC;
+  size_t len = strlen(magic);
+  assert(len <= sizeof pushback / sizeof pushback[0]);
+  size_t i;
+  int c = EOF;
+  for (i = 0; i < len; i++) {
+    c = get();
+    if (c != (unsigned char) magic[i])
+      break;
+  }
+  if (i == len)
+    return true;
+  unget(c);
+  while (i > 0)
+    unget((unsigned char) magic[--i]);
+  return false;
+}
+
+static void do_file(const char *filename, conversion conv,
+		    bool *have_written_magic)
+{
+  if (strcmp(filename, "-") == 0) {
+    fp = stdin;
+    current_name = "standard input";
+  }
+  else {
+    errno = 0;
+    fp = fopen(filename, "rb");
+    if (0 /* nullptr */ == fp) {
+      error("cannot open '%1': %2", filename, strerror(errno));
+      return;
+    }
+    current_name = filename;
+  }
+  npushback = 0;
+  bool is_binary = read_magic();
+  if (DETECT == conv)
+    want_binary = !is_binary;
+  else
+    want_binary = (TO_BINARY == conv);
+  if (want_binary && !*have_written_magic) {
+    fputs(GROUT_BINARY_MAGIC, stdout);
+    *have_written_magic = true;
+  }
+  convert();
+  if (fp != stdin)
+    fclose(fp);
+}
+
+static void usage(FILE *stream)
+{
+  fprintf(stream,
+	  "usage: %s [-b | -t] [file ...]\n"
+	  "usage: %s {-v | --version}\n"
+	  "usage: %s --help\n",
+	  program_name, program_name, program_name);
+  if (stdout == stream)
+    fputs("\n"
+"Convert device-independent troff output between the text form and\n"
+"the binary form written by 'troff -B'.  With -b, write the binary\n"
+"form; with -t, write the text form; by default, convert each file\n"
+"to the form it is not in.  See the grobin(1) manual page.\n",
+	  stream);
+}
+
+int main(int argc, char **argv)
+{
+  program_name = argv[0];
+  static char stderr_buf[BUFSIZ];
+  setbuf(stderr, stderr_buf);
+  conversion conv = DETECT;
+  int opt;
+  static const struct option long_options[] = {
+    { "help", no_argument, 0 /* nullptr */, CHAR_MAX + 1 },
+    { "version", no_argument, 0 /* nullptr */, 'v' },
+    { 0 /* nullptr */, 0, 0 /* nullptr */, 0 }
+  };
+  while ((opt = getopt_long(argc, argv, ":btv", long_options,
+			    0 /* nullptr */))
+	 != EOF)
+    switch (opt) {
+    case 'b':
+      conv = TO_BINARY;
+      break;
+    case 't':
+      conv = TO_TEXT;
+      break;
+    case 'v':
+      printf("GNU grobin (groff) version %s\n", Version_string);
+      exit(EXIT_SUCCESS);
+      break;
+    case CHAR_MAX + 1: // --help
+      usage(stdout);
+      exit(EXIT_SUCCESS);
+      break;
+    case '?':
+      if (optopt != 0)
+	error("unrecognized command-line option '%1'", char(optopt));
+      else
+	error("unrecognized command-line option '%1'",
+	      argv[(optind - 1)]);
+      usage(stderr);
+      exit(2);
+      break;
+    default:
+      assert(0 == "unhandled case of command-line option");
+    }
+  SET_BINARY(fileno(stdin));
+  SET_BINARY(fileno(stdout));
+  bool have_written_magic = false;
+  if (optind >= argc)
+    do_file("-", conv, &have_written_magic);
+  else
+    for (int i = optind; i < argc; i++)
+      do_file(argv[i], conv, &have_written_magic);
+  if (fflush(stdout) < 0 || ferror(stdout))
+    fatal("error writing standard output stream: %1",
+	  strerror(errno));
+  return EXIT_SUCCESS;
+}
+
+// Local Variables:
+// fill-column: 72
+// mode: C++
+// End:
+// vim: set cindent noexpandtab shiftwidth=2 textwidth=72:
@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# Copyright 2026 Free Software Foundation, Inc.
+#
+# This file is part of groff, the GNU roff typesetting system.
+#
+# groff is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# groff is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+groff="${abs_top_builddir:-.}/test-groff"
+grobin="${abs_top_builddir:-.}/grobin"
+grotty="${abs_top_builddir:-.}/grotty"
+
+fail=
+
+wail () {
+    echo "...FAILED" >&2
+    fail=yes
+}
+
+# Exercise motions, both signs and several magnitudes of integer,
+# colors, drawing commands, and special characters.
+input='.TH foo 1 2026-10-19 "groff test suite"
+.SH Name
+foo \- frobnicate a \m[red]bar\m[]
+.SH Description
+\D'"'"'l 1i -1i'"'"'\h'"'"'-2m'"'"'\[co]\v'"'"'1000u'"'"'x\v'"'"'-1000u'"'"'
+.sp 40
+\M[blue]baz\M[] \D'"'"'p 1i 1i 2i 3i'"'"'
+.bp
+qux'
+
+text=$(printf "%s\n" "$input" | "$groff" -Z -man -Tascii)
+
+echo "checking that text form converts to binary form with magic line" >&2
+magic=$(printf "%s\n" "$text" | "$grobin" | head -n 1)
+echo "$magic"
+test "$magic" = "# groff binary intermediate output" || wail
+
+echo "checking that conversion to binary form and back is lossless" >&2
+output=$(printf "%s\n" "$text" | "$grobin" | "$grobin")
+test "$output" = "$text" || wail
+
+echo "checking that -t leaves text form unchanged" >&2
+output=$(printf "%s\n" "$text" | "$grobin" -t)
+test "$output" = "$text" || wail
+
+echo "checking that output driver renders both forms identically" >&2
+expected=$(printf "%s\n" "$text" | "$grotty" -F font -F build/font)
+output=$(printf "%s\n" "$text" | "$grobin" -b \
+    | "$grotty" -F font -F build/font)
+echo "$output"
+test -n "$output" || wail
+test "$output" = "$expected" || wail
+
+test -z "$fail"
+
+# vim:set autoindent expandtab shiftwidth=4 tabstop=4 textwidth=72: